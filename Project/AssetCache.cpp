@@ -0,0 +1,125 @@
+//---------------------------
+// Includes
+//---------------------------
+#include "AssetCache.h"
+#include <stdexcept>
+#include "StreamedTexture.h"
+#include "Hash.h"
+
+//---------------------------
+// Member functions
+//---------------------------
+
+void AssetCache::Initialize(const VulkanContext& context, TextureStreamer& textureStreamer)
+{
+	m_Context = context;
+	m_pTextureStreamer = &textureStreamer;
+
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(context.physicalDevice, &properties);
+	m_MaxSamplers = properties.limits.maxSamplerAllocationCount;
+}
+
+void AssetCache::Cleanup()
+{
+	m_Textures.clear();
+	m_Meshes.clear();
+	m_Samplers.clear();
+}
+
+std::shared_ptr<Texture> AssetCache::LoadTexture(const std::string& fileName)
+{
+	if (auto it = m_Textures.find(fileName); it != m_Textures.end())
+	{
+		if (std::shared_ptr<Texture> pTexture = it->second.lock())
+			return pTexture;
+	}
+
+	auto pTexture = std::make_shared<StreamedTexture>(fileName, m_Context);
+	m_pTextureStreamer->Add(pTexture);
+	m_Textures[fileName] = pTexture;
+	return pTexture;
+}
+
+std::shared_ptr<MeshAsset> AssetCache::LoadMesh(const std::string& fileName, const MeshImportOptions& options)
+{
+	const MeshKey key{ fileName, options };
+	if (auto it = m_Meshes.find(key); it != m_Meshes.end())
+	{
+		if (std::shared_ptr<MeshAsset> pAsset = it->second.lock())
+			return pAsset;
+	}
+
+	std::shared_ptr<MeshAsset> pAsset = MeshAsset::Import(fileName, options);
+	m_Meshes[key] = pAsset;
+	return pAsset;
+}
+
+std::shared_ptr<Sampler> AssetCache::GetSampler(const VkSamplerCreateInfo& createInfo)
+{
+	if (createInfo.pNext)
+		throw std::runtime_error("cached samplers cannot have a pNext chain!");
+
+	const size_t hash = HashSampler(createInfo);
+	auto [begin, end] = m_Samplers.equal_range(hash);
+	for (auto it = begin; it != end; ++it)
+	{
+		if (!SamplersMatch(it->second.createInfo, createInfo))
+			continue;
+		if (std::shared_ptr<Sampler> pSampler = it->second.pSampler.lock())
+			return pSampler;
+	}
+
+	// Only live samplers count against the limit
+	std::erase_if(m_Samplers, [](const auto& entry) { return entry.second.pSampler.expired(); });
+	if (m_Samplers.size() >= m_MaxSamplers)
+		throw std::runtime_error("sampler allocation limit reached!");
+
+	VkSampler sampler{};
+	if (vkCreateSampler(m_Context.device, &createInfo, nullptr, &sampler) != VK_SUCCESS)
+		throw std::runtime_error("failed to create texture sampler!");
+
+	auto pSampler = std::make_shared<Sampler>(sampler);
+	m_Samplers.emplace(hash, SamplerEntry{ createInfo, pSampler });
+	return pSampler;
+}
+
+size_t AssetCache::MeshKeyHash::operator()(const MeshKey& key) const
+{
+	size_t seed{ 0 };
+	HashCombine(seed, key.fileName);
+	HashCombine(seed, key.options.flipAxisAndWinding);
+	HashCombine(seed, static_cast<uint32_t>(key.options.cpuDataPolicy));
+	return seed;
+}
+
+size_t AssetCache::HashSampler(const VkSamplerCreateInfo& createInfo)
+{
+	size_t seed{ 0 };
+	HashCombine(seed, createInfo.flags);
+	HashCombine(seed, static_cast<uint32_t>(createInfo.magFilter));
+	HashCombine(seed, static_cast<uint32_t>(createInfo.minFilter));
+	HashCombine(seed, static_cast<uint32_t>(createInfo.mipmapMode));
+	HashCombine(seed, static_cast<uint32_t>(createInfo.addressModeU));
+	HashCombine(seed, static_cast<uint32_t>(createInfo.addressModeV));
+	HashCombine(seed, static_cast<uint32_t>(createInfo.addressModeW));
+	HashCombine(seed, createInfo.mipLodBias);
+	HashCombine(seed, createInfo.anisotropyEnable);
+	HashCombine(seed, createInfo.maxAnisotropy);
+	HashCombine(seed, createInfo.compareEnable);
+	HashCombine(seed, static_cast<uint32_t>(createInfo.compareOp));
+	HashCombine(seed, createInfo.minLod);
+	HashCombine(seed, createInfo.maxLod);
+	HashCombine(seed, static_cast<uint32_t>(createInfo.borderColor));
+	HashCombine(seed, createInfo.unnormalizedCoordinates);
+	return seed;
+}
+
+bool AssetCache::SamplersMatch(const VkSamplerCreateInfo& a, const VkSamplerCreateInfo& b)
+{
+	return a.flags == b.flags && a.magFilter == b.magFilter && a.minFilter == b.minFilter && a.mipmapMode == b.mipmapMode
+		&& a.addressModeU == b.addressModeU && a.addressModeV == b.addressModeV && a.addressModeW == b.addressModeW
+		&& a.mipLodBias == b.mipLodBias && a.anisotropyEnable == b.anisotropyEnable && a.maxAnisotropy == b.maxAnisotropy
+		&& a.compareEnable == b.compareEnable && a.compareOp == b.compareOp && a.minLod == b.minLod && a.maxLod == b.maxLod
+		&& a.borderColor == b.borderColor && a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+}
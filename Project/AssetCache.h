@@ -0,0 +1,82 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <string>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include "vulkanbase/VulkanUtil.h"
+#include "Mesh.h"
+#include "Sampler.h"
+
+class TextureStreamer;
+
+//-----------------------------------------------------
+// AssetCache Class
+//-----------------------------------------------------
+// Hands out GPU resources by key so loading the same thing twice returns what is already there: textures by
+// file name, mesh geometry by file name and import options, samplers by their create info. The cache only
+// keeps weak references, the users share ownership and a resource goes once the last of them drops it.
+// Like the other Vulkan objects it is only used from the main thread.
+class AssetCache final
+{
+public:
+	AssetCache() = default;
+	~AssetCache() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	AssetCache(const AssetCache& other)					= delete;
+	AssetCache(AssetCache&& other) noexcept				= delete;
+	AssetCache& operator=(const AssetCache& other)		= delete;
+	AssetCache& operator=(AssetCache&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	// New textures are streamed, so they are registered with the streamer as they are created
+	void Initialize(const VulkanContext& context, TextureStreamer& textureStreamer);
+	void Cleanup();
+
+	std::shared_ptr<Texture> LoadTexture(const std::string& fileName);
+	std::shared_ptr<MeshAsset> LoadMesh(const std::string& fileName, const MeshImportOptions& options = {});
+	// pNext chains are not part of the key and must be null. Throws once the device's sampler limit would be exceeded.
+	std::shared_ptr<Sampler> GetSampler(const VkSamplerCreateInfo& createInfo);
+
+	// Keys seen so far, an entry whose resource is gone stays until the same key is loaded again
+	size_t GetTextureCount() const { return m_Textures.size(); }
+	size_t GetMeshCount() const { return m_Meshes.size(); }
+	size_t GetSamplerCount() const { return m_Samplers.size(); }
+
+private:
+	struct MeshKey
+	{
+		std::string fileName{};
+		MeshImportOptions options{};
+
+		bool operator==(const MeshKey& other) const = default;
+	};
+	struct MeshKeyHash
+	{
+		size_t operator()(const MeshKey& key) const;
+	};
+	struct SamplerEntry
+	{
+		VkSamplerCreateInfo createInfo{};
+		std::weak_ptr<Sampler> pSampler{};
+	};
+
+	static size_t HashSampler(const VkSamplerCreateInfo& createInfo);
+	static bool SamplersMatch(const VkSamplerCreateInfo& a, const VkSamplerCreateInfo& b);
+
+	VulkanContext m_Context{};
+	TextureStreamer* m_pTextureStreamer{ nullptr };
+	uint32_t m_MaxSamplers{ 0 };
+
+	std::unordered_map<std::string, std::weak_ptr<Texture>> m_Textures{};
+	std::unordered_map<MeshKey, std::weak_ptr<MeshAsset>, MeshKeyHash> m_Meshes{};
+	std::unordered_multimap<size_t, SamplerEntry> m_Samplers{};
+};
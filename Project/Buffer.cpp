@@ -2,30 +2,38 @@
 // Includes
 //---------------------------
 #include "Buffer.h"
+#include "ResidencyManager.h"
+#include "DeletionQueue.h"
 
 //---------------------------
 // Member functions
 //---------------------------
 
-Buffer::Buffer(VkPhysicalDevice physicalDevice, VkDevice device, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size)
+Buffer::Buffer(VkPhysicalDevice physicalDevice, VkDevice device, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size, const std::vector<uint32_t>& vQueueFamilies)
 	: m_VkDevice{ device }
 	, m_VkDeviceSize{ size }
 {
-	CreateBuffer(device, physicalDevice, size, usage, properties);
+	CreateBuffer(device, physicalDevice, size, usage, properties, vQueueFamilies);
 }
 
-Buffer::Buffer(VulkanContext context, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size)
-	: Buffer(context.physicalDevice, context.device, usage, properties, size)
+Buffer::Buffer(VulkanContext context, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size, const std::vector<uint32_t>& vQueueFamilies)
+	: Buffer(context.physicalDevice, context.device, usage, properties, size, vQueueFamilies)
 {
 }
 
-void Buffer::CreateBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+void Buffer::CreateBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, const std::vector<uint32_t>& vQueueFamilies)
 {
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	bufferInfo.size = size;
 	bufferInfo.usage = usage;
 	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vQueueFamilies.size() > 1)
+	{
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(vQueueFamilies.size());
+		bufferInfo.pQueueFamilyIndices = vQueueFamilies.data();
+	}
 
 	if (vkCreateBuffer(device, &bufferInfo, nullptr, &m_Buffer) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create vertex buffer!");
@@ -38,7 +46,7 @@ void Buffer::CreateBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkDe
 	allocInfo.allocationSize = memRequirements.size;
 	allocInfo.memoryTypeIndex = FindMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
 
-	if (vkAllocateMemory(device, &allocInfo, nullptr, &m_BufferMemory) != VK_SUCCESS) {
+	if (ResidencyManager::Get().Allocate(device, allocInfo, m_BufferMemory) != VK_SUCCESS) {
 		throw std::runtime_error("failed to allocate vertex buffer memory!");
 	}
 
@@ -53,6 +61,11 @@ void Buffer::Upload(void* data)
 	memcpy(m_UniformBufferMapped, data, m_VkDeviceSize);
 }
 
+void Buffer::Upload(const void* data, VkDeviceSize offset, VkDeviceSize size)
+{
+	memcpy(static_cast<char*>(m_UniformBufferMapped) + offset, data, size);
+}
+
 void Buffer::Map()
 {
 	vkMapMemory(m_VkDevice, m_BufferMemory, 0, m_VkDeviceSize, 0, &m_UniformBufferMapped);
@@ -86,6 +99,7 @@ void Buffer::BindAsIndexBuffer(VkCommandBuffer commandBuffer) const
 
 void Buffer::DestroyBuffer()
 {
-	vkDestroyBuffer(m_VkDevice, m_Buffer, nullptr);
-	vkFreeMemory(m_VkDevice, m_BufferMemory, nullptr);
+	// A frame still in flight may read the buffer, it goes once that frame is done
+	DeletionQueue::Get().Destroy(m_Buffer);
+	DeletionQueue::Get().Free(m_BufferMemory);
 }
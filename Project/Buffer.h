@@ -3,6 +3,7 @@
 //-----------------------------------------------------
 // Include Files
 //-----------------------------------------------------
+#include <vector>
 #include "vulkanbase/VulkanUtil.h"
 #include "Vertex.h"
 
@@ -17,13 +18,15 @@ public:
 		VkDevice device,
 		VkBufferUsageFlags usage,
 		VkMemoryPropertyFlags properties,
-		VkDeviceSize size
+		VkDeviceSize size,
+		const std::vector<uint32_t>& vQueueFamilies = {}
 	);
 	Buffer(
 		VulkanContext context,
 		VkBufferUsageFlags usage,
 		VkMemoryPropertyFlags properties,
-		VkDeviceSize size
+		VkDeviceSize size,
+		const std::vector<uint32_t>& vQueueFamilies = {}
 	);
 	~Buffer()
 	{
@@ -41,10 +44,12 @@ public:
 	//-------------------------------------------------
 	// Member functions						
 	//-------------------------------------------------
+	// More than one queue family makes the buffer concurrent between them, otherwise it is exclusive
 	void CreateBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize size, 
-		VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+		VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, const std::vector<uint32_t>& vQueueFamilies = {});
 
 	void Upload(void* data);
+	void Upload(const void* data, VkDeviceSize offset, VkDeviceSize size);
 	void Map();
 	void BindAsVertexBuffer(VkCommandBuffer commandBuffer, uint32_t binding = 0) const;
 	void BindAsIndexBuffer(VkCommandBuffer commandBuffer) const;
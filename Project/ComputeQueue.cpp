@@ -0,0 +1,129 @@
+//---------------------------
+// Includes
+//---------------------------
+#include "ComputeQueue.h"
+#include <algorithm>
+#include <stdexcept>
+
+//---------------------------
+// Member functions
+//---------------------------
+
+void ComputeQueue::Initialize(VkDevice device, VkQueue queue, uint32_t queueFamily, uint32_t graphicsFamily, uint32_t framesInFlight)
+{
+	m_Device = device;
+	m_Queue = queue;
+	m_QueueFamily = queueFamily;
+	m_GraphicsFamily = graphicsFamily;
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = queueFamily;
+
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &m_CommandPool) != VK_SUCCESS)
+		throw std::runtime_error("failed to create compute command pool!");
+
+	m_vCommandBuffers.resize(std::max(framesInFlight, 1u));
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = m_CommandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = static_cast<uint32_t>(m_vCommandBuffers.size());
+
+	if (vkAllocateCommandBuffers(device, &allocInfo, m_vCommandBuffers.data()) != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate compute command buffers!");
+
+	if (!IsAsync())
+		return;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	m_vComputeFinished.resize(m_vCommandBuffers.size());
+	m_vGraphicsFinished.resize(m_vCommandBuffers.size());
+	for (size_t i{}; i < m_vCommandBuffers.size(); ++i)
+	{
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &m_vComputeFinished[i]) != VK_SUCCESS ||
+			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &m_vGraphicsFinished[i]) != VK_SUCCESS)
+			throw std::runtime_error("failed to create compute semaphores!");
+	}
+}
+
+void ComputeQueue::Cleanup()
+{
+	vkQueueWaitIdle(m_Queue);
+
+	for (VkSemaphore semaphore : m_vComputeFinished)
+		vkDestroySemaphore(m_Device, semaphore, nullptr);
+	for (VkSemaphore semaphore : m_vGraphicsFinished)
+		vkDestroySemaphore(m_Device, semaphore, nullptr);
+	m_vComputeFinished.clear();
+	m_vGraphicsFinished.clear();
+
+	vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
+	m_vCommandBuffers.clear();
+}
+
+std::vector<uint32_t> ComputeQueue::GetSharedQueueFamilies() const
+{
+	if (!IsAsync())
+		return {};
+	return { m_GraphicsFamily, m_QueueFamily };
+}
+
+VkCommandBuffer ComputeQueue::BeginFrame()
+{
+	m_Frame = (m_Frame + 1) % static_cast<uint32_t>(m_vCommandBuffers.size());
+	const VkCommandBuffer commandBuffer = m_vCommandBuffers[m_Frame];
+	vkResetCommandBuffer(commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	return commandBuffer;
+}
+
+void ComputeQueue::Submit()
+{
+	const VkCommandBuffer commandBuffer = m_vCommandBuffers[m_Frame];
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	// The previous frame's graphics work read the buffers and wrote the images this frame's compute work overwrites and reads
+	const uint32_t frameCount = static_cast<uint32_t>(m_vCommandBuffers.size());
+	const VkSemaphore previousGraphicsFinished = IsAsync() ? m_vGraphicsFinished[(m_Frame + frameCount - 1) % frameCount] : VK_NULL_HANDLE;
+	const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	if (IsAsync() && !m_FirstFrame)
+	{
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = &previousGraphicsFinished;
+		submitInfo.pWaitDstStageMask = &waitStage;
+	}
+	if (IsAsync())
+	{
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &m_vComputeFinished[m_Frame];
+	}
+	m_FirstFrame = false;
+
+	if (vkQueueSubmit(m_Queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		throw std::runtime_error("failed to submit compute command buffer!");
+}
+
+VkSemaphore ComputeQueue::GetComputeFinishedSemaphore() const
+{
+	return IsAsync() ? m_vComputeFinished[m_Frame] : VK_NULL_HANDLE;
+}
+
+VkSemaphore ComputeQueue::GetGraphicsFinishedSemaphore() const
+{
+	return IsAsync() ? m_vGraphicsFinished[m_Frame] : VK_NULL_HANDLE;
+}
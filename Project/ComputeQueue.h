@@ -0,0 +1,62 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <vector>
+#include "vulkanbase/VulkanUtil.h"
+
+//-----------------------------------------------------
+// ComputeQueue Class
+//-----------------------------------------------------
+// Compute work that only depends on earlier frames, recorded into its own per-frame command buffer and submitted
+// ahead of the graphics work. On an async compute family it runs next to rendering: the graphics submit waits
+// on the compute one, and the next compute submit waits on that graphics submit before it touches what it read.
+// Without a separate family the command buffers go to the graphics queue, where submission order and the
+// barriers recorded by the work itself are enough.
+class ComputeQueue final
+{
+public:
+	ComputeQueue() = default;
+	~ComputeQueue() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	ComputeQueue(const ComputeQueue& other)					= delete;
+	ComputeQueue(ComputeQueue&& other) noexcept				= delete;
+	ComputeQueue& operator=(const ComputeQueue& other)		= delete;
+	ComputeQueue& operator=(ComputeQueue&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	void Initialize(VkDevice device, VkQueue queue, uint32_t queueFamily, uint32_t graphicsFamily, uint32_t framesInFlight = 1);
+	void Cleanup();
+
+	bool IsAsync() const { return m_QueueFamily != m_GraphicsFamily; }
+	// Resources both queues use have to be created concurrent between these, empty when there is only one family
+	std::vector<uint32_t> GetSharedQueueFamilies() const;
+
+	// Resets and begins the next frame's command buffer, the frame that used it before has to be finished
+	VkCommandBuffer BeginFrame();
+	// Always submits, even an empty command buffer, so every graphics submit has exactly one compute submit to wait on
+	void Submit();
+
+	// Graphics side, VK_NULL_HANDLE without an async family. The frame's submit waits on the first and signals the second.
+	VkSemaphore GetComputeFinishedSemaphore() const;
+	VkSemaphore GetGraphicsFinishedSemaphore() const;
+
+private:
+	VkDevice m_Device{};
+	VkQueue m_Queue{};
+	uint32_t m_QueueFamily{ 0 };
+	uint32_t m_GraphicsFamily{ 0 };
+	VkCommandPool m_CommandPool{};
+
+	std::vector<VkCommandBuffer> m_vCommandBuffers{};
+	std::vector<VkSemaphore> m_vComputeFinished{};
+	std::vector<VkSemaphore> m_vGraphicsFinished{};
+	uint32_t m_Frame{ 0 };
+	bool m_FirstFrame{ true };	// no graphics submit has signalled anything yet
+};
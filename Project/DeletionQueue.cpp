@@ -0,0 +1,78 @@
+//---------------------------
+// Includes
+//---------------------------
+#include "DeletionQueue.h"
+#include "ResidencyManager.h"
+
+//---------------------------
+// Member functions
+//---------------------------
+
+DeletionQueue& DeletionQueue::Get()
+{
+	static DeletionQueue deletionQueue{};
+	return deletionQueue;
+}
+
+void DeletionQueue::Initialize(VkDevice device)
+{
+	m_Device = device;
+}
+
+void DeletionQueue::Destroy(VkBuffer buffer)
+{
+	if (buffer != VK_NULL_HANDLE)
+		Defer([device = m_Device, buffer]() { vkDestroyBuffer(device, buffer, nullptr); });
+}
+
+void DeletionQueue::Destroy(VkImage image)
+{
+	if (image != VK_NULL_HANDLE)
+		Defer([device = m_Device, image]() { vkDestroyImage(device, image, nullptr); });
+}
+
+void DeletionQueue::Destroy(VkImageView view)
+{
+	if (view != VK_NULL_HANDLE)
+		Defer([device = m_Device, view]() { vkDestroyImageView(device, view, nullptr); });
+}
+
+void DeletionQueue::Destroy(VkSampler sampler)
+{
+	if (sampler != VK_NULL_HANDLE)
+		Defer([device = m_Device, sampler]() { vkDestroySampler(device, sampler, nullptr); });
+}
+
+void DeletionQueue::Destroy(VkPipelineLayout pipelineLayout)
+{
+	if (pipelineLayout != VK_NULL_HANDLE)
+		Defer([device = m_Device, pipelineLayout]() { vkDestroyPipelineLayout(device, pipelineLayout, nullptr); });
+}
+
+void DeletionQueue::Free(VkDeviceMemory memory)
+{
+	if (memory != VK_NULL_HANDLE)
+		Defer([device = m_Device, memory]() { ResidencyManager::Get().Free(device, memory); });
+}
+
+void DeletionQueue::Defer(std::function<void()>&& destroy)
+{
+	m_Entries.push_back({ ResidencyManager::Get().GetFrameIndex(), std::move(destroy) });
+}
+
+void DeletionQueue::Flush(uint64_t completedFrame)
+{
+	m_CompletedFrame = completedFrame;
+	while (!m_Entries.empty() && m_Entries.front().frame <= completedFrame)
+	{
+		// Popped first, a destroy that queues something else must not see itself again
+		std::function<void()> destroy = std::move(m_Entries.front().destroy);
+		m_Entries.pop_front();
+		destroy();
+	}
+}
+
+void DeletionQueue::Flush()
+{
+	Flush(UINT64_MAX);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <deque>
+#include <functional>
+#include "vulkanbase/VulkanUtil.h"
+
+//-----------------------------------------------------
+// DeletionQueue Class
+//-----------------------------------------------------
+// Vulkan objects that a submitted frame may still use are parked here instead of destroyed. Each is tagged with
+// the residency manager's frame index at the time it was queued, which no later frame can have recorded it in,
+// and goes once the fence of that frame has signaled. Frame indices only go up, so the queue stays sorted.
+// Like the residency manager it is only used from the main thread.
+class DeletionQueue final
+{
+public:
+	DeletionQueue() = default;
+	~DeletionQueue() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	DeletionQueue(const DeletionQueue& other)					= delete;
+	DeletionQueue(DeletionQueue&& other) noexcept				= delete;
+	DeletionQueue& operator=(const DeletionQueue& other)		= delete;
+	DeletionQueue& operator=(DeletionQueue&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	static DeletionQueue& Get();
+
+	void Initialize(VkDevice device);
+
+	void Destroy(VkBuffer buffer);
+	void Destroy(VkImage image);
+	void Destroy(VkImageView view);
+	void Destroy(VkSampler sampler);
+	void Destroy(VkPipelineLayout pipelineLayout);
+	// Goes through the residency manager, so the memory counts against its heap until it is really freed
+	void Free(VkDeviceMemory memory);
+	// Anything else that has to wait for the current frame, e.g. handing a descriptor set back to its cache
+	void Defer(std::function<void()>&& destroy);
+
+	// Runs everything queued up to and including completedFrame, whose fence has to have signaled
+	void Flush(uint64_t completedFrame);
+	// Runs everything, only once the device is idle
+	void Flush();
+
+	// Last frame passed to Flush(), objects tagged with it or earlier are no longer in use
+	uint64_t GetCompletedFrame() const { return m_CompletedFrame; }
+	size_t GetPendingCount() const { return m_Entries.size(); }
+
+private:
+	struct Entry
+	{
+		uint64_t frame{ 0 };
+		std::function<void()> destroy{};
+	};
+
+	VkDevice m_Device{};
+	std::deque<Entry> m_Entries{};
+	uint64_t m_CompletedFrame{ 0 };
+};
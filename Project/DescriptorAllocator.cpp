@@ -0,0 +1,286 @@
+//---------------------------
+// Includes
+//---------------------------
+#include "DescriptorAllocator.h"
+#include <algorithm>
+#include <stdexcept>
+#include "Hash.h"
+#include "DeletionQueue.h"
+#include "ResidencyManager.h"
+
+namespace
+{
+	// Each new pool is half again as large as the previous one, capped so one pool never gets absurdly big
+	constexpr uint32_t maxSetsPerPool{ 4096 };
+
+	bool IsBufferDescriptor(VkDescriptorType type)
+	{
+		return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+			type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	}
+}
+
+//---------------------------
+// DescriptorAllocator
+//---------------------------
+
+void DescriptorAllocator::Initialize(VkDevice device, const std::vector<DescriptorPoolRatio>& vRatios, uint32_t initialSetsPerPool, VkDescriptorPoolCreateFlags flags)
+{
+	m_Device = device;
+	m_vRatios = vRatios;
+	m_Flags = flags;
+	m_SetsPerPool = std::max(initialSetsPerPool, 1u);
+
+	m_vReadyPools.push_back(CreatePool(m_SetsPerPool));
+}
+
+void DescriptorAllocator::Cleanup()
+{
+	for (VkDescriptorPool pool : m_vFullPools)
+		vkDestroyDescriptorPool(m_Device, pool, nullptr);
+	for (VkDescriptorPool pool : m_vReadyPools)
+		vkDestroyDescriptorPool(m_Device, pool, nullptr);
+	m_vFullPools.clear();
+	m_vReadyPools.clear();
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout, const void* pNext)
+{
+	VkDescriptorPool pool = GrabPool();
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.pNext = pNext;
+	allocInfo.descriptorPool = pool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet set{};
+	VkResult result = vkAllocateDescriptorSets(m_Device, &allocInfo, &set);
+
+	// A full pool is parked until the next reset and the allocation is retried once on a fresh one
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+	{
+		m_vFullPools.push_back(pool);
+		m_vReadyPools.pop_back();
+
+		allocInfo.descriptorPool = GrabPool();
+		result = vkAllocateDescriptorSets(m_Device, &allocInfo, &set);
+	}
+	if (result != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate descriptor set!");
+
+	return set;
+}
+
+void DescriptorAllocator::Reset()
+{
+	for (VkDescriptorPool pool : m_vReadyPools)
+		vkResetDescriptorPool(m_Device, pool, 0);
+	for (VkDescriptorPool pool : m_vFullPools)
+	{
+		vkResetDescriptorPool(m_Device, pool, 0);
+		m_vReadyPools.push_back(pool);
+	}
+	m_vFullPools.clear();
+}
+
+VkDescriptorPool DescriptorAllocator::GrabPool()
+{
+	if (m_vReadyPools.empty())
+	{
+		m_SetsPerPool = std::min(m_SetsPerPool + m_SetsPerPool / 2, maxSetsPerPool);
+		m_vReadyPools.push_back(CreatePool(m_SetsPerPool));
+	}
+	return m_vReadyPools.back();
+}
+
+VkDescriptorPool DescriptorAllocator::CreatePool(uint32_t setCount) const
+{
+	std::vector<VkDescriptorPoolSize> poolSizes{};
+	poolSizes.reserve(m_vRatios.size());
+	for (const DescriptorPoolRatio& ratio : m_vRatios)
+		poolSizes.push_back({ ratio.type, std::max(static_cast<uint32_t>(ratio.ratio * setCount), 1u) });
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = m_Flags;
+	poolInfo.maxSets = setCount;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool pool{};
+	if (vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+		throw std::runtime_error("failed to create descriptor pool!");
+	return pool;
+}
+
+//---------------------------
+// TransientDescriptorAllocator
+//---------------------------
+
+void TransientDescriptorAllocator::Initialize(VkDevice device, const std::vector<DescriptorPoolRatio>& vRatios, uint32_t initialSetsPerPool, uint32_t framesInFlight)
+{
+	m_vFrames.resize(std::max(framesInFlight, 1u));
+	for (std::unique_ptr<DescriptorAllocator>& pFrame : m_vFrames)
+	{
+		pFrame = std::make_unique<DescriptorAllocator>();
+		pFrame->Initialize(device, vRatios, initialSetsPerPool);
+	}
+	m_Frame = 0;
+}
+
+void TransientDescriptorAllocator::Cleanup()
+{
+	for (std::unique_ptr<DescriptorAllocator>& pFrame : m_vFrames)
+		pFrame->Cleanup();
+	m_vFrames.clear();
+}
+
+void TransientDescriptorAllocator::BeginFrame()
+{
+	m_Frame = (m_Frame + 1) % static_cast<uint32_t>(m_vFrames.size());
+	m_vFrames[m_Frame]->Reset();
+}
+
+//---------------------------
+// DescriptorSetCache
+//---------------------------
+
+void DescriptorSetCache::Initialize(VkDevice device, const std::vector<DescriptorPoolRatio>& vRatios, uint32_t initialSetsPerPool)
+{
+	m_Device = device;
+	m_Allocator.Initialize(device, vRatios, initialSetsPerPool);
+}
+
+void DescriptorSetCache::Cleanup()
+{
+	m_Entries.clear();
+	m_SetHashes.clear();
+	m_FreeSets.clear();
+	m_RetiredSets.clear();
+	m_Allocator.Cleanup();
+}
+
+VkDescriptorSet DescriptorSetCache::Acquire(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& vBindings)
+{
+	const size_t hash = Hash(layout, vBindings);
+	auto [begin, end] = m_Entries.equal_range(hash);
+	for (auto it = begin; it != end; ++it)
+	{
+		if (Matches(it->second, layout, vBindings))
+		{
+			++it->second.refCount;
+			return it->second.set;
+		}
+	}
+
+	RecycleRetiredSets();
+
+	VkDescriptorSet set{};
+	std::vector<VkDescriptorSet>& vFreeSets = m_FreeSets[layout];
+	if (!vFreeSets.empty())
+	{
+		set = vFreeSets.back();
+		vFreeSets.pop_back();
+	}
+	else
+		set = m_Allocator.Allocate(layout);
+
+	Write(set, vBindings);
+	m_Entries.emplace(hash, Entry{ layout, vBindings, set, 1 });
+	m_SetHashes.emplace(set, hash);
+	return set;
+}
+
+void DescriptorSetCache::Release(VkDescriptorSet set)
+{
+	const auto hashIt = m_SetHashes.find(set);
+	if (hashIt == m_SetHashes.end())
+		return;
+
+	auto [begin, end] = m_Entries.equal_range(hashIt->second);
+	for (auto it = begin; it != end; ++it)
+	{
+		if (it->second.set != set)
+			continue;
+
+		if (--it->second.refCount == 0)
+		{
+			m_RetiredSets.push_back({ ResidencyManager::Get().GetFrameIndex(), it->second.layout, set });
+			m_Entries.erase(it);
+			m_SetHashes.erase(hashIt);
+		}
+		return;
+	}
+}
+
+void DescriptorSetCache::RecycleRetiredSets()
+{
+	const uint64_t completedFrame = DeletionQueue::Get().GetCompletedFrame();
+	while (!m_RetiredSets.empty() && m_RetiredSets.front().frame <= completedFrame)
+	{
+		m_FreeSets[m_RetiredSets.front().layout].push_back(m_RetiredSets.front().set);
+		m_RetiredSets.pop_front();
+	}
+}
+
+size_t DescriptorSetCache::Hash(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& vBindings)
+{
+	size_t seed{ 0 };
+	HashCombine(seed, layout);
+	for (const DescriptorBinding& binding : vBindings)
+	{
+		HashCombine(seed, binding.binding);
+		HashCombine(seed, static_cast<uint32_t>(binding.type));
+		if (IsBufferDescriptor(binding.type))
+		{
+			HashCombine(seed, binding.bufferInfo.buffer);
+			HashCombine(seed, binding.bufferInfo.offset);
+			HashCombine(seed, binding.bufferInfo.range);
+		}
+		else
+		{
+			HashCombine(seed, binding.imageInfo.imageView);
+			HashCombine(seed, binding.imageInfo.sampler);
+			HashCombine(seed, static_cast<uint32_t>(binding.imageInfo.imageLayout));
+		}
+	}
+	return seed;
+}
+
+bool DescriptorSetCache::Matches(const Entry& entry, VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& vBindings)
+{
+	if (entry.layout != layout || entry.vBindings.size() != vBindings.size())
+		return false;
+
+	return std::equal(vBindings.begin(), vBindings.end(), entry.vBindings.begin(), [](const DescriptorBinding& a, const DescriptorBinding& b)
+		{
+			if (a.binding != b.binding || a.type != b.type)
+				return false;
+			if (IsBufferDescriptor(a.type))
+				return a.bufferInfo.buffer == b.bufferInfo.buffer && a.bufferInfo.offset == b.bufferInfo.offset && a.bufferInfo.range == b.bufferInfo.range;
+			return a.imageInfo.imageView == b.imageInfo.imageView && a.imageInfo.sampler == b.imageInfo.sampler && a.imageInfo.imageLayout == b.imageInfo.imageLayout;
+		});
+}
+
+void DescriptorSetCache::Write(VkDescriptorSet set, const std::vector<DescriptorBinding>& vBindings) const
+{
+	std::vector<VkWriteDescriptorSet> vWrites(vBindings.size());
+	for (size_t i{}; i < vBindings.size(); ++i)
+	{
+		const DescriptorBinding& binding = vBindings[i];
+		VkWriteDescriptorSet& descriptorWrite = vWrites[i];
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = set;
+		descriptorWrite.dstBinding = binding.binding;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = binding.type;
+		descriptorWrite.descriptorCount = 1;
+		if (IsBufferDescriptor(binding.type))
+			descriptorWrite.pBufferInfo = &binding.bufferInfo;
+		else
+			descriptorWrite.pImageInfo = &binding.imageInfo;
+	}
+	vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(vWrites.size()), vWrites.data(), 0, nullptr);
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include "vulkanbase/VulkanUtil.h"
+
+// How many descriptors of a type a pool gets per set it is sized for
+struct DescriptorPoolRatio
+{
+	VkDescriptorType type{};
+	float ratio{ 1.f };
+};
+
+// One binding of a cached set, only the info matching the type is written and compared
+struct DescriptorBinding
+{
+	uint32_t binding{ 0 };
+	VkDescriptorType type{};
+	VkDescriptorBufferInfo bufferInfo{};
+	VkDescriptorImageInfo imageInfo{};
+};
+
+//-----------------------------------------------------
+// DescriptorAllocator Class
+//-----------------------------------------------------
+// Hands out descriptor sets from a chain of pools. When the current pool runs out another one is added, each
+// larger than the last up to a cap, so allocating stays amortized O(1) however many sets a scene ends up needing.
+// Sets are not freed one by one, Reset() returns all of them at once and keeps the pools for reuse.
+class DescriptorAllocator final
+{
+public:
+	DescriptorAllocator() = default;
+	~DescriptorAllocator() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	DescriptorAllocator(const DescriptorAllocator& other)					= delete;
+	DescriptorAllocator(DescriptorAllocator&& other) noexcept				= delete;
+	DescriptorAllocator& operator=(const DescriptorAllocator& other)		= delete;
+	DescriptorAllocator& operator=(DescriptorAllocator&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	void Initialize(VkDevice device, const std::vector<DescriptorPoolRatio>& vRatios, uint32_t initialSetsPerPool, VkDescriptorPoolCreateFlags flags = 0);
+	void Cleanup();
+
+	// pNext is chained into the allocate info, e.g. for variable descriptor counts
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout, const void* pNext = nullptr);
+	// Every set allocated so far becomes invalid, none of them may still be in flight
+	void Reset();
+
+	size_t GetPoolCount() const { return m_vFullPools.size() + m_vReadyPools.size(); }
+
+private:
+	VkDescriptorPool GrabPool();
+	VkDescriptorPool CreatePool(uint32_t setCount) const;
+
+	VkDevice m_Device{};
+	std::vector<DescriptorPoolRatio> m_vRatios{};
+	VkDescriptorPoolCreateFlags m_Flags{ 0 };
+	uint32_t m_SetsPerPool{ 0 };
+
+	std::vector<VkDescriptorPool> m_vFullPools{};
+	std::vector<VkDescriptorPool> m_vReadyPools{};
+};
+
+//-----------------------------------------------------
+// TransientDescriptorAllocator Class
+//-----------------------------------------------------
+// One growable allocator per frame in flight for sets that are only used by the frame that allocated them.
+// Nothing is tracked per set, the whole frame's pools are reset in one go when the frame comes around again.
+class TransientDescriptorAllocator final
+{
+public:
+	TransientDescriptorAllocator() = default;
+	~TransientDescriptorAllocator() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	TransientDescriptorAllocator(const TransientDescriptorAllocator& other)					= delete;
+	TransientDescriptorAllocator(TransientDescriptorAllocator&& other) noexcept				= delete;
+	TransientDescriptorAllocator& operator=(const TransientDescriptorAllocator& other)		= delete;
+	TransientDescriptorAllocator& operator=(TransientDescriptorAllocator&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	void Initialize(VkDevice device, const std::vector<DescriptorPoolRatio>& vRatios, uint32_t initialSetsPerPool, uint32_t framesInFlight);
+	void Cleanup();
+
+	// Moves on to the next frame's pools and resets them, the frame that used them before has to be finished
+	void BeginFrame();
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout) { return m_vFrames[m_Frame]->Allocate(layout); }
+
+private:
+	std::vector<std::unique_ptr<DescriptorAllocator>> m_vFrames{};
+	uint32_t m_Frame{ 0 };
+};
+
+//-----------------------------------------------------
+// DescriptorSetCache Class
+//-----------------------------------------------------
+// Sets that are written once and never changed, looked up by a hash of their layout and bindings so every
+// user asking for the same buffer/texture combination gets the same set. Sets are reference counted, one
+// nobody holds any more is rewritten for the next new combination with the same layout instead of leaking.
+class DescriptorSetCache final
+{
+public:
+	DescriptorSetCache() = default;
+	~DescriptorSetCache() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	DescriptorSetCache(const DescriptorSetCache& other)					= delete;
+	DescriptorSetCache(DescriptorSetCache&& other) noexcept				= delete;
+	DescriptorSetCache& operator=(const DescriptorSetCache& other)		= delete;
+	DescriptorSetCache& operator=(DescriptorSetCache&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	void Initialize(VkDevice device, const std::vector<DescriptorPoolRatio>& vRatios, uint32_t initialSetsPerPool);
+	void Cleanup();
+
+	// Every call has to be matched by a Release() once the caller stops using the set
+	VkDescriptorSet Acquire(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& vBindings);
+	// The set may still be in flight, it is only reused for another combination once the current frame is done
+	void Release(VkDescriptorSet set);
+
+	size_t GetSetCount() const { return m_Entries.size(); }
+
+private:
+	struct Entry
+	{
+		VkDescriptorSetLayout layout{};
+		std::vector<DescriptorBinding> vBindings{};
+		VkDescriptorSet set{};
+		uint32_t refCount{ 0 };
+	};
+
+	struct RetiredSet
+	{
+		uint64_t frame{ 0 };
+		VkDescriptorSetLayout layout{};
+		VkDescriptorSet set{};
+	};
+
+	static size_t Hash(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& vBindings);
+	static bool Matches(const Entry& entry, VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& vBindings);
+	void Write(VkDescriptorSet set, const std::vector<DescriptorBinding>& vBindings) const;
+	// Moves released sets whose frame finished to the free lists
+	void RecycleRetiredSets();
+
+	VkDevice m_Device{};
+	DescriptorAllocator m_Allocator{};
+	std::unordered_multimap<size_t, Entry> m_Entries{};
+	std::unordered_map<VkDescriptorSet, size_t> m_SetHashes{};
+	std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> m_FreeSets{};
+	std::deque<RetiredSet> m_RetiredSets{};
+};
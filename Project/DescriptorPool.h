@@ -3,127 +3,265 @@
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include <array>
 #include "Buffer.h"
 #include "UniformBufferObject.h"
 #include "Texture.h"
+#include "DescriptorAllocator.h"
 template<class UBO>
 class DescriptorPool
 {
 public:
-	DescriptorPool(VkDevice device, size_t count);
+	// A bindless texture count above 0 puts every texture in one partially bound array in a single set
+	explicit DescriptorPool(VkDevice device, uint32_t bindlessTextureCount = 0);
 	~DescriptorPool();
 
 	template<typename Mesh>
-	void Initialize(const VulkanContext& context, std::vector<std::unique_ptr<Mesh>>& vMeshes);
-	void SetUBO(UBO data, size_t index);
-	const VkDescriptorSetLayout& GetDescriptorSetLayout(){ return m_DescriptorSetLayout; }
+	void Initialize(const VulkanContext& context, std::vector<std::unique_ptr<Mesh>>& vMeshes, size_t meshCount);
+	// Gives the meshes before meshCount that were added since the last call their texture, a new cached set or a free
+	// array slot when bindless. Meshes from meshCount on are still waiting to be initialized.
 	template<typename Mesh>
-	void CreateDescriptorSets(std::vector<std::unique_ptr<Mesh>>& vMeshes);
+	void AddMeshes(std::vector<std::unique_ptr<Mesh>>& vMeshes, size_t meshCount);
+	// Fills the mesh's place with the last mesh, like the pipeline does. A texture without meshes left is forgotten
+	// and its set released, so the texture itself may be destroyed right after.
+	void RemoveMesh(size_t meshIndex);
+	// Rewrites the textures whose image view got replaced since they were last written, e.g. by streaming in a mip
+	void RefreshTextures();
+	void SetUBO(UBO data);
+	const VkDescriptorSetLayout& GetDescriptorSetLayout(){ return m_DescriptorSetLayout; }
 	void BindDescriptorSet(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, size_t index);
+
+	// Meshes that use the same texture share one descriptor set, bindless meshes all share one and index the array instead
+	bool IsBindless() const { return m_BindlessTextureCount > 0; }
+	size_t GetDescriptorSetCount() const { return m_vDescriptorSets.size(); }
+	size_t GetMeshDescriptorSetIndex(size_t meshIndex) const { return IsBindless() ? 0 : m_vMeshTextureIndices[meshIndex]; }
+	uint32_t GetMeshTextureIndex(size_t meshIndex) const { return IsBindless() ? static_cast<uint32_t>(m_vMeshTextureIndices[meshIndex]) : 0; }
 private:
 	VkDevice m_Device;
 	VkDeviceSize m_Size;
 	VkDescriptorSetLayout m_DescriptorSetLayout;
 
 	void CreateDescriptorSetLayout(const VulkanContext& context);
-	void CreateUBOs(const VulkanContext& context);
+	// Returns the texture slots that were not in use before
+	template<typename Mesh>
+	std::vector<size_t> AssignTextures(std::vector<std::unique_ptr<Mesh>>& vMeshes, size_t meshCount);
+	size_t AllocateTextureSlot();
+	void CreateBindlessSet();
+	// Every set holds the same view projection, so they differ by texture only
+	std::vector<DescriptorBinding> GetBindings(size_t textureIndex) const;
+	void WriteTexture(VkDescriptorSet set, size_t textureIndex, uint32_t arrayElement);
 
-	VkDescriptorPool m_DescriptorPool;
+	// The bindless set comes from its own update after bind pool, all others from the cache
+	DescriptorAllocator m_BindlessAllocator{};
+	DescriptorSetCache m_SetCache{};
 	std::vector<VkDescriptorSet> m_vDescriptorSets{};
-	std::vector<UniformBufferObjectPtr<UBO>> m_vUBOs;
+	UniformBufferObjectPtr<UBO> m_UBO{};
+	std::unordered_map<const Texture*, size_t> m_TextureIndices{};
+	std::vector<const Texture*> m_vTextures{};		// null for a free slot
+	std::vector<uint32_t> m_vTextureVersions{};
+	std::vector<uint32_t> m_vTextureUsers{};		// meshes per texture slot
+	std::vector<size_t> m_vFreeTextureSlots{};
+	std::vector<size_t> m_vMeshTextureIndices{};
 
-	size_t m_Count;
+	uint32_t m_BindlessTextureCount{ 0 };
 };
 
 template<class UBO>
-inline DescriptorPool<UBO>::DescriptorPool(VkDevice device, size_t count)
+inline DescriptorPool<UBO>::DescriptorPool(VkDevice device, uint32_t bindlessTextureCount)
 	: m_Device{ device }
 	, m_Size{ sizeof(UBO) }
-	, m_Count(count)
-	, m_DescriptorPool{ nullptr }
+	, m_BindlessTextureCount{ bindlessTextureCount }
 	, m_DescriptorSetLayout{ nullptr }
 {
-	std::vector<VkDescriptorPoolSize> poolSizes(2);
-	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = static_cast<uint32_t>(count);
-	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[1].descriptorCount = static_cast<uint32_t>(count);
-
-	VkDescriptorPoolCreateInfo poolInfo{};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = static_cast<uint32_t>(count);
-
-	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS)
-		throw std::runtime_error("failed to create descriptor pool!");
 }
 
 template <class UBO>
 DescriptorPool<UBO>::~DescriptorPool()
 {
-	for (UniformBufferObjectPtr<UBO>& buffer : m_vUBOs)
-		buffer.reset();
+	m_UBO.reset();
+	m_SetCache.Cleanup();
+	m_BindlessAllocator.Cleanup();
 	vkDestroyDescriptorSetLayout(m_Device, m_DescriptorSetLayout, nullptr);
-	vkDestroyDescriptorPool(m_Device, m_DescriptorPool, nullptr);
 }
 
 template<class UBO>
 template<typename Mesh>
-inline void DescriptorPool<UBO>::Initialize(const VulkanContext& context, std::vector<std::unique_ptr<Mesh>>& vMeshes)
+inline void DescriptorPool<UBO>::Initialize(const VulkanContext& context, std::vector<std::unique_ptr<Mesh>>& vMeshes, size_t meshCount)
 {
 	CreateDescriptorSetLayout(context);
-	CreateUBOs(context);
-	CreateDescriptorSets(vMeshes);
+
+	m_UBO = std::make_unique<UniformBufferObject<UBO>>();
+	m_UBO->Initialize(context);
+
+	// Pools start small and chain as textures get added, so nothing has to be sized to the scene up front
+	m_SetCache.Initialize(m_Device, { { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f }, { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.f } }, 16);
+	if (IsBindless())
+		CreateBindlessSet();
+
+	AddMeshes(vMeshes, meshCount);
+}
+
+template<class UBO>
+template<typename Mesh>
+inline void DescriptorPool<UBO>::AddMeshes(std::vector<std::unique_ptr<Mesh>>& vMeshes, size_t meshCount)
+{
+	// Slots are only written from the pipeline's Update(), after the frame fence, so no submitted work uses the set.
+	// Update after bind allows writes after the set was bound in a command buffer that has not been submitted yet.
+	// Writes while a submission is pending would also need UPDATE_UNUSED_WHILE_PENDING, which the layout does not request.
+	for (size_t i : AssignTextures(vMeshes, meshCount))
+	{
+		if (IsBindless())
+			WriteTexture(m_vDescriptorSets[0], i, static_cast<uint32_t>(i));
+		else
+			m_vDescriptorSets[i] = m_SetCache.Acquire(m_DescriptorSetLayout, GetBindings(i));
+	}
+}
+
+template <class UBO>
+void DescriptorPool<UBO>::RemoveMesh(size_t meshIndex)
+{
+	const size_t textureIndex = m_vMeshTextureIndices[meshIndex];
+	m_vMeshTextureIndices[meshIndex] = m_vMeshTextureIndices.back();
+	m_vMeshTextureIndices.pop_back();
+
+	if (--m_vTextureUsers[textureIndex] > 0)
+		return;
+
+	// A stale bindless slot is never indexed again until it is rewritten, the array is partially bound
+	m_TextureIndices.erase(m_vTextures[textureIndex]);
+	m_vTextures[textureIndex] = nullptr;
+	if (!IsBindless())
+	{
+		m_SetCache.Release(m_vDescriptorSets[textureIndex]);
+		m_vDescriptorSets[textureIndex] = VK_NULL_HANDLE;
+	}
+	m_vFreeTextureSlots.push_back(textureIndex);
+}
+
+template <class UBO>
+void DescriptorPool<UBO>::RefreshTextures()
+{
+	for (size_t i = 0; i < m_vTextures.size(); ++i)
+	{
+		if (!m_vTextures[i] || m_vTextureVersions[i] == m_vTextures[i]->GetViewVersion())
+			continue;
+
+		// Cached sets are never rewritten in place, another texture with the same view may share it
+		if (IsBindless())
+			WriteTexture(m_vDescriptorSets[0], i, static_cast<uint32_t>(i));
+		else
+		{
+			m_SetCache.Release(m_vDescriptorSets[i]);
+			m_vDescriptorSets[i] = m_SetCache.Acquire(m_DescriptorSetLayout, GetBindings(i));
+			m_vTextureVersions[i] = m_vTextures[i]->GetViewVersion();
+		}
+	}
 }
 
 template <class UBO>
 template<typename Mesh>
-void DescriptorPool<UBO>::CreateDescriptorSets(std::vector<std::unique_ptr<Mesh>>& vMeshes)
+std::vector<size_t> DescriptorPool<UBO>::AssignTextures(std::vector<std::unique_ptr<Mesh>>& vMeshes, size_t meshCount)
+{
+	std::vector<size_t> vNewTextures{};
+	for (size_t i = m_vMeshTextureIndices.size(); i < meshCount; ++i)
+	{
+		const Texture* pTexture = vMeshes[i]->GetTexture();
+		auto it = m_TextureIndices.find(pTexture);
+		if (it == m_TextureIndices.end())
+		{
+			const size_t textureIndex = AllocateTextureSlot();
+			m_vTextures[textureIndex] = pTexture;
+			m_vTextureVersions[textureIndex] = pTexture->GetViewVersion();
+			it = m_TextureIndices.emplace(pTexture, textureIndex).first;
+			vNewTextures.push_back(textureIndex);
+		}
+		++m_vTextureUsers[it->second];
+		m_vMeshTextureIndices.push_back(it->second);
+	}
+	return vNewTextures;
+}
+
+template <class UBO>
+size_t DescriptorPool<UBO>::AllocateTextureSlot()
 {
-	std::vector<VkDescriptorSetLayout> layouts(m_Count, m_DescriptorSetLayout);
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = m_DescriptorPool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(m_Count);
-	allocInfo.pSetLayouts = layouts.data();
-
-	m_vDescriptorSets.resize(m_Count);
-	if (vkAllocateDescriptorSets(m_Device, &allocInfo, m_vDescriptorSets.data()) != VK_SUCCESS)
-		throw std::runtime_error("failed to allocate descriptor sets!");
-
-	for (size_t i = 0; i < vMeshes.size(); ++i) 
+	// Slots of removed textures are reused first, so the bindless array only grows with the textures alive at once
+	if (!m_vFreeTextureSlots.empty())
 	{
-		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = m_vUBOs[i]->GetVkBuffer();
-		bufferInfo.offset = 0;
-		bufferInfo.range = m_Size;
-
-		std::vector<VkWriteDescriptorSet> descriptorWrites(2);
-		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[0].dstSet = m_vDescriptorSets[i];
-		descriptorWrites[0].dstBinding = 0;
-		descriptorWrites[0].dstArrayElement = 0;
-		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrites[0].descriptorCount = 1;
-		descriptorWrites[0].pBufferInfo = &bufferInfo;
-		auto pTexture = vMeshes[i]->GetTexture();
-
-		VkDescriptorImageInfo imageInfo = {};
-		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageInfo.imageView = pTexture->GetTextureImageView();
-		imageInfo.sampler = pTexture->GetTextureSampler();
-
-		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[1].dstSet = m_vDescriptorSets[i];
-		descriptorWrites[1].dstBinding = 1;
-		descriptorWrites[1].dstArrayElement = 0;
-		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptorWrites[1].descriptorCount = 1;
-		descriptorWrites[1].pImageInfo = &imageInfo;
-
-		vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+		const size_t textureIndex = m_vFreeTextureSlots.back();
+		m_vFreeTextureSlots.pop_back();
+		return textureIndex;
 	}
+
+	if (IsBindless() && m_vTextures.size() >= m_BindlessTextureCount)
+		throw std::runtime_error("bindless texture array is full!");
+	m_vTextures.push_back(nullptr);
+	m_vTextureVersions.push_back(0);
+	m_vTextureUsers.push_back(0);
+	if (!IsBindless())
+		m_vDescriptorSets.push_back(VK_NULL_HANDLE);
+	return m_vTextures.size() - 1;
+}
+
+template <class UBO>
+void DescriptorPool<UBO>::CreateBindlessSet()
+{
+	m_BindlessAllocator.Initialize(m_Device, { { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f }, { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, static_cast<float>(m_BindlessTextureCount) } }, 1, VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT);
+	m_vDescriptorSets.push_back(m_BindlessAllocator.Allocate(m_DescriptorSetLayout));
+
+	// Slots past the last texture stay unwritten, the array is partially bound
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = m_UBO->GetVkBuffer();
+	bufferInfo.offset = 0;
+	bufferInfo.range = m_Size;
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = m_vDescriptorSets[0];
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(m_Device, 1, &descriptorWrite, 0, nullptr);
+}
+
+template <class UBO>
+std::vector<DescriptorBinding> DescriptorPool<UBO>::GetBindings(size_t textureIndex) const
+{
+	const Texture* pTexture = m_vTextures[textureIndex];
+
+	std::vector<DescriptorBinding> vBindings(2);
+	vBindings[0].binding = 0;
+	vBindings[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	vBindings[0].bufferInfo = { m_UBO->GetVkBuffer(), 0, m_Size };
+
+	vBindings[1].binding = 1;
+	vBindings[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	vBindings[1].imageInfo = { pTexture->GetTextureSampler(), pTexture->GetTextureImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	return vBindings;
+}
+
+template <class UBO>
+void DescriptorPool<UBO>::WriteTexture(VkDescriptorSet set, size_t textureIndex, uint32_t arrayElement)
+{
+	const Texture* pTexture = m_vTextures[textureIndex];
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = pTexture->GetTextureImageView();
+	imageInfo.sampler = pTexture->GetTextureSampler();
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = set;
+	descriptorWrite.dstBinding = 1;
+	descriptorWrite.dstArrayElement = arrayElement;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(m_Device, 1, &descriptorWrite, 0, nullptr);
+	m_vTextureVersions[textureIndex] = pTexture->GetViewVersion();
 }
 
 template <class UBO>
@@ -143,36 +281,33 @@ inline void DescriptorPool<UBO>::CreateDescriptorSetLayout(const VulkanContext&
 	bindings[0].pImmutableSamplers = nullptr; // Optional
 
 	bindings[1].binding = 1;
-	bindings[1].descriptorCount = 1;
+	bindings[1].descriptorCount = IsBindless() ? m_BindlessTextureCount : 1;
 	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	bindings[1].pImmutableSamplers = nullptr;
 	bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
+	std::array<VkDescriptorBindingFlags, 2> bindingFlags{ 0, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT };
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+	bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
 	VkDescriptorSetLayoutCreateInfo layoutInfo{};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
 	layoutInfo.pBindings = bindings.data();
-	if (vkCreateDescriptorSetLayout(context.device, &layoutInfo, nullptr, &m_DescriptorSetLayout) != VK_SUCCESS)
-		throw std::runtime_error("failed to create descriptor set layout!");
-}
-
-template<class UBO>
-inline void DescriptorPool<UBO>::CreateUBOs(const VulkanContext& context)
-{
-	for (int uboIndex = 0; uboIndex < m_Count; ++uboIndex)
+	if (IsBindless())
 	{
-		UniformBufferObjectPtr<UBO> buffer = std::make_unique<UniformBufferObject<UBO>>();
-		buffer->Initialize(context);
-		m_vUBOs.emplace_back(std::move(buffer));
+		layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+		layoutInfo.pNext = &bindingFlagsInfo;
 	}
+	if (vkCreateDescriptorSetLayout(context.device, &layoutInfo, nullptr, &m_DescriptorSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create descriptor set layout!");
 }
 
 template<class UBO>
-inline void DescriptorPool<UBO>::SetUBO(UBO src, size_t index)
+inline void DescriptorPool<UBO>::SetUBO(UBO src)
 {
-	if (index < m_vUBOs.size())
-	{
-		m_vUBOs[index]->SetData(src);
-		m_vUBOs[index]->Upload();
-	}
+	m_UBO->SetData(src);
+	m_UBO->Upload();
 }
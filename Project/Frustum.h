@@ -0,0 +1,102 @@
+#pragma once
+#include <array>
+#include <limits>
+#include <glm/glm.hpp>
+
+struct BoundingBox
+{
+	glm::vec3 min{ std::numeric_limits<float>::max() };
+	glm::vec3 max{ std::numeric_limits<float>::lowest() };
+
+	void Expand(const glm::vec3& point)
+	{
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	void Expand(const BoundingBox& other)
+	{
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+
+	bool IsValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+	glm::vec3 GetCenter() const { return (min + max) * 0.5f; }
+	glm::vec3 GetExtents() const { return (max - min) * 0.5f; }
+
+	// Radius of the sphere around the local origin that contains the box under any rotation
+	float GetRadiusAroundOrigin() const { return glm::length(glm::max(glm::abs(min), glm::abs(max))); }
+
+	// Distance from the point to the nearest and to the farthest point of the box
+	float GetMinDistance(const glm::vec3& point) const { return glm::length(glm::max(glm::max(min - point, point - max), glm::vec3(0.f))); }
+	float GetMaxDistance(const glm::vec3& point) const { return glm::length(glm::max(glm::abs(min - point), glm::abs(max - point))); }
+
+	// Box around the transformed box, the extents go through the absolute value of the matrix
+	BoundingBox Transform(const glm::mat4& matrix) const
+	{
+		const glm::vec3 center = glm::vec3(matrix * glm::vec4(GetCenter(), 1.f));
+		const glm::vec3 extents = glm::abs(glm::mat3(matrix)[0]) * GetExtents().x
+			+ glm::abs(glm::mat3(matrix)[1]) * GetExtents().y
+			+ glm::abs(glm::mat3(matrix)[2]) * GetExtents().z;
+		return BoundingBox{ center - extents, center + extents };
+	}
+};
+
+// Planes are extracted from a view projection matrix and point inwards
+struct Frustum
+{
+	std::array<glm::vec4, 6> planes{};
+	std::array<glm::vec3, 8> corners{};
+
+	Frustum() = default;
+
+	explicit Frustum(const glm::mat4& viewProjection)
+	{
+		const glm::mat4 m = glm::transpose(viewProjection);
+		planes[0] = m[3] + m[0];	// left
+		planes[1] = m[3] - m[0];	// right
+		planes[2] = m[3] + m[1];	// bottom
+		planes[3] = m[3] - m[1];	// top
+		planes[4] = m[3] + m[2];	// near
+		planes[5] = m[3] - m[2];	// far
+		for (glm::vec4& plane : planes)
+			plane /= glm::length(glm::vec3(plane));
+
+		const glm::mat4 inverse = glm::inverse(viewProjection);
+		for (int i{}; i < 8; ++i)
+		{
+			const glm::vec4 ndc{ (i & 1) ? 1.f : -1.f, (i & 2) ? 1.f : -1.f, (i & 4) ? 1.f : -1.f, 1.f };
+			const glm::vec4 corner = inverse * ndc;
+			corners[i] = glm::vec3(corner) / corner.w;
+		}
+	}
+
+	BoundingBox GetBounds() const
+	{
+		BoundingBox bounds{};
+		for (const glm::vec3& corner : corners)
+			bounds.Expand(corner);
+		return bounds;
+	}
+
+	bool Intersects(const BoundingBox& box) const
+	{
+		const glm::vec3 center = box.GetCenter();
+		const glm::vec3 extents = box.GetExtents();
+		for (const glm::vec4& plane : planes)
+		{
+			const float radius = glm::dot(extents, glm::abs(glm::vec3(plane)));
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+				return false;
+		}
+		return true;
+	}
+
+	bool Intersects(const glm::vec3& center, float radius) const
+	{
+		for (const glm::vec4& plane : planes)
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+				return false;
+		return true;
+	}
+};
@@ -9,6 +9,7 @@
 #include "vulkanbase/VulkanUtil.h"
 #include "Vertex.h"
 #include "DescriptorPool.h"
+#include "Hash.h"
 
 GP2Shader::GP2Shader(const std::string& vertexShaderFile, const std::string& fragmentShaderFile)
 	: m_VertexShaderFile{ vertexShaderFile }
@@ -23,6 +24,36 @@ void GP2Shader::initialize(const VulkanContext& context)
 {
 	m_ShaderStages.push_back(createFragmentShaderInfo(context.device));
 	m_ShaderStages.push_back(createVertexShaderInfo(context.device));
+
+	if (m_SpecializationEntries.empty())
+		return;
+
+	m_SpecializationInfo.mapEntryCount = static_cast<uint32_t>(m_SpecializationEntries.size());
+	m_SpecializationInfo.pMapEntries = m_SpecializationEntries.data();
+	m_SpecializationInfo.dataSize = m_SpecializationData.size() * sizeof(uint32_t);
+	m_SpecializationInfo.pData = m_SpecializationData.data();
+	for (VkPipelineShaderStageCreateInfo& stageInfo : m_ShaderStages)
+		stageInfo.pSpecializationInfo = &m_SpecializationInfo;
+}
+
+void GP2Shader::setSpecializationConstant(uint32_t constantId, uint32_t value)
+{
+	const uint32_t offset = static_cast<uint32_t>(m_SpecializationData.size() * sizeof(uint32_t));
+	m_SpecializationEntries.push_back(VkSpecializationMapEntry{ constantId, offset, sizeof(uint32_t) });
+	m_SpecializationData.push_back(value);
+}
+
+size_t GP2Shader::getStateHash() const
+{
+	size_t seed{ 0 };
+	HashCombine(seed, m_VertexShaderFile);
+	HashCombine(seed, m_FragmentShaderFile);
+	for (size_t i{}; i < m_SpecializationEntries.size(); ++i)
+	{
+		HashCombine(seed, m_SpecializationEntries[i].constantID);
+		HashCombine(seed, m_SpecializationData[i]);
+	}
+	return seed;
 }
 
 void GP2Shader::destroyShaderModules(const VkDevice& vkDevice)
@@ -14,8 +14,12 @@ public:
 	~GP2Shader();
 
 	void initialize(const VulkanContext& context);
+	// Applied to every stage, a stage that does not declare the constant ignores it
+	void setSpecializationConstant(uint32_t constantId, uint32_t value);
 	void destroyShaderModules(const VkDevice& vkDevice);
 	std::vector<VkPipelineShaderStageCreateInfo>& getShaderStages() { return m_ShaderStages; }
+	// Files and specialization constants, two shaders with the same hash produce the same stages
+	size_t getStateHash() const;
 private:
 	VkPipelineShaderStageCreateInfo createFragmentShaderInfo(const VkDevice& vkDevice);
 	VkPipelineShaderStageCreateInfo createVertexShaderInfo(const VkDevice& vkDevice);
@@ -26,6 +30,10 @@ private:
 
 	std::vector<VkPipelineShaderStageCreateInfo> m_ShaderStages;
 
+	std::vector<VkSpecializationMapEntry> m_SpecializationEntries;
+	std::vector<uint32_t> m_SpecializationData;
+	VkSpecializationInfo m_SpecializationInfo{};
+
 	GP2Shader(const GP2Shader&) = delete;
 	GP2Shader& operator= (const GP2Shader&) = delete;
 	GP2Shader(const GP2Shader&&) = delete;
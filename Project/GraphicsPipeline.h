@@ -3,82 +3,204 @@
 #include <vulkanbase/VulkanUtil.h>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <array>
 #include <type_traits>
+#include <limits>
+#include <chrono>
 #include "GP2Shader.h"
 #include "CommandBuffer.h"
 #include "Mesh.h"
 #include "Instance.h"
+#include "Frustum.h"
+#include "RenderQueue.h"
+#include "HiZCulling.h"
+#include "ObjectDataBuffer.h"
+#include "TransformHierarchy.h"
+#include "PipelineCompiler.h"
+#include "Hash.h"
+#include "ShaderPermutation.h"
+#include "DeletionQueue.h"
+#include "HandleTable.h"
+
+// Stays valid while the mesh moves around inside its pipeline, a removed mesh's handle is detectably stale
+using MeshHandle = Handle;
 
 template <typename Mesh>
 class GraphicsPipeline
 {
 public:
-	GraphicsPipeline
-	(
-		const std::string& vertexShaderFile,
-		const std::string& fragmentShaderFile, 
-		bool instanced
-	);
+	// The vertex format of the permutation is taken from the mesh type
+	explicit GraphicsPipeline(ShaderPermutation permutation, bool bindlessTextures = false);
 
 	void Initialize(const VulkanContext& context, const CommandPool& commandPool);
+	// Applies the removals queued since the last call and initializes the meshes added since then in order, all uploads
+	// in one batch. Initializing stops once the budget is spent, but always gets at least one mesh through.
+	// Returns the milliseconds spent. Must run while none of this pipeline's descriptor sets are in flight.
+	float Update(float budgetMilliseconds = std::numeric_limits<float>::infinity());
 	VkPipelineVertexInputStateCreateInfo CreateVertexInputStateInfo();
 	VkPipelineInputAssemblyStateCreateInfo CreateInputAssemblyStateInfo();
 	void Cleanup(const VulkanContext& context);
-	void Record(const CommandBuffer& buffer, VkExtent2D extent, const ViewProjection& ubo);
-	Mesh* AddMesh(std::unique_ptr<Mesh>&& pMesh);
-	void SetUBO(const ViewProjection& ubo, size_t uboIndex);
-	void SetVertexConstant(const MeshData& vertexConstant);
+	// Culls and sorts this frame's draws, has to run before recording so occlusion candidates can be uploaded
+	void Prepare(const ViewProjection& ubo);
+	// Without occlusion culling everything is drawn in the early phase
+	void Record(const CommandBuffer& buffer, VkExtent2D extent, CullPhase phase);
+	void SetOcclusionCulling(HiZCulling* pOcclusionCulling, bool multiDrawIndirect) { m_pOcclusionCulling = pOcclusionCulling; m_MultiDrawIndirect = multiDrawIndirect; }
+	// The mesh is drawn from the next Update() on
+	MeshHandle AddMesh(std::unique_ptr<Mesh>&& pMesh);
+	// Queued until the next Update(), the frame that may still draw the mesh keeps its buffers through the deletion queue
+	void RemoveMesh(MeshHandle handle);
+	// Null once the mesh has been removed
+	Mesh* GetMesh(MeshHandle handle) const { return m_MeshHandles.Contains(handle) ? m_vMeshes[m_MeshHandles.GetIndex(handle)].get() : nullptr; }
+	size_t GetMeshCount() const { return m_vMeshes.size(); }
+	void SetUBO(const ViewProjection& ubo);
+	const DrawStats& GetDrawStats() const { return m_DrawStats; }
 private:
-	void CreateGraphicsPipeline(const VulkanContext& context);
+	void CreatePipelineLayout();
+	// Runs on a worker thread, everything it reads is fixed once the layout exists
+	VkPipeline CompilePipeline(VkPipelineCache pipelineCache);
+	void RequestPipeline();
 	VkPushConstantRange CreatePushConstantRange();
+	// Swap and pop, the initialized meshes stay in front of the ones still waiting for Update()
+	void EraseMesh(size_t meshIndex);
+	void SwapMeshes(size_t a, size_t b);
 
 	std::vector<VkVertexInputAttributeDescription> m_AttributeDescriptions;
 	std::vector<VkVertexInputBindingDescription> m_BindingDescriptions;
 
 	std::unique_ptr<DescriptorPool<ViewProjection>> m_UBOPool;
+	ObjectDataBuffer m_ObjectData{};
 	GP2Shader m_Shader;
 	VkRenderPass m_RenderPass{};
 	VkPipelineLayout m_PipelineLayout{};
-	VkPipeline m_GraphicsPipeline{};
+	VkPipeline m_GraphicsPipeline{};	// owned by the pipeline compiler, null until it finished compiling
+	size_t m_StateKey{ 0 };
+	uint32_t m_PipelineId{ 0 };	// the permutation's id, the top field of every sort key this pipeline queues
 	std::vector<std::unique_ptr<Mesh>> m_vMeshes{};
+	HandleTable m_MeshHandles{};
+	std::vector<MeshHandle> m_vPendingRemovals{};
+	size_t m_InitializedMeshCount{ 0 };
 	bool m_Instanced{ false };
+	bool m_BindlessTextures{ false };
+
+	RenderQueue m_RenderQueue{};
+	DrawStats m_DrawStats{};
+
+	HiZCulling* m_pOcclusionCulling{ nullptr };
+	uint32_t m_FirstCandidate{ 0 };
+	bool m_MultiDrawIndirect{ false };
+
+	VulkanContext m_Context{};
+	const CommandPool* m_pCommandPool{ nullptr };
 };
 
 template<typename Mesh>
-inline GraphicsPipeline<Mesh>::GraphicsPipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile, bool instanced)
-	: m_Shader{ vertexShaderFile, fragmentShaderFile }
+inline GraphicsPipeline<Mesh>::GraphicsPipeline(ShaderPermutation permutation, bool bindlessTextures)
+	: m_Shader{ ShaderPermutation::vertexShaderFile, ShaderPermutation::fragmentShaderFile }
 	, m_BindingDescriptions{}
 	, m_AttributeDescriptions{}
-	, m_Instanced{ instanced }
+	, m_Instanced{ permutation.instanced }
+	, m_BindlessTextures{ bindlessTextures }
 {
 	using Vertex = std::conditional_t<std::is_same_v<Mesh, Mesh2D>, Vertex2D, Vertex3D>;
 
+	permutation.vertexFormat = std::is_same_v<Mesh, Mesh2D> ? VertexFormat::Vertex2D : VertexFormat::Vertex3D;
+	permutation.ApplyTo(m_Shader);
+	m_PipelineId = permutation.GetId();
+
 	m_BindingDescriptions.emplace_back(Vertex::GetBindingDescription());
 	m_AttributeDescriptions = Vertex::GetAttributeDescriptions();
 
 	if (m_Instanced) 
 	{
-		uint32_t startAttrLoc = static_cast<uint32_t>(m_AttributeDescriptions.size());
 		m_BindingDescriptions.emplace_back(InstanceVertex::GetBindingDescription());
-		auto instancedAttributeDescriptions = InstanceVertex::GetAttributeDescriptions(startAttrLoc);
+		auto instancedAttributeDescriptions = InstanceVertex::GetAttributeDescriptions(ShaderPermutation::firstInstanceLocation);
 		m_AttributeDescriptions.insert(m_AttributeDescriptions.end(), instancedAttributeDescriptions.begin(), instancedAttributeDescriptions.end());
 	}
+
+	// The shader declares every input of every permutation. Locations this one never reads alias the start
+	// of the vertex, so each of them still has a valid source.
+	for (uint32_t location{}; location < ShaderPermutation::vertexInputCount; ++location)
+	{
+		const bool provided = std::any_of(m_AttributeDescriptions.begin(), m_AttributeDescriptions.end(), [location](const VkVertexInputAttributeDescription& attribute) { return attribute.location == location; });
+		if (!provided)
+			m_AttributeDescriptions.push_back(VkVertexInputAttributeDescription{ location, 0, VK_FORMAT_R32_SFLOAT, 0 });
+	}
 }
 
 template<typename Mesh>
 inline void GraphicsPipeline<Mesh>::Initialize(const VulkanContext& context, const CommandPool& commandPool)
 {
-	if (m_vMeshes.size() == 0)
-		return;
+	m_Context = context;
+	m_pCommandPool = &commandPool;
+	m_RenderPass = context.renderPass;
+	m_ObjectData.Initialize(context, 64);
 
-	for (auto& pMesh : m_vMeshes)
-		pMesh->Initialize(context, commandPool);
+	// Falls back to a set per texture on devices without descriptor indexing
+	m_BindlessTextures = m_BindlessTextures && context.descriptorIndexing;
+	if (m_BindlessTextures)
+		m_Shader.setSpecializationConstant(0, context.maxBindlessTextures);
+	Update();
+}
 
-	m_RenderPass = context.renderPass;
-	m_Shader.initialize(context);
-	m_UBOPool = std::make_unique<DescriptorPool<ViewProjection>>(context.device, m_vMeshes.size());
-	m_UBOPool->Initialize<Mesh>(context, m_vMeshes);
-	CreateGraphicsPipeline(context);
+template<typename Mesh>
+inline float GraphicsPipeline<Mesh>::Update(float budgetMilliseconds)
+{
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point start = Clock::now();
+	auto getElapsed = [&start]() { return std::chrono::duration<float, std::milli>(Clock::now() - start).count(); };
+
+	if (!m_pCommandPool)
+		return 0.f;
+
+	// Streamed textures swap their view as mips arrive, the sets have to follow before anything is recorded
+	if (m_UBOPool)
+		m_UBOPool->RefreshTextures();
+	if (m_GraphicsPipeline == VK_NULL_HANDLE && m_PipelineLayout != VK_NULL_HANDLE)
+		RequestPipeline();
+
+	for (MeshHandle handle : m_vPendingRemovals)
+	{
+		// Removing the same mesh twice is harmless, the second handle is stale by then
+		if (m_MeshHandles.Contains(handle))
+			EraseMesh(m_MeshHandles.GetIndex(handle));
+	}
+	m_vPendingRemovals.clear();
+
+	if (m_InitializedMeshCount == m_vMeshes.size() || !m_vMeshes[m_InitializedMeshCount]->IsReadyToInitialize())
+		return getElapsed();
+
+	// Generating instances and copying into staging is the expensive part, it is what the budget is spent on
+	UploadBatch batch = m_Context.pTransferQueue->Begin();
+	size_t initializedCount = m_InitializedMeshCount;
+	while (initializedCount < m_vMeshes.size() && m_vMeshes[initializedCount]->IsReadyToInitialize())
+	{
+		m_vMeshes[initializedCount++]->Initialize(m_Context, batch);
+		if (getElapsed() >= budgetMilliseconds)
+			break;
+	}
+	m_Context.pTransferQueue->Submit(std::move(batch));
+
+	// The sets live for the whole run, new meshes only add array slots or cached sets for textures not seen yet
+	if (m_UBOPool)
+		m_UBOPool->AddMeshes<Mesh>(m_vMeshes, initializedCount);
+	else
+	{
+		m_UBOPool = std::make_unique<DescriptorPool<ViewProjection>>(m_Context.device, m_BindlessTextures ? m_Context.maxBindlessTextures : 0);
+		m_UBOPool->Initialize<Mesh>(m_Context, m_vMeshes, initializedCount);
+	}
+
+	for (size_t i = m_InitializedMeshCount; i < initializedCount; ++i)
+		m_vMeshes[i]->SetTextureIndex(m_UBOPool->GetMeshTextureIndex(i));
+
+	// The layout is needed to bind descriptors right away, the pipeline itself compiles in the background
+	if (m_PipelineLayout == VK_NULL_HANDLE)
+	{
+		CreatePipelineLayout();
+		RequestPipeline();
+	}
+	m_InitializedMeshCount = initializedCount;
+	return getElapsed();
 }
 
 template<typename Mesh>
@@ -106,18 +228,70 @@ inline VkPipelineInputAssemblyStateCreateInfo GraphicsPipeline<Mesh>::CreateInpu
 template<typename Mesh>
 inline void GraphicsPipeline<Mesh>::Cleanup(const VulkanContext& context)
 {
-	vkDestroyPipeline(context.device, m_GraphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(context.device, m_PipelineLayout, nullptr);
+	DeletionQueue::Get().Destroy(m_PipelineLayout);
+	m_PipelineLayout = VK_NULL_HANDLE;
 	m_UBOPool.reset();
+	m_ObjectData.Cleanup();
 
 	for (auto& pMesh : m_vMeshes)
 		pMesh->DestroyMesh(context.device);
 }
 
 template<typename Mesh>
-inline void GraphicsPipeline<Mesh>::Record(const CommandBuffer& buffer, VkExtent2D extent, const ViewProjection& ubo)
+inline void GraphicsPipeline<Mesh>::Prepare(const ViewProjection& ubo)
+{
+	m_RenderQueue.Clear();
+	m_DrawStats = DrawStats{};
+	if (m_InitializedMeshCount == 0)
+		return;
+
+	SetUBO(ubo);
+
+	// Object i is mesh i, so draws only have to push their mesh index
+	m_ObjectData.BeginFrame();
+	for (size_t i{}; i < m_InitializedMeshCount; ++i)
+		m_ObjectData.Add(m_vMeshes[i]->GetObjectData());
+	m_ObjectData.Upload();
+
+	// Occlusion is tested per cell, so runs of cells are not merged when it is on
+	const bool occlusionCulling = m_pOcclusionCulling && m_pOcclusionCulling->IsEnabled();
+	const Frustum frustum{ ubo.proj * ubo.view };
+	for (size_t i{}; i < m_InitializedMeshCount; ++i)
+		m_vMeshes[i]->CollectDraws(m_PipelineId, static_cast<uint32_t>(i), static_cast<uint32_t>(m_UBOPool->GetMeshDescriptorSetIndex(i)), frustum, ubo.view, m_RenderQueue, !occlusionCulling);
+
+	// Only textures with a draw that survived frustum culling count as used for residency
+	for (const DrawCommand& command : m_RenderQueue.GetCommands())
+	{
+		const Mesh& mesh = *m_vMeshes[command.meshIndex];
+		if (const Texture* pTexture = mesh.GetTexture())
+			pTexture->MarkUsed();
+
+		m_DrawStats.vertices += static_cast<uint64_t>(mesh.GetIndexCount()) * command.instanceCount;
+		if (mesh.GetReplacedIndexCount() > mesh.GetIndexCount())
+			m_DrawStats.impostorVerticesSaved += static_cast<uint64_t>(mesh.GetReplacedIndexCount() - mesh.GetIndexCount()) * command.instanceCount;
+	}
+
+	// The pipeline bind is counted once, the queue only tracks what changes between draws
+	m_DrawStats.queuedDraws = static_cast<uint32_t>(m_RenderQueue.GetCommands().size());
+	m_DrawStats.unsortedBinds = m_RenderQueue.CountBinds() + 1;
+	m_RenderQueue.Sort();
+	m_DrawStats.binds = m_RenderQueue.CountBinds() + 1;
+
+	if (!occlusionCulling)
+		return;
+
+	// Candidates are added in sorted order, so the slots of this pipeline are contiguous
+	m_FirstCandidate = m_pOcclusionCulling->GetCandidateCount();
+	for (const DrawCommand& command : m_RenderQueue.GetCommands())
+		m_pOcclusionCulling->AddCandidate(command.bounds, m_vMeshes[command.meshIndex]->GetIndexCount(), command.firstInstance, command.instanceCount);
+}
+
+template<typename Mesh>
+inline void GraphicsPipeline<Mesh>::Record(const CommandBuffer& buffer, VkExtent2D extent, CullPhase phase)
 {
-	if (m_vMeshes.size() == 0)
+	const bool occlusionCulling = m_pOcclusionCulling && m_pOcclusionCulling->IsEnabled();
+	// Until the background compile is done this pipeline's draws are skipped
+	if (m_RenderQueue.IsEmpty() || (phase == CullPhase::Late && !occlusionCulling) || m_GraphicsPipeline == VK_NULL_HANDLE)
 		return;
 
 	vkCmdBindPipeline(buffer.GetVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
@@ -136,38 +310,132 @@ inline void GraphicsPipeline<Mesh>::Record(const CommandBuffer& buffer, VkExtent
 	scissor.extent = extent;
 	vkCmdSetScissor(buffer.GetVkCommandBuffer(), 0, 1, &scissor);
 
-	for (size_t i{}; i < m_vMeshes.size(); ++i)
+	m_ObjectData.Bind(buffer.GetVkCommandBuffer(), m_PipelineLayout, 1);
+	m_Context.pTransforms->Bind(buffer.GetVkCommandBuffer(), m_PipelineLayout, 2);
+
+	const std::vector<DrawCommand>& vCommands = m_RenderQueue.GetCommands();
+	uint32_t boundSet{ UINT32_MAX };
+	uint32_t boundMesh{ UINT32_MAX };
+	for (size_t i{}; i < vCommands.size(); )
 	{
-		SetUBO(ubo, i);
-		m_UBOPool->BindDescriptorSet(buffer.GetVkCommandBuffer(), m_PipelineLayout, i);
-		m_vMeshes[i]->Draw(m_PipelineLayout, buffer.GetVkCommandBuffer());
+		const DrawCommand& command = vCommands[i];
+		const Mesh& mesh = *m_vMeshes[command.meshIndex];
+		if (command.descriptorSetIndex != boundSet)
+		{
+			m_UBOPool->BindDescriptorSet(buffer.GetVkCommandBuffer(), m_PipelineLayout, command.descriptorSetIndex);
+			boundSet = command.descriptorSetIndex;
+		}
+		if (command.meshIndex != boundMesh)
+		{
+			mesh.BindGeometry(buffer.GetVkCommandBuffer());
+			vkCmdPushConstants(buffer.GetVkCommandBuffer(), m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t), &command.meshIndex);
+			boundMesh = command.meshIndex;
+		}
+
+		if (!occlusionCulling)
+		{
+			mesh.Draw(buffer.GetVkCommandBuffer(), command.firstInstance, command.instanceCount);
+			++m_DrawStats.drawCalls;
+			++i;
+			continue;
+		}
+
+		// The cull shader zeroes the instance count of hidden slots, a run of slots sharing all state goes out as one multi draw
+		size_t runLength{ 1 };
+		if (m_MultiDrawIndirect)
+		{
+			while (i + runLength < vCommands.size() && vCommands[i + runLength].meshIndex == command.meshIndex && vCommands[i + runLength].descriptorSetIndex == command.descriptorSetIndex)
+				++runLength;
+		}
+		const VkDeviceSize offset = sizeof(VkDrawIndexedIndirectCommand) * (m_FirstCandidate + i);
+		mesh.DrawIndirect(buffer.GetVkCommandBuffer(), m_pOcclusionCulling->GetDrawBuffer(phase), offset, static_cast<uint32_t>(runLength));
+		++m_DrawStats.drawCalls;
+		i += runLength;
 	}
 }
 
 template<typename Mesh>
-inline Mesh* GraphicsPipeline<Mesh>::AddMesh(std::unique_ptr<Mesh>&& pMesh)
+inline MeshHandle GraphicsPipeline<Mesh>::AddMesh(std::unique_ptr<Mesh>&& pMesh)
 {
 	m_vMeshes.push_back(std::move(pMesh));
-	return m_vMeshes.back().get();
+	return m_MeshHandles.Add();
+}
+
+template<typename Mesh>
+inline void GraphicsPipeline<Mesh>::RemoveMesh(MeshHandle handle)
+{
+	if (m_MeshHandles.Contains(handle))
+		m_vPendingRemovals.push_back(handle);
+}
+
+template<typename Mesh>
+inline void GraphicsPipeline<Mesh>::EraseMesh(size_t meshIndex)
+{
+	// An initialized mesh is first swapped to the end of the initialized range, the descriptor pool does the same
+	if (meshIndex < m_InitializedMeshCount)
+	{
+		const size_t lastInitialized = m_InitializedMeshCount - 1;
+		m_UBOPool->RemoveMesh(meshIndex);
+		SwapMeshes(meshIndex, lastInitialized);
+		meshIndex = lastInitialized;
+		--m_InitializedMeshCount;
+	}
+
+	SwapMeshes(meshIndex, m_vMeshes.size() - 1);
+	m_vMeshes.pop_back();
+	m_MeshHandles.PopBack();
 }
 
 template<typename Mesh>
-inline void GraphicsPipeline<Mesh>::SetUBO(const ViewProjection& ubo, size_t uboIndex)
+inline void GraphicsPipeline<Mesh>::SwapMeshes(size_t a, size_t b)
 {
-	m_UBOPool->SetUBO(ubo, uboIndex);
+	if (a == b)
+		return;
+	std::swap(m_vMeshes[a], m_vMeshes[b]);
+	m_MeshHandles.Swap(static_cast<uint32_t>(a), static_cast<uint32_t>(b));
 }
 
 template<typename Mesh>
-inline void GraphicsPipeline<Mesh>::SetVertexConstant(const MeshData& vertexConstant)
+inline void GraphicsPipeline<Mesh>::SetUBO(const ViewProjection& ubo)
 {
-	for (auto& mesh : m_vMeshes)
-		if (mesh->RotationEnabled())
-			mesh->SetVertexConstant({ mesh->GetVertexConstant().model * vertexConstant.model });
+	m_UBOPool->SetUBO(ubo);
 }
 
 template<typename Mesh>
-inline void GraphicsPipeline<Mesh>::CreateGraphicsPipeline(const VulkanContext& context)
+inline void GraphicsPipeline<Mesh>::CreatePipelineLayout()
 {
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	// Set 0 holds the view projection and textures, set 1 the object data, set 2 the world matrices
+	const std::array<VkDescriptorSetLayout, 3> setLayouts{ m_UBOPool->GetDescriptorSetLayout(), m_ObjectData.GetDescriptorSetLayout(), m_Context.pTransforms->GetDescriptorSetLayout() };
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	VkPushConstantRange pushConstantRange = CreatePushConstantRange();
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(m_Context.device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline layout!");
+	}
+
+	// Everything that ends up in the create info, pipelines with the same key are interchangeable
+	// The permutation is part of the shader's specialization constants, so it keys the pipeline cache too
+	m_StateKey = m_Shader.getStateHash();
+	HashCombine(m_StateKey, m_RenderPass);
+}
+
+template<typename Mesh>
+inline void GraphicsPipeline<Mesh>::RequestPipeline()
+{
+	m_GraphicsPipeline = m_Context.pPipelineCompiler->Request(m_StateKey, [this](VkPipelineCache pipelineCache) { return CompilePipeline(pipelineCache); });
+}
+
+template<typename Mesh>
+inline VkPipeline GraphicsPipeline<Mesh>::CompilePipeline(VkPipelineCache pipelineCache)
+{
+	// Shader files are read here too, a pipeline that finds its key already requested never loads them
+	m_Shader.initialize(m_Context);
+
 	VkPipelineViewportStateCreateInfo viewportState{};
 	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportState.viewportCount = 1;
@@ -212,18 +480,6 @@ inline void GraphicsPipeline<Mesh>::CreateGraphicsPipeline(const VulkanContext&
 	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
 	dynamicState.pDynamicStates = dynamicStates.data();
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &m_UBOPool->GetDescriptorSetLayout();
-	pipelineLayoutInfo.pushConstantRangeCount = 1;
-	VkPushConstantRange pushConstantRange = CreatePushConstantRange();
-	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-	if (vkCreatePipelineLayout(context.device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create pipeline layout!");
-	}
-
 	VkPipelineDepthStencilStateCreateInfo depthStencil{};
 	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
 	depthStencil.depthTestEnable = VK_TRUE;
@@ -259,19 +515,21 @@ inline void GraphicsPipeline<Mesh>::CreateGraphicsPipeline(const VulkanContext&
 	pipelineInfo.subpass = 0;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-	if (vkCreateGraphicsPipelines(context.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_GraphicsPipeline) != VK_SUCCESS)
+	VkPipeline pipeline{};
+	if (vkCreateGraphicsPipelines(m_Context.device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
 		throw std::runtime_error("failed to create graphics pipeline!");
 
-	m_Shader.destroyShaderModules(context.device);
+	m_Shader.destroyShaderModules(m_Context.device);
+	return pipeline;
 }
 
 template<typename Mesh>
 inline VkPushConstantRange GraphicsPipeline<Mesh>::CreatePushConstantRange()
 {
 	VkPushConstantRange pushConstantRange = {};
-	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 	// Stage the push constant is accessible from
 	pushConstantRange.offset = 0;
-	pushConstantRange.size = sizeof(MeshData); // Size of push constant block
+	pushConstantRange.size = sizeof(uint32_t); // Only the object index, the object data itself is in a storage buffer
 	return pushConstantRange;
 }
@@ -0,0 +1,66 @@
+//---------------------------
+// Includes
+//---------------------------
+#include "HandleTable.h"
+#include <utility>
+
+//---------------------------
+// Member functions
+//---------------------------
+
+Handle HandleTable::Add()
+{
+	uint32_t slot{};
+	if (!m_vFreeSlots.empty())
+	{
+		slot = m_vFreeSlots.back();
+		m_vFreeSlots.pop_back();
+	}
+	else
+	{
+		slot = static_cast<uint32_t>(m_vSlots.size());
+		m_vSlots.emplace_back();
+	}
+
+	m_vSlots[slot].index = GetSize();
+	m_vDenseSlots.push_back(slot);
+	return Handle{ slot, m_vSlots[slot].generation };
+}
+
+bool HandleTable::Contains(Handle handle) const
+{
+	// Freeing a slot bumps its generation, so a match means the slot is still in use by this handle's element
+	return handle.slot < m_vSlots.size() && m_vSlots[handle.slot].generation == handle.generation;
+}
+
+Handle HandleTable::GetHandle(uint32_t index) const
+{
+	const uint32_t slot = m_vDenseSlots[index];
+	return Handle{ slot, m_vSlots[slot].generation };
+}
+
+void HandleTable::Swap(uint32_t a, uint32_t b)
+{
+	std::swap(m_vDenseSlots[a], m_vDenseSlots[b]);
+	m_vSlots[m_vDenseSlots[a]].index = a;
+	m_vSlots[m_vDenseSlots[b]].index = b;
+}
+
+void HandleTable::PopBack()
+{
+	const uint32_t slot = m_vDenseSlots.back();
+	m_vDenseSlots.pop_back();
+	++m_vSlots[slot].generation;
+	m_vFreeSlots.push_back(slot);
+}
+
+void HandleTable::Clear()
+{
+	// Generations survive, handles from before the clear must not match reused slots
+	for (uint32_t slot : m_vDenseSlots)
+	{
+		++m_vSlots[slot].generation;
+		m_vFreeSlots.push_back(slot);
+	}
+	m_vDenseSlots.clear();
+}
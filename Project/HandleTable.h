@@ -0,0 +1,70 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <vector>
+#include <cstdint>
+
+// Refers to an element through a slot that never moves. The generation goes up whenever the slot is freed,
+// so a handle to a removed element stays detectably stale even after its slot is reused.
+struct Handle
+{
+	static constexpr uint32_t invalidSlot{ UINT32_MAX };
+
+	uint32_t slot{ invalidSlot };
+	uint32_t generation{ 0 };
+
+	bool IsNull() const { return slot == invalidSlot; }
+	bool operator==(const Handle& other) const = default;
+};
+
+//-----------------------------------------------------
+// HandleTable Class
+//-----------------------------------------------------
+// The indirection between handles and a densely packed array kept by the owner. The owner moves its elements
+// around, e.g. to fill the hole a removal leaves with its last element, and mirrors every move here, so
+// iterating stays a walk over contiguous memory while handles keep pointing at the same element.
+class HandleTable final
+{
+public:
+	HandleTable() = default;
+	~HandleTable() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	HandleTable(const HandleTable& other)					= delete;
+	HandleTable(HandleTable&& other) noexcept				= delete;
+	HandleTable& operator=(const HandleTable& other)		= delete;
+	HandleTable& operator=(HandleTable&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	// The new element has to be appended to the dense array, its index is the size before the call
+	Handle Add();
+	bool Contains(Handle handle) const;
+	// Dense index of a handle the table contains
+	uint32_t GetIndex(Handle handle) const { return m_vSlots[handle.slot].index; }
+	Handle GetHandle(uint32_t index) const;
+
+	// The dense elements at a and b traded places
+	void Swap(uint32_t a, uint32_t b);
+	// The last dense element was removed, its handle goes stale
+	void PopBack();
+
+	uint32_t GetSize() const { return static_cast<uint32_t>(m_vDenseSlots.size()); }
+	void Clear();
+
+private:
+	struct Slot
+	{
+		uint32_t index{ 0 };
+		uint32_t generation{ 0 };
+	};
+
+	std::vector<Slot> m_vSlots{};
+	std::vector<uint32_t> m_vDenseSlots{};	// dense index -> slot
+	std::vector<uint32_t> m_vFreeSlots{};
+};
@@ -0,0 +1,9 @@
+#pragma once
+#include <functional>
+
+// Folds the hash of value into seed, the order values are combined in matters
+template<typename T>
+inline void HashCombine(size_t& seed, const T& value)
+{
+	seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
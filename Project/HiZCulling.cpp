@@ -0,0 +1,459 @@
+
+//---------------------------
+// Includes
+//---------------------------
+#include "HiZCulling.h"
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+#include "ResidencyManager.h"
+#include "ComputeQueue.h"
+#include "AssetCache.h"
+
+namespace
+{
+	constexpr uint32_t cullGroupSize{ 64 };
+	constexpr uint32_t pyramidGroupSize{ 8 };
+
+	struct PyramidParameters
+	{
+		glm::ivec2 sourceSize{};
+		glm::ivec2 destinationSize{};
+	};
+
+	struct CullParameters
+	{
+		glm::mat4 viewProjection{};
+		glm::vec2 depthSize{};
+		uint32_t candidateCount{ 0 };
+		uint32_t phase{ 0 };
+		uint32_t pyramidValid{ 0 };
+	};
+
+	uint32_t FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+	{
+		VkPhysicalDeviceMemoryProperties memProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+		{
+			if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+				return i;
+		}
+
+		throw std::runtime_error("failed to find suitable memory type!");
+	}
+
+	VkImageView CreateView(VkDevice device, VkImage image, uint32_t baseMip, uint32_t mipCount)
+	{
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R32_SFLOAT;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.baseMipLevel = baseMip;
+		viewInfo.subresourceRange.levelCount = mipCount;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		VkImageView view{};
+		if (vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+			throw std::runtime_error("failed to create depth pyramid image view!");
+		return view;
+	}
+
+	void ComputeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+	{
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = dstAccess;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+//---------------------------
+// Member functions
+//---------------------------
+
+void HiZCulling::Initialize(const VulkanContext& context, VkImageView depthImageView)
+{
+	m_Context = context;
+	m_DepthImageView = depthImageView;
+
+	CreatePyramid();
+	CreateDescriptors();
+	CreateCandidateBuffers(256);
+
+	m_PyramidPipeline = CreateComputePipeline("shaders/hiz.comp.spv", m_PyramidPipelineLayout);
+	m_CullPipeline = CreateComputePipeline("shaders/cull.comp.spv", m_CullPipelineLayout);
+}
+
+void HiZCulling::Cleanup()
+{
+	if (!IsEnabled())
+		return;
+
+	const VkDevice device = m_Context.device;
+	vkDestroyPipeline(device, m_CullPipeline, nullptr);
+	vkDestroyPipeline(device, m_PyramidPipeline, nullptr);
+	vkDestroyPipelineLayout(device, m_CullPipelineLayout, nullptr);
+	vkDestroyPipelineLayout(device, m_PyramidPipelineLayout, nullptr);
+	vkDestroyDescriptorPool(device, m_DescriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, m_CullSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, m_PyramidSetLayout, nullptr);
+	m_pSampler.reset();
+	for (VkImageView view : m_vPyramidMipViews)
+		vkDestroyImageView(device, view, nullptr);
+	vkDestroyImageView(device, m_PyramidView, nullptr);
+	vkDestroyImage(device, m_PyramidImage, nullptr);
+	ResidencyManager::Get().Free(device, m_PyramidMemory);
+
+	m_CandidateBuffer.reset();
+	m_EarlyDrawBuffer.reset();
+	m_LateDrawBuffer.reset();
+	m_CullPipeline = VK_NULL_HANDLE;
+}
+
+void HiZCulling::BeginFrame()
+{
+	m_vCandidates.clear();
+}
+
+uint32_t HiZCulling::AddCandidate(const BoundingBox& bounds, uint32_t indexCount, uint32_t firstInstance, uint32_t instanceCount)
+{
+	m_vCandidates.push_back(CullCandidate{ glm::vec4(bounds.min, 1.f), glm::vec4(bounds.max, 1.f), indexCount, firstInstance, instanceCount });
+	return static_cast<uint32_t>(m_vCandidates.size() - 1);
+}
+
+void HiZCulling::UploadCandidates(const glm::mat4& viewProjection)
+{
+	if (!IsEnabled())
+		return;
+
+	m_ViewProjection = viewProjection;
+	if (m_vCandidates.empty())
+		return;
+
+	// Only called between frames, so nothing in flight still reads the old buffers
+	if (m_vCandidates.size() > m_CandidateCapacity)
+		CreateCandidateBuffers(std::max(static_cast<uint32_t>(m_vCandidates.size()), m_CandidateCapacity * 2));
+
+	m_CandidateBuffer->Upload(m_vCandidates.data(), 0, sizeof(CullCandidate) * m_vCandidates.size());
+}
+
+void HiZCulling::RecordCulling(VkCommandBuffer commandBuffer, CullPhase phase) const
+{
+	if (!IsEnabled() || m_vCandidates.empty())
+		return;
+
+	CullParameters parameters{};
+	parameters.viewProjection = m_ViewProjection;
+	parameters.depthSize = glm::vec2(m_Context.swapChainExtent.width, m_Context.swapChainExtent.height);
+	parameters.candidateCount = static_cast<uint32_t>(m_vCandidates.size());
+	parameters.phase = static_cast<uint32_t>(phase);
+	parameters.pyramidValid = m_PyramidValid ? 1 : 0;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipelineLayout, 0, 1, &m_CullSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, m_CullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullParameters), &parameters);
+	vkCmdDispatch(commandBuffer, (parameters.candidateCount + cullGroupSize - 1) / cullGroupSize, 1, 1);
+
+	// The late phase reads what the early phase wrote, the draws read both
+	ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+}
+
+void HiZCulling::RecordPyramid(VkCommandBuffer commandBuffer)
+{
+	if (!IsEnabled())
+		return;
+
+	// The early cull read the previous pyramid, the first frame finds it undefined
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.oldLayout = m_PyramidValid ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = m_PyramidImage;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_PyramidMipCount, 0, 1 };
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PyramidPipeline);
+
+	PyramidParameters parameters{};
+	parameters.sourceSize = glm::ivec2(m_Context.swapChainExtent.width, m_Context.swapChainExtent.height);
+	for (uint32_t mip{}; mip < m_PyramidMipCount; ++mip)
+	{
+		parameters.destinationSize = glm::max(glm::ivec2(m_PyramidExtent.width >> mip, m_PyramidExtent.height >> mip), glm::ivec2(1));
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PyramidPipelineLayout, 0, 1, &m_vPyramidSets[mip], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, m_PyramidPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PyramidParameters), &parameters);
+		vkCmdDispatch(commandBuffer, (parameters.destinationSize.x + pyramidGroupSize - 1) / pyramidGroupSize, (parameters.destinationSize.y + pyramidGroupSize - 1) / pyramidGroupSize, 1);
+
+		ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		parameters.sourceSize = parameters.destinationSize;
+	}
+	m_PyramidValid = true;
+}
+
+std::vector<uint32_t> HiZCulling::GetSharedQueueFamilies() const
+{
+	return m_Context.pComputeQueue ? m_Context.pComputeQueue->GetSharedQueueFamilies() : std::vector<uint32_t>{};
+}
+
+VkBuffer HiZCulling::GetDrawBuffer(CullPhase phase) const
+{
+	return phase == CullPhase::Early ? m_EarlyDrawBuffer->GetVkBuffer() : m_LateDrawBuffer->GetVkBuffer();
+}
+
+void HiZCulling::CreatePyramid()
+{
+	// Level 0 is half the depth resolution, every texel keeps the farthest depth it covers.
+	// Odd sizes fold the leftover row and column into the last texel so nothing is dropped.
+	m_PyramidExtent = { std::max(m_Context.swapChainExtent.width / 2, 1u), std::max(m_Context.swapChainExtent.height / 2, 1u) };
+	m_PyramidMipCount = 1;
+	while ((m_PyramidExtent.width >> m_PyramidMipCount) > 0 || (m_PyramidExtent.height >> m_PyramidMipCount) > 0)
+		++m_PyramidMipCount;
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent = { m_PyramidExtent.width, m_PyramidExtent.height, 1 };
+	imageInfo.mipLevels = m_PyramidMipCount;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	// Built on the graphics queue, read by the early cull on the compute queue
+	const std::vector<uint32_t> vSharedFamilies = GetSharedQueueFamilies();
+	if (!vSharedFamilies.empty())
+	{
+		imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(vSharedFamilies.size());
+		imageInfo.pQueueFamilyIndices = vSharedFamilies.data();
+	}
+
+	if (vkCreateImage(m_Context.device, &imageInfo, nullptr, &m_PyramidImage) != VK_SUCCESS)
+		throw std::runtime_error("failed to create depth pyramid image!");
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(m_Context.device, m_PyramidImage, &memRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = FindMemoryType(m_Context.physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (ResidencyManager::Get().Allocate(m_Context.device, allocInfo, m_PyramidMemory) != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate depth pyramid memory!");
+	vkBindImageMemory(m_Context.device, m_PyramidImage, m_PyramidMemory, 0);
+
+	m_PyramidView = CreateView(m_Context.device, m_PyramidImage, 0, m_PyramidMipCount);
+	for (uint32_t mip{}; mip < m_PyramidMipCount; ++mip)
+		m_vPyramidMipViews.push_back(CreateView(m_Context.device, m_PyramidImage, mip, 1));
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.maxLod = static_cast<float>(m_PyramidMipCount);
+
+	// Counts against the sampler limit like every other sampler
+	m_pSampler = m_Context.pAssetCache->GetSampler(samplerInfo);
+}
+
+void HiZCulling::CreateDescriptors()
+{
+	std::array<VkDescriptorSetLayoutBinding, 2> pyramidBindings{};
+	pyramidBindings[0] = { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+	pyramidBindings[1] = { 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+
+	std::array<VkDescriptorSetLayoutBinding, 4> cullBindings{};
+	cullBindings[0] = { 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+	cullBindings[1] = { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+	cullBindings[2] = { 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+	cullBindings[3] = { 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(pyramidBindings.size());
+	layoutInfo.pBindings = pyramidBindings.data();
+	if (vkCreateDescriptorSetLayout(m_Context.device, &layoutInfo, nullptr, &m_PyramidSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create descriptor set layout!");
+
+	layoutInfo.bindingCount = static_cast<uint32_t>(cullBindings.size());
+	layoutInfo.pBindings = cullBindings.data();
+	if (vkCreateDescriptorSetLayout(m_Context.device, &layoutInfo, nullptr, &m_CullSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create descriptor set layout!");
+
+	std::array<VkDescriptorPoolSize, 3> poolSizes{};
+	poolSizes[0] = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_PyramidMipCount + 1 };
+	poolSizes[1] = { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_PyramidMipCount };
+	poolSizes[2] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 };
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = m_PyramidMipCount + 1;
+	if (vkCreateDescriptorPool(m_Context.device, &poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS)
+		throw std::runtime_error("failed to create descriptor pool!");
+
+	std::vector<VkDescriptorSetLayout> layouts(m_PyramidMipCount, m_PyramidSetLayout);
+	layouts.push_back(m_CullSetLayout);
+	std::vector<VkDescriptorSet> sets(layouts.size());
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_DescriptorPool;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(sets.size());
+	allocInfo.pSetLayouts = layouts.data();
+	if (vkAllocateDescriptorSets(m_Context.device, &allocInfo, sets.data()) != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate descriptor sets!");
+
+	m_CullSet = sets.back();
+	sets.pop_back();
+	m_vPyramidSets = std::move(sets);
+
+	// Mip 0 reduces the depth attachment, every other mip the one above it
+	for (uint32_t mip{}; mip < m_PyramidMipCount; ++mip)
+	{
+		VkDescriptorImageInfo sourceInfo{};
+		sourceInfo.sampler = m_pSampler->GetVkSampler();
+		sourceInfo.imageView = mip == 0 ? m_DepthImageView : m_vPyramidMipViews[mip - 1];
+		sourceInfo.imageLayout = mip == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+		VkDescriptorImageInfo destinationInfo{};
+		destinationInfo.imageView = m_vPyramidMipViews[mip];
+		destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[0].dstSet = m_vPyramidSets[mip];
+		descriptorWrites[0].dstBinding = 0;
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[0].descriptorCount = 1;
+		descriptorWrites[0].pImageInfo = &sourceInfo;
+
+		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[1].dstSet = m_vPyramidSets[mip];
+		descriptorWrites[1].dstBinding = 1;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		descriptorWrites[1].descriptorCount = 1;
+		descriptorWrites[1].pImageInfo = &destinationInfo;
+
+		vkUpdateDescriptorSets(m_Context.device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+
+	VkPushConstantRange pyramidRange{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PyramidParameters) };
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_PyramidSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pyramidRange;
+	if (vkCreatePipelineLayout(m_Context.device, &pipelineLayoutInfo, nullptr, &m_PyramidPipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create pipeline layout!");
+
+	VkPushConstantRange cullRange{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullParameters) };
+	pipelineLayoutInfo.pSetLayouts = &m_CullSetLayout;
+	pipelineLayoutInfo.pPushConstantRanges = &cullRange;
+	if (vkCreatePipelineLayout(m_Context.device, &pipelineLayoutInfo, nullptr, &m_CullPipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create pipeline layout!");
+}
+
+void HiZCulling::CreateCandidateBuffers(uint32_t capacity)
+{
+	m_CandidateCapacity = capacity;
+
+	// Both phases read the candidates, the early draws are written by one queue and drawn and read by the other
+	const std::vector<uint32_t> vSharedFamilies = GetSharedQueueFamilies();
+	m_CandidateBuffer = std::make_unique<Buffer>(
+		m_Context,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		sizeof(CullCandidate) * capacity,
+		vSharedFamilies
+	);
+	m_CandidateBuffer->Map();
+
+	const VkDeviceSize drawBufferSize = sizeof(VkDrawIndexedIndirectCommand) * capacity;
+	m_EarlyDrawBuffer = std::make_unique<Buffer>(m_Context, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawBufferSize, vSharedFamilies);
+	m_LateDrawBuffer = std::make_unique<Buffer>(m_Context, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawBufferSize);
+
+	UpdateCullDescriptorSet();
+}
+
+void HiZCulling::UpdateCullDescriptorSet()
+{
+	std::array<VkDescriptorBufferInfo, 3> bufferInfos{};
+	bufferInfos[0] = { m_CandidateBuffer->GetVkBuffer(), 0, VK_WHOLE_SIZE };
+	bufferInfos[1] = { m_EarlyDrawBuffer->GetVkBuffer(), 0, VK_WHOLE_SIZE };
+	bufferInfos[2] = { m_LateDrawBuffer->GetVkBuffer(), 0, VK_WHOLE_SIZE };
+
+	VkDescriptorImageInfo pyramidInfo{};
+	pyramidInfo.sampler = m_pSampler->GetVkSampler();
+	pyramidInfo.imageView = m_PyramidView;
+	pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	std::array<VkWriteDescriptorSet, 4> descriptorWrites{};
+	for (uint32_t binding{}; binding < descriptorWrites.size(); ++binding)
+	{
+		descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[binding].dstSet = m_CullSet;
+		descriptorWrites[binding].dstBinding = binding;
+		descriptorWrites[binding].descriptorCount = 1;
+		if (binding < bufferInfos.size())
+		{
+			descriptorWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+		}
+		else
+		{
+			descriptorWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			descriptorWrites[binding].pImageInfo = &pyramidInfo;
+		}
+	}
+	vkUpdateDescriptorSets(m_Context.device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+VkPipeline HiZCulling::CreateComputePipeline(const std::string& shaderFile, VkPipelineLayout layout) const
+{
+	const std::vector<char> code = readFile(shaderFile);
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+	VkShaderModule shaderModule{};
+	if (vkCreateShaderModule(m_Context.device, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS)
+		throw std::runtime_error("failed to create shader module!");
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = layout;
+
+	VkPipeline pipeline{};
+	const VkResult result = vkCreateComputePipelines(m_Context.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+	vkDestroyShaderModule(m_Context.device, shaderModule, nullptr);
+	if (result != VK_SUCCESS)
+		throw std::runtime_error("failed to create compute pipeline!");
+	return pipeline;
+}
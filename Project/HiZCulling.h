@@ -0,0 +1,107 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+#include "vulkanbase/VulkanUtil.h"
+#include "Buffer.h"
+#include "Frustum.h"
+#include "Sampler.h"
+
+enum class CullPhase
+{
+	Early,	// tested against the pyramid of the previous frame
+	Late	// re-tests what the early phase rejected against the pyramid built from the early depth
+};
+
+// Matches the CullCandidate struct in cull.comp
+struct CullCandidate
+{
+	glm::vec4 boundsMin{};
+	glm::vec4 boundsMax{};
+	uint32_t indexCount{ 0 };
+	uint32_t firstInstance{ 0 };
+	uint32_t instanceCount{ 0 };
+	uint32_t padding{ 0 };
+};
+
+//-----------------------------------------------------
+// HiZCulling Class
+//-----------------------------------------------------
+// Two phase occlusion culling against a max depth pyramid. Every candidate owns one indirect draw slot
+// per phase, the cull shader writes the slot's instance count as either the candidate's count or zero.
+class HiZCulling final
+{
+public:
+	HiZCulling() = default;
+	~HiZCulling() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	HiZCulling(const HiZCulling& other)					= delete;
+	HiZCulling(HiZCulling&& other) noexcept				= delete;
+	HiZCulling& operator=(const HiZCulling& other)		= delete;
+	HiZCulling& operator=(HiZCulling&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	// The depth image has to be created with sampled usage and left in depth read only layout by the early render pass
+	void Initialize(const VulkanContext& context, VkImageView depthImageView);
+	void Cleanup();
+	bool IsEnabled() const { return m_CullPipeline != VK_NULL_HANDLE; }
+
+	// Candidates are gathered on the CPU every frame before recording starts
+	void BeginFrame();
+	uint32_t AddCandidate(const BoundingBox& bounds, uint32_t indexCount, uint32_t firstInstance, uint32_t instanceCount);
+	void UploadCandidates(const glm::mat4& viewProjection);
+
+	// The early phase only depends on the previous frame, so it may be recorded for the compute queue
+	void RecordCulling(VkCommandBuffer commandBuffer, CullPhase phase) const;
+	// Reduces the depth of the early render pass into the pyramid
+	void RecordPyramid(VkCommandBuffer commandBuffer);
+
+	VkBuffer GetDrawBuffer(CullPhase phase) const;
+	uint32_t GetCandidateCount() const { return static_cast<uint32_t>(m_vCandidates.size()); }
+
+private:
+	void CreatePyramid();
+	void CreateDescriptors();
+	void CreateCandidateBuffers(uint32_t capacity);
+	void UpdateCullDescriptorSet();
+	VkPipeline CreateComputePipeline(const std::string& shaderFile, VkPipelineLayout layout) const;
+	std::vector<uint32_t> GetSharedQueueFamilies() const;
+
+	VulkanContext m_Context{};
+	VkImageView m_DepthImageView{};
+
+	VkImage m_PyramidImage{};
+	VkDeviceMemory m_PyramidMemory{};
+	VkImageView m_PyramidView{};
+	std::vector<VkImageView> m_vPyramidMipViews{};
+	VkExtent2D m_PyramidExtent{};
+	uint32_t m_PyramidMipCount{ 0 };
+	std::shared_ptr<Sampler> m_pSampler{};
+	bool m_PyramidValid{ false };
+
+	VkDescriptorPool m_DescriptorPool{};
+	VkDescriptorSetLayout m_PyramidSetLayout{};
+	VkDescriptorSetLayout m_CullSetLayout{};
+	std::vector<VkDescriptorSet> m_vPyramidSets{};
+	VkDescriptorSet m_CullSet{};
+	VkPipelineLayout m_PyramidPipelineLayout{};
+	VkPipelineLayout m_CullPipelineLayout{};
+	VkPipeline m_PyramidPipeline{};
+	VkPipeline m_CullPipeline{};
+
+	std::vector<CullCandidate> m_vCandidates{};
+	std::unique_ptr<Buffer> m_CandidateBuffer{};
+	std::unique_ptr<Buffer> m_EarlyDrawBuffer{};
+	std::unique_ptr<Buffer> m_LateDrawBuffer{};
+	uint32_t m_CandidateCapacity{ 0 };
+	glm::mat4 m_ViewProjection{ 1.f };
+};
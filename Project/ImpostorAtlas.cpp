@@ -0,0 +1,241 @@
+//---------------------------
+// Includes
+//---------------------------
+#include "ImpostorAtlas.h"
+#include <stb_image.h>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+#include "Frustum.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	// Twice the signed area of abp, positive when p lies on the same side for every edge of a triangle wound like ab
+	float EdgeFunction(const glm::vec2& a, const glm::vec2& b, const glm::vec2& p)
+	{
+		return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+	}
+
+	// The atlas is sampled as sRGB, normals are stored encoded so they come back out of the sampler unchanged
+	uint8_t EncodeLinear(float linear)
+	{
+		const float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * glm::pow(linear, 1.f / 2.4f) - 0.055f;
+		return static_cast<uint8_t>(glm::clamp(srgb * 255.f + 0.5f, 0.f, 255.f));
+	}
+}
+
+//---------------------------
+// Member functions
+//---------------------------
+
+void ImpostorAtlas::Bake(std::span<const Vertex3D> vVertices, std::span<const uint32_t> vIndices, const std::string& textureFile, uint32_t framesPerSide, uint32_t frameSize)
+{
+	if (vVertices.empty() || vIndices.empty())
+		throw std::runtime_error("impostor mesh has no geometry to bake!");
+	if (framesPerSide == 0 || !std::has_single_bit(frameSize))
+		throw std::runtime_error("impostor frame size has to be a power of two!");
+
+	int width, height, channels;
+	const std::string filePath = "resources/" + textureFile;
+	stbi_uc* pixels = stbi_load(filePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!pixels)
+		throw std::runtime_error("failed to load impostor texture " + textureFile + "!");
+
+	TextureMipLevel image{};
+	image.width = static_cast<uint32_t>(width);
+	image.height = static_cast<uint32_t>(height);
+	image.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+	stbi_image_free(pixels);
+
+	// Every frame has to hold the mesh seen from any side, so they are all sized to the sphere around it
+	BoundingBox bounds{};
+	for (const Vertex3D& vertex : vVertices)
+		bounds.Expand(vertex.pos);
+	float radius{ 0.f };
+	for (const Vertex3D& vertex : vVertices)
+		radius = std::max(radius, glm::distance(vertex.pos, bounds.GetCenter()));
+	m_Sphere = glm::vec4(bounds.GetCenter(), std::max(radius, std::numeric_limits<float>::epsilon()));
+	m_FramesPerSide = framesPerSide;
+	m_FrameSize = frameSize;
+
+	const uint32_t atlasHeight = framesPerSide * frameSize;
+	m_vMipLevels.clear();
+	m_vMipLevels.push_back(TextureMipLevel{ atlasHeight * 2, atlasHeight, std::vector<uint8_t>(static_cast<size_t>(atlasHeight) * 2 * atlasHeight * 4, 0) });
+
+	// Frames write disjoint texels, so each one is a task of its own
+	ThreadPool::Get().ParallelFor(framesPerSide * framesPerSide, [&](uint32_t frame)
+		{
+			BakeFrame(frame % framesPerSide, frame / framesPerSide, vVertices, vIndices, image);
+		});
+
+	// Frames start on multiples of the frame size, so no level down to one texel per frame mixes two of them
+	Texture::GenerateMipLevels(m_vMipLevels, static_cast<uint32_t>(std::bit_width(frameSize)));
+}
+
+std::shared_ptr<Texture> ImpostorAtlas::CreateTexture(const VulkanContext& context) const
+{
+	if (m_vMipLevels.empty())
+		throw std::runtime_error("impostor atlas has not been baked!");
+	return std::make_shared<Texture>(m_vMipLevels, context);
+}
+
+glm::vec2 ImpostorAtlas::EncodeOctahedral(const glm::vec3& direction)
+{
+	const glm::vec3 octahedron = direction / (glm::abs(direction.x) + glm::abs(direction.y) + glm::abs(direction.z));
+	glm::vec2 position{ octahedron.x, octahedron.z };
+	// The lower half folds over the diagonals onto the corners
+	if (octahedron.y < 0.f)
+		position = (1.f - glm::abs(glm::vec2{ octahedron.z, octahedron.x })) * glm::vec2{ octahedron.x >= 0.f ? 1.f : -1.f, octahedron.z >= 0.f ? 1.f : -1.f };
+	return position * 0.5f + 0.5f;
+}
+
+glm::vec3 ImpostorAtlas::DecodeOctahedral(const glm::vec2& uv)
+{
+	const glm::vec2 position = uv * 2.f - 1.f;
+	glm::vec3 direction{ position.x, 1.f - glm::abs(position.x) - glm::abs(position.y), position.y };
+	if (direction.y < 0.f)
+	{
+		const glm::vec2 folded = (1.f - glm::abs(glm::vec2{ direction.z, direction.x })) * glm::vec2{ direction.x >= 0.f ? 1.f : -1.f, direction.z >= 0.f ? 1.f : -1.f };
+		direction.x = folded.x;
+		direction.z = folded.y;
+	}
+	return glm::normalize(direction);
+}
+
+void ImpostorAtlas::GetFrameBasis(const glm::vec3& forward, glm::vec3& right, glm::vec3& up)
+{
+	const glm::vec3 reference = glm::abs(forward.y) > 0.999f ? glm::vec3{ 0.f, 0.f, 1.f } : glm::vec3{ 0.f, 1.f, 0.f };
+	right = glm::normalize(glm::cross(reference, forward));
+	up = glm::cross(forward, right);
+}
+
+void ImpostorAtlas::BakeFrame(uint32_t frameX, uint32_t frameY, std::span<const Vertex3D> vVertices, std::span<const uint32_t> vIndices, const TextureMipLevel& image)
+{
+	const glm::vec3 forward = DecodeOctahedral((glm::vec2(frameX, frameY) + 0.5f) / static_cast<float>(m_FramesPerSide));
+	glm::vec3 right{};
+	glm::vec3 up{};
+	GetFrameBasis(forward, right, up);
+
+	// Orthographic along forward: xy in texels of the frame with y down like the texture, z grows towards the viewer
+	const glm::vec3 center{ m_Sphere };
+	const float halfSize = m_FrameSize * 0.5f;
+	const float texelsPerUnit = halfSize / m_Sphere.w;
+	std::vector<glm::vec3> vProjected(vVertices.size());
+	for (size_t i{}; i < vVertices.size(); ++i)
+	{
+		const glm::vec3 offset = vVertices[i].pos - center;
+		vProjected[i] = glm::vec3{ halfSize + glm::dot(offset, right) * texelsPerUnit, halfSize - glm::dot(offset, up) * texelsPerUnit, glm::dot(offset, forward) };
+	}
+
+	TextureMipLevel& atlas = m_vMipLevels[0];
+	const uint32_t normalOffset = atlas.width / 2;
+	auto getTexel = [&](uint32_t x, uint32_t y)
+		{
+			return &atlas.pixels[(static_cast<size_t>(frameY * m_FrameSize + y) * atlas.width + frameX * m_FrameSize + x) * 4];
+		};
+
+	std::vector<float> vDepth(static_cast<size_t>(m_FrameSize) * m_FrameSize, std::numeric_limits<float>::lowest());
+	for (size_t i{}; i + 2 < vIndices.size(); i += 3)
+	{
+		const std::array<uint32_t, 3> corners{ vIndices[i], vIndices[i + 1], vIndices[i + 2] };
+		const glm::vec3& a = vProjected[corners[0]];
+		const glm::vec3& b = vProjected[corners[1]];
+		const glm::vec3& c = vProjected[corners[2]];
+
+		// Both windings are rasterized, the depth test keeps whatever is in front
+		const float area = EdgeFunction(a, b, c);
+		if (glm::abs(area) < 1e-8f)
+			continue;
+
+		const glm::vec2 first = glm::max(glm::floor(glm::min(glm::min(glm::vec2(a), glm::vec2(b)), glm::vec2(c))), glm::vec2(0.f));
+		const glm::vec2 last = glm::min(glm::ceil(glm::max(glm::max(glm::vec2(a), glm::vec2(b)), glm::vec2(c))), glm::vec2(static_cast<float>(m_FrameSize - 1)));
+		if (first.x > last.x || first.y > last.y)
+			continue;
+
+		for (uint32_t y = static_cast<uint32_t>(first.y); y <= static_cast<uint32_t>(last.y); ++y)
+		{
+			for (uint32_t x = static_cast<uint32_t>(first.x); x <= static_cast<uint32_t>(last.x); ++x)
+			{
+				const glm::vec2 point{ x + 0.5f, y + 0.5f };
+				const float w0 = EdgeFunction(b, c, point) / area;
+				const float w1 = EdgeFunction(c, a, point) / area;
+				const float w2 = 1.f - w0 - w1;
+				if (w0 < 0.f || w1 < 0.f || w2 < 0.f)
+					continue;
+
+				float& nearest = vDepth[static_cast<size_t>(y) * m_FrameSize + x];
+				const float depth = w0 * a.z + w1 * b.z + w2 * c.z;
+				if (depth <= nearest)
+					continue;
+				nearest = depth;
+
+				const Vertex3D& v0 = vVertices[corners[0]];
+				const Vertex3D& v1 = vVertices[corners[1]];
+				const Vertex3D& v2 = vVertices[corners[2]];
+
+				// Nearest texel with wrapping, like the repeating sampler at the mip closest to the frame's scale would give
+				const glm::vec2 texCoord = w0 * v0.texCoord + w1 * v1.texCoord + w2 * v2.texCoord;
+				const glm::vec2 wrapped = texCoord - glm::floor(texCoord);
+				const uint32_t sourceX = std::min(static_cast<uint32_t>(wrapped.x * image.width), image.width - 1);
+				const uint32_t sourceY = std::min(static_cast<uint32_t>(wrapped.y * image.height), image.height - 1);
+				const uint8_t* pSource = &image.pixels[(static_cast<size_t>(sourceY) * image.width + sourceX) * 4];
+				const glm::vec3 color = w0 * v0.color + w1 * v1.color + w2 * v2.color;
+
+				uint8_t* pAlbedo = getTexel(x, y);
+				for (int channel{}; channel < 3; ++channel)
+					pAlbedo[channel] = static_cast<uint8_t>(glm::clamp(pSource[channel] * color[channel], 0.f, 255.f));
+				pAlbedo[3] = 255;
+
+				glm::vec3 normal = w0 * v0.normal + w1 * v1.normal + w2 * v2.normal;
+				normal = glm::dot(normal, normal) > 0.f ? glm::normalize(normal) : forward;
+				const glm::vec3 frameNormal{ glm::dot(normal, right), glm::dot(normal, up), glm::dot(normal, forward) };
+				uint8_t* pNormal = getTexel(x + normalOffset, y);
+				for (int channel{}; channel < 3; ++channel)
+					pNormal[channel] = EncodeLinear(frameNormal[channel] * 0.5f + 0.5f);
+				pNormal[3] = 255;
+			}
+		}
+	}
+
+	// Texels outside the silhouette take the frame's average, filtering at the edge then blends towards a color
+	// of the mesh instead of black
+	glm::vec3 albedoSum{ 0.f };
+	glm::vec3 normalSum{ 0.f };
+	uint32_t coveredCount{ 0 };
+	for (uint32_t y{}; y < m_FrameSize; ++y)
+	{
+		for (uint32_t x{}; x < m_FrameSize; ++x)
+		{
+			const uint8_t* pAlbedo = getTexel(x, y);
+			if (pAlbedo[3] == 0)
+				continue;
+			const uint8_t* pNormal = getTexel(x + normalOffset, y);
+			albedoSum += glm::vec3{ pAlbedo[0], pAlbedo[1], pAlbedo[2] };
+			normalSum += glm::vec3{ pNormal[0], pNormal[1], pNormal[2] };
+			++coveredCount;
+		}
+	}
+	if (coveredCount == 0)
+		return;
+
+	const glm::vec3 albedoAverage = albedoSum / static_cast<float>(coveredCount);
+	const glm::vec3 normalAverage = normalSum / static_cast<float>(coveredCount);
+	for (uint32_t y{}; y < m_FrameSize; ++y)
+	{
+		for (uint32_t x{}; x < m_FrameSize; ++x)
+		{
+			uint8_t* pAlbedo = getTexel(x, y);
+			if (pAlbedo[3] != 0)
+				continue;
+			uint8_t* pNormal = getTexel(x + normalOffset, y);
+			for (int channel{}; channel < 3; ++channel)
+			{
+				pAlbedo[channel] = static_cast<uint8_t>(albedoAverage[channel] + 0.5f);
+				pNormal[channel] = static_cast<uint8_t>(normalAverage[channel] + 0.5f);
+			}
+		}
+	}
+}
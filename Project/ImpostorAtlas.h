@@ -0,0 +1,70 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <vector>
+#include <string>
+#include <memory>
+#include <span>
+#include <glm/glm.hpp>
+#include "vulkanbase/VulkanUtil.h"
+#include "Vertex.h"
+#include "Texture.h"
+
+// How an instanced mesh is replaced at a distance. Instances nearer than fadeStart draw the mesh, instances beyond
+// fadeEnd the impostor, and in between the two are dithered into each other.
+struct ImpostorSettings
+{
+	uint32_t framesPerSide{ 0 };	// 0 disables the impostor
+	uint32_t frameSize{ 64 };		// texels along each side of one frame, a power of two
+	float fadeStart{ 0.f };
+	float fadeEnd{ 0.f };
+};
+
+//-----------------------------------------------------
+// ImpostorAtlas Class
+//-----------------------------------------------------
+// Pictures of a mesh taken from framesPerSide² directions spread over the sphere by an octahedral mapping, so the
+// direction an instance is seen from picks a frame with a couple of shader instructions. The frames are rendered
+// on the CPU with an orthographic projection: albedo with alpha coverage in the left half of the texture and the
+// normals, in the basis of their frame, in the right half, so the impostor is lit like the mesh.
+class ImpostorAtlas final
+{
+public:
+	ImpostorAtlas() = default;
+	~ImpostorAtlas() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	ImpostorAtlas(const ImpostorAtlas& other)					= delete;
+	ImpostorAtlas(ImpostorAtlas&& other) noexcept				= delete;
+	ImpostorAtlas& operator=(const ImpostorAtlas& other)		= delete;
+	ImpostorAtlas& operator=(ImpostorAtlas&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	// The texture is loaded from the resources folder like Texture does, the frames are baked on the thread pool
+	void Bake(std::span<const Vertex3D> vVertices, std::span<const uint32_t> vIndices, const std::string& textureFile, uint32_t framesPerSide, uint32_t frameSize);
+	std::shared_ptr<Texture> CreateTexture(const VulkanContext& context) const;
+
+	uint32_t GetFramesPerSide() const { return m_FramesPerSide; }
+	// xyz: center, w: radius of the mesh space sphere the frames were taken around
+	const glm::vec4& GetSphere() const { return m_Sphere; }
+
+	// Unit directions onto [0, 1]² with y as the pole, the vertex shader has the same mapping
+	static glm::vec2 EncodeOctahedral(const glm::vec3& direction);
+	static glm::vec3 DecodeOctahedral(const glm::vec2& uv);
+	// Right and up of the plane the frame seen from forward was rendered in
+	static void GetFrameBasis(const glm::vec3& forward, glm::vec3& right, glm::vec3& up);
+
+private:
+	void BakeFrame(uint32_t frameX, uint32_t frameY, std::span<const Vertex3D> vVertices, std::span<const uint32_t> vIndices, const TextureMipLevel& image);
+
+	std::vector<TextureMipLevel> m_vMipLevels{};
+	glm::vec4 m_Sphere{ 0.f };
+	uint32_t m_FramesPerSide{ 0 };
+	uint32_t m_FrameSize{ 0 };
+};
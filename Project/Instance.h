@@ -5,7 +5,9 @@
 struct InstanceVertex 
 {
 	glm::mat4 modelTransform;
-	glm::vec2 texCoord;
+	glm::vec4 atlasRect{ 0, 0, 1, 1 };	// xy: uv offset, zw: uv scale of the texture atlas cell
+	glm::vec4 animation;		// xyz: rotation axis, w: angular speed in radians per second
+	float animationPhase;
 	static VkVertexInputBindingDescription GetBindingDescription() 
 	{
 		VkVertexInputBindingDescription bindingDescription{};
@@ -16,7 +18,7 @@ struct InstanceVertex
 	}
 	static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions(uint32_t location) 
 	{
-		std::vector<VkVertexInputAttributeDescription> attributeDescriptions(5);
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions(7);
 		uint32_t binding = 1;
 		for (int i = 0; i < 4; i++) 
 		{
@@ -27,8 +29,16 @@ struct InstanceVertex
 		}
 		attributeDescriptions[4].binding = binding;
 		attributeDescriptions[4].location = location + 4;
-		attributeDescriptions[4].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[4].offset = offsetof(InstanceVertex, texCoord);
+		attributeDescriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attributeDescriptions[4].offset = offsetof(InstanceVertex, atlasRect);
+		attributeDescriptions[5].binding = binding;
+		attributeDescriptions[5].location = location + 5;
+		attributeDescriptions[5].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attributeDescriptions[5].offset = offsetof(InstanceVertex, animation);
+		attributeDescriptions[6].binding = binding;
+		attributeDescriptions[6].location = location + 6;
+		attributeDescriptions[6].format = VK_FORMAT_R32_SFLOAT;
+		attributeDescriptions[6].offset = offsetof(InstanceVertex, animationPhase);
 		return attributeDescriptions;
 	}
 };
\ No newline at end of file
@@ -0,0 +1,150 @@
+
+//---------------------------
+// Includes
+//---------------------------
+#include "InstanceGrid.h"
+#include <algorithm>
+
+namespace
+{
+	// Keeps the dense lookup table at a sane size for very large or very sparse worlds
+	constexpr uint32_t maxGridCells{ 1u << 22 };
+
+	// Spreads the low 10 bits of value two bits apart, so three of them interleave into a 30 bit code
+	uint32_t SpreadBits(uint32_t value)
+	{
+		value &= 0x3FF;
+		value = (value | (value << 16)) & 0x030000FF;
+		value = (value | (value << 8)) & 0x0300F00F;
+		value = (value | (value << 4)) & 0x030C30C3;
+		value = (value | (value << 2)) & 0x09249249;
+		return value;
+	}
+
+	// Z-order position of a point in the unit cube
+	uint32_t GetMortonCode(const glm::vec3& unitPosition)
+	{
+		const glm::uvec3 quantized = glm::uvec3(glm::clamp(unitPosition, glm::vec3(0.f), glm::vec3(1.f)) * 1023.f);
+		return SpreadBits(quantized.x) | (SpreadBits(quantized.y) << 1) | (SpreadBits(quantized.z) << 2);
+	}
+
+	float GetMaxColumnLength(const glm::mat4& matrix)
+	{
+		return glm::sqrt(glm::max(glm::max(glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])), glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1]))), glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))));
+	}
+}
+
+//---------------------------
+// Member functions
+//---------------------------
+
+void InstanceGrid::Build(std::vector<InstanceVertex>& vInstances, const glm::mat4& meshTransform, const BoundingBox& localBounds, float cellSize, bool spatialOrder, uint32_t targetInstancesPerCell)
+{
+	m_vCells.clear();
+	m_vCellLookup.clear();
+	m_MaxInstanceRadius = 0.f;
+	if (vInstances.empty() || !localBounds.IsValid())
+		return;
+
+	// Instances spin around their own origin, so they are bounded by a sphere that is valid for any rotation
+	const glm::vec3 meshCenter = glm::vec3(meshTransform[3]);
+	const float meshRadius = localBounds.GetRadiusAroundOrigin() * GetMaxColumnLength(meshTransform);
+
+	std::vector<glm::vec4> vSpheres(vInstances.size());
+	BoundingBox centerBounds{};
+	for (size_t i{}; i < vInstances.size(); ++i)
+	{
+		const glm::mat4& model = vInstances[i].modelTransform;
+		const glm::vec3 center = glm::vec3(model * glm::vec4(meshCenter, 1.f));
+		vSpheres[i] = glm::vec4(center, meshRadius * GetMaxColumnLength(model));
+		centerBounds.Expand(center);
+	}
+
+	const glm::vec3 extent = glm::max(centerBounds.max - centerBounds.min, glm::vec3(1e-3f));
+	if (cellSize <= 0.f)
+	{
+		const uint32_t targetCellCount = std::max(static_cast<uint32_t>(vInstances.size()) / std::max(targetInstancesPerCell, 1u), 1u);
+		cellSize = std::max(std::max(extent.x, extent.y), extent.z);
+		while (GetCellCount(cellSize * 0.5f, extent) <= targetCellCount)
+			cellSize *= 0.5f;
+	}
+	while (GetCellCount(cellSize, extent) > maxGridCells)
+		cellSize *= 2.f;
+
+	m_CellSize = cellSize;
+	m_Origin = centerBounds.min;
+	m_Dimensions = glm::max(glm::ivec3(glm::ceil(extent / cellSize)), glm::ivec3(1));
+
+	// Counting sort by grid cell keeps the order of instances inside a cell stable
+	const size_t gridCellCount = static_cast<size_t>(m_Dimensions.x) * m_Dimensions.y * m_Dimensions.z;
+	std::vector<uint32_t> vCellOf(vInstances.size());
+	std::vector<uint32_t> vCellStart(gridCellCount + 1, 0);
+	std::vector<uint32_t> vMortonCodes(spatialOrder ? vInstances.size() : 0);
+	for (size_t i{}; i < vInstances.size(); ++i)
+	{
+		const glm::ivec3 coordinate = glm::clamp(GetCellCoordinate(glm::vec3(vSpheres[i])), glm::ivec3(0), m_Dimensions - 1);
+		vCellOf[i] = static_cast<uint32_t>((coordinate.z * m_Dimensions.y + coordinate.y) * m_Dimensions.x + coordinate.x);
+		++vCellStart[vCellOf[i] + 1];
+
+		// Codes only get compared inside a cell, so they are taken relative to it for the full precision
+		if (spatialOrder)
+			vMortonCodes[i] = GetMortonCode((glm::vec3(vSpheres[i]) - m_Origin) / m_CellSize - glm::vec3(coordinate));
+	}
+	for (size_t cell{}; cell < gridCellCount; ++cell)
+		vCellStart[cell + 1] += vCellStart[cell];
+
+	m_vCellLookup.assign(gridCellCount, invalidCell);
+	for (size_t cell{}; cell < gridCellCount; ++cell)
+	{
+		const uint32_t count = vCellStart[cell + 1] - vCellStart[cell];
+		if (count == 0)
+			continue;
+
+		m_vCellLookup[cell] = static_cast<uint32_t>(m_vCells.size());
+		m_vCells.push_back(InstanceCell{ BoundingBox{}, vCellStart[cell], count });
+	}
+
+	std::vector<InstanceVertex> vSorted(vInstances.size());
+	std::vector<uint32_t> vNextSlot(vCellStart.begin(), vCellStart.end() - 1);
+	std::vector<uint64_t> vSortKeys(spatialOrder ? vInstances.size() : 0);
+	for (size_t i{}; i < vInstances.size(); ++i)
+	{
+		const uint32_t slot = vNextSlot[vCellOf[i]]++;
+		vSorted[slot] = vInstances[i];
+		if (spatialOrder)
+			vSortKeys[slot] = (static_cast<uint64_t>(vMortonCodes[i]) << 32) | slot;
+
+		const glm::vec3 center = glm::vec3(vSpheres[i]);
+		const float radius = vSpheres[i].w;
+		InstanceCell& cell = m_vCells[m_vCellLookup[vCellOf[i]]];
+		cell.bounds.Expand(center - radius);
+		cell.bounds.Expand(center + radius);
+		m_MaxInstanceRadius = std::max(m_MaxInstanceRadius, radius);
+	}
+
+	// The slot in the low bits breaks ties, so equal codes keep their generated order. Cell bounds do not
+	// depend on the order inside the cell.
+	if (spatialOrder)
+	{
+		for (const InstanceCell& cell : m_vCells)
+			std::sort(vSortKeys.begin() + cell.firstInstance, vSortKeys.begin() + cell.firstInstance + cell.instanceCount);
+
+		vInstances.resize(vSorted.size());
+		for (size_t slot{}; slot < vSorted.size(); ++slot)
+			vInstances[slot] = vSorted[static_cast<uint32_t>(vSortKeys[slot])];
+		return;
+	}
+	vInstances = std::move(vSorted);
+}
+
+glm::ivec3 InstanceGrid::GetCellCoordinate(const glm::vec3& position) const
+{
+	return glm::ivec3(glm::floor((position - m_Origin) / m_CellSize));
+}
+
+uint32_t InstanceGrid::GetCellCount(float cellSize, const glm::vec3& extent) const
+{
+	const glm::vec3 dimensions = glm::max(glm::ceil(extent / cellSize), glm::vec3(1.f));
+	const float cellCount = dimensions.x * dimensions.y * dimensions.z;
+	return cellCount >= static_cast<float>(UINT32_MAX) ? UINT32_MAX : static_cast<uint32_t>(cellCount);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <vector>
+#include <glm/glm.hpp>
+#include "Instance.h"
+#include "Frustum.h"
+
+struct InstanceCell
+{
+	BoundingBox bounds{};
+	uint32_t firstInstance{ 0 };
+	uint32_t instanceCount{ 0 };
+};
+
+//-----------------------------------------------------
+// InstanceGrid Class
+//-----------------------------------------------------
+// Uniform grid over an instance set. Build() reorders the instances so every cell owns one
+// contiguous range of the instance buffer, which lets a whole cell be culled, drawn or streamed as a unit.
+// Cells stay in row order so neighbouring visible cells still merge into one draw, spatialOrder additionally
+// sorts each cell's range by the Morton code of the instance centers.
+class InstanceGrid final
+{
+public:
+	static constexpr uint32_t invalidCell{ UINT32_MAX };
+
+	// cellSize 0 picks a size that puts roughly targetInstancesPerCell instances in every cell.
+	// The order only depends on the instances, building the same set again gives the same buffer.
+	void Build(std::vector<InstanceVertex>& vInstances, const glm::mat4& meshTransform, const BoundingBox& localBounds, float cellSize = 0.f, bool spatialOrder = false, uint32_t targetInstancesPerCell = 1024);
+
+	// Visits the non-empty cells in the frustum. Only grid cells overlapping the frustum's bounds are looked at.
+	template<typename Func>
+	void ForEachVisibleCell(const Frustum& frustum, Func&& func) const;
+
+	const std::vector<InstanceCell>& GetCells() const { return m_vCells; }
+	bool IsEmpty() const { return m_vCells.empty(); }
+
+private:
+	glm::ivec3 GetCellCoordinate(const glm::vec3& position) const;
+	uint32_t GetCellCount(float cellSize, const glm::vec3& extent) const;
+
+	glm::vec3 m_Origin{};
+	glm::ivec3 m_Dimensions{ 0 };
+	float m_CellSize{ 1.f };
+	float m_MaxInstanceRadius{ 0.f };
+
+	std::vector<uint32_t> m_vCellLookup{};	// grid cell -> index in m_vCells, invalidCell when empty
+	std::vector<InstanceCell> m_vCells{};
+};
+
+template<typename Func>
+inline void InstanceGrid::ForEachVisibleCell(const Frustum& frustum, Func&& func) const
+{
+	if (m_vCells.empty())
+		return;
+
+	// Instances are binned by their center, so a cell's contents can stick out of it by one instance radius
+	const BoundingBox frustumBounds = frustum.GetBounds();
+	const glm::ivec3 first = glm::max(GetCellCoordinate(frustumBounds.min - m_MaxInstanceRadius), glm::ivec3(0));
+	const glm::ivec3 last = glm::min(GetCellCoordinate(frustumBounds.max + m_MaxInstanceRadius), m_Dimensions - 1);
+
+	for (int z = first.z; z <= last.z; ++z)
+		for (int y = first.y; y <= last.y; ++y)
+			for (int x = first.x; x <= last.x; ++x)
+			{
+				const uint32_t cellIndex = m_vCellLookup[(z * m_Dimensions.y + y) * m_Dimensions.x + x];
+				if (cellIndex != invalidCell && frustum.Intersects(m_vCells[cellIndex].bounds))
+					func(m_vCells[cellIndex]);
+			}
+}
@@ -1,34 +1,63 @@
 #include "Mesh.h"
-#include "CommandBuffer.h"
 #include "Utils.h"
+#include "ThreadPool.h"
 #include <numbers>
+#include <algorithm>
+#include <stdexcept>
 
+namespace
+{
+	template<typename Vertex>
+	std::shared_ptr<Buffer> UploadVertices(const VulkanContext& context, UploadBatch& batch, const std::vector<Vertex>& vVertices)
+	{
+		VkDeviceSize bufferSize = sizeof(Vertex) * vVertices.size();
+
+		auto pVertexBuffer = std::make_shared<Buffer>(context, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, bufferSize);
+
+		context.pTransferQueue->CopyToBuffer(batch, vVertices.data(), bufferSize, pVertexBuffer->GetVkBuffer(), VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+		return pVertexBuffer;
+	}
+}
 
-void Mesh::Initialize(const VkPhysicalDevice& physicalDevice, const VkDevice& device, const CommandPool& commandPool, VkQueue graphicsQueue)
+std::shared_ptr<MeshAsset> MeshAsset::Import(const std::string& fileName, const MeshImportOptions& options)
 {
-	CreateVertexBuffer(physicalDevice, device, commandPool, graphicsQueue);
-	CreateIndexBuffer(physicalDevice, device, commandPool, graphicsQueue);
-	glm::mat4 transform;
-	const int amountOfMeshesPerSide = static_cast<int>(sqrtf(m_InstanceCount));
-	for (int i{}; i < m_InstanceCount; ++i)
+	auto pAsset = std::make_shared<MeshAsset>();
+	ParseOBJ(fileName, pAsset->vVertices, pAsset->vIndices, options.flipAxisAndWinding);
+	pAsset->cpuDataPolicy = options.cpuDataPolicy;
+	pAsset->indexCount = static_cast<uint32_t>(pAsset->vIndices.size());
+	for (Vertex3D& vertex : pAsset->vVertices)
 	{
-		int x = i % amountOfMeshesPerSide;
-		int y = i / amountOfMeshesPerSide;
-		InstanceVertex instance{};
-		transform = glm::translate(glm::mat4(1), (m_InstancedMeshData.maxOffset - m_InstancedMeshData.minOffset) * glm::vec3(x, 0, y) / 2.f);
-		m_InstancedMeshData.RandomizeTranslation(transform);
-		m_InstancedMeshData.RandomizeRotation(transform);
-		m_InstancedMeshData.RandomizeScale(transform);
-
-		instance.modelTransform = GetVertexConstant().model * transform;
-		m_vInstanceData.push_back(instance);
+		vertex.color = { 1,1,1 };
+		pAsset->bounds.Expand(vertex.pos);
 	}
-	CreateInstancedVertexBuffer(physicalDevice, device, commandPool, graphicsQueue);
+	return pAsset;
 }
 
-void Mesh::Initialize(const VulkanContext& context, const CommandPool& commandPool)
+void Mesh::Initialize(const VulkanContext& context, UploadBatch& batch)
 {
-	Initialize(context.physicalDevice, context.device, commandPool, context.graphicsQueue);
+	CreateVertexBuffer(context, batch);
+	if (!m_IndexBuffer)
+		m_IndexBuffer = CreateIndexBuffer(context, batch, m_vIndices);
+	if (m_pInstanceSource)
+	{
+		// Same instances in the same order, so the grid's ranges index the shared buffer as well
+		if (!m_pInstanceSource->m_InstanceBuffer)
+			throw std::runtime_error("impostor initialized before the mesh it shares instances with!");
+		m_InstanceBuffer = m_pInstanceSource->m_InstanceBuffer;
+		m_InstanceGrid = m_pInstanceSource->m_InstanceGrid;
+		m_pInstanceSource = nullptr;
+	}
+	else
+	{
+		GenerateInstances();
+		if (m_InstanceCount > 1)
+			m_InstanceGrid.Build(m_vInstanceData, GetVertexConstant().model, m_LocalBounds, m_InstancedMeshData.cellSize, m_InstancedMeshData.spatialOrder);
+		CreateInstancedVertexBuffer(context, batch);
+	}
+
+	// Everything has been copied into the batch's staging buffers at this point
+	if (m_CpuDataPolicy == CpuDataPolicy::ReleaseAfterUpload)
+		ReleaseCpuData();
 }
 
 void Mesh::DestroyMesh(const VkDevice& device)
@@ -39,98 +68,201 @@ void Mesh::DestroyMesh(const VkDevice& device)
 	m_pTexture.reset();
 }
 
-void Mesh::Draw(VkPipelineLayout pipelineLayout, const VkCommandBuffer& vkCommandBuffer)
+void Mesh::BindGeometry(const VkCommandBuffer& vkCommandBuffer) const
 {
 	m_VertexBuffer->BindAsVertexBuffer(vkCommandBuffer);
 	m_IndexBuffer->BindAsIndexBuffer(vkCommandBuffer);
+	if (m_InstanceCount > 1)
+		m_InstanceBuffer->BindAsVertexBuffer(vkCommandBuffer, 1);
+}
 
-	vkCmdPushConstants(
-		vkCommandBuffer,
-		pipelineLayout,
-		VK_SHADER_STAGE_VERTEX_BIT, // Stage flag should match the push constant range in the layout
-		0, // Offset within the push constant block
-		sizeof(MeshData), // Size of the push constants to update
-		&m_VertexConstant // Pointer to the data
-	);
+MeshData Mesh::GetObjectData() const
+{
+	// Instances carry their own animation, a single mesh spins through its object data.
+	// The world matrix stays in the hierarchy's buffer, the shader looks it up by node.
+	MeshData objectData = m_VertexConstant;
+	objectData.transformNode = m_pTransforms ? m_TransformNode : TransformHierarchy::invalidNode;
+	objectData.animation.w = (m_RotationEnabled && m_InstanceCount <= 1) ? glm::radians(m_RotationSpeed) : 0.f;
+	return objectData;
+}
 
-	if (m_InstanceCount > 1) 
+void Mesh::Draw(const VkCommandBuffer& vkCommandBuffer, uint32_t firstInstance, uint32_t instanceCount) const
+{
+	vkCmdDrawIndexed(vkCommandBuffer, m_IndexCount, instanceCount, 0, 0, firstInstance);
+}
+
+void Mesh::DrawIndirect(const VkCommandBuffer& vkCommandBuffer, VkBuffer drawBuffer, VkDeviceSize offset, uint32_t drawCount) const
+{
+	vkCmdDrawIndexedIndirect(vkCommandBuffer, drawBuffer, offset, drawCount, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void Mesh::CollectDraws(uint32_t pipelineId, uint32_t meshIndex, uint32_t descriptorSetIndex, const Frustum& frustum, const glm::mat4& view, RenderQueue& queue, bool mergeCells) const
+{
+	auto pushDraw = [&](uint32_t firstInstance, uint32_t instanceCount, const BoundingBox& bounds, float viewDepth)
+		{
+			const uint64_t sortKey = RenderQueue::CreateSortKey(pipelineId, descriptorSetIndex, meshIndex, viewDepth);
+			queue.Push(DrawCommand{ sortKey, meshIndex, descriptorSetIndex, firstInstance, instanceCount, bounds });
+		};
+	auto getViewDepth = [&view](const glm::vec3& position) { return -(view * glm::vec4(position, 1.f)).z; };
+
+	if (m_InstanceCount <= 1)
 	{
-		 m_InstanceBuffer->Upload(m_vInstanceData.data());
-		 m_InstanceBuffer->BindAsVertexBuffer(vkCommandBuffer, 1);
+		glm::mat4 model = m_VertexConstant.model;
+		if (m_pTransforms)
+			model = m_pTransforms->GetWorldMatrix(m_TransformNode) * model;
+
+		// A spinning mesh is only bounded by the sphere that holds it under any rotation
+		BoundingBox bounds = m_LocalBounds.Transform(model);
+		if (m_RotationEnabled)
+		{
+			const glm::vec3 origin = glm::vec3(model[3]);
+			const float radius = m_LocalBounds.GetRadiusAroundOrigin() * glm::max(glm::max(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1]))), glm::length(glm::vec3(model[2])));
+			bounds = BoundingBox{ origin - radius, origin + radius };
+		}
+		pushDraw(0, m_InstanceCount, bounds, getViewDepth(bounds.GetCenter()));
+		return;
 	}
-	vkCmdDrawIndexed(vkCommandBuffer, static_cast<uint32_t>(m_vIndices.size()), m_InstanceCount, 0, 0, 0);
+
+	// Cells the cross fade hides completely are skipped, the mesh past the fade's end and the impostor before its start
+	const glm::vec2 lodFade = m_VertexConstant.lodFade;
+	const bool fading = lodFade.x != lodFade.y;
+	const glm::vec3 cameraPosition = fading ? glm::vec3(glm::inverse(view)[3]) : glm::vec3(0.f);
+
+	// Neighbouring cells own neighbouring instance ranges, so runs of visible cells collapse into one draw
+	// that sorts by its nearest cell
+	uint32_t firstInstance{ 0 };
+	uint32_t instanceCount{ 0 };
+	BoundingBox bounds{};
+	float viewDepth{ 0.f };
+	m_InstanceGrid.ForEachVisibleCell(frustum, [&](const InstanceCell& cell)
+		{
+			if (fading && m_ReplacedIndexCount > 0 && cell.bounds.GetMaxDistance(cameraPosition) <= lodFade.x)
+				return;
+			if (fading && m_ReplacedIndexCount == 0 && cell.bounds.GetMinDistance(cameraPosition) >= lodFade.y)
+				return;
+
+			const float cellDepth = getViewDepth(cell.bounds.GetCenter());
+			if (mergeCells && instanceCount > 0 && cell.firstInstance == firstInstance + instanceCount)
+			{
+				instanceCount += cell.instanceCount;
+				bounds.Expand(cell.bounds);
+				viewDepth = std::min(viewDepth, cellDepth);
+				return;
+			}
+			if (instanceCount > 0)
+				pushDraw(firstInstance, instanceCount, bounds, viewDepth);
+			firstInstance = cell.firstInstance;
+			instanceCount = cell.instanceCount;
+			bounds = cell.bounds;
+			viewDepth = cellDepth;
+		});
+	if (instanceCount > 0)
+		pushDraw(firstInstance, instanceCount, bounds, viewDepth);
 }
 
 void Mesh::SetIndices(const std::vector<uint32_t>& vIndices)
 {
 	m_vIndices = vIndices;
+	m_IndexCount = static_cast<uint32_t>(m_vIndices.size());
 }
 
-void Mesh::CreateInstancedVertexBuffer(VkPhysicalDevice physicalDevice, VkDevice device, const CommandPool& commandPool, VkQueue graphicsQueue)
+void Mesh::SetIndices(std::vector<uint32_t>&& vIndices)
 {
-	VkDeviceSize bufferSize = sizeof(InstanceVertex) * m_vInstanceData.size();
-	m_InstanceBuffer = std::make_unique<Buffer>(physicalDevice, device, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, bufferSize);
-	m_InstanceBuffer->Map();
+	m_vIndices = std::move(vIndices);
+	m_IndexCount = static_cast<uint32_t>(m_vIndices.size());
 }
 
-void Mesh::CreateIndexBuffer(VkPhysicalDevice physicalDevice, VkDevice device, const CommandPool& commandPool, VkQueue graphicsQueue)
+void Mesh::SetInstanceRange(uint32_t firstInstance, uint32_t instanceCount, uint32_t totalInstanceCount)
 {
-	VkDeviceSize bufferSize = sizeof(decltype(m_vIndices)::value_type) * m_vIndices.size();
-
-	Buffer stagingBuffer{ physicalDevice, device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,bufferSize };
+	if (firstInstance % InstancedMeshData::chunkSize != 0 || firstInstance + instanceCount > totalInstanceCount)
+		throw std::invalid_argument("instance ranges have to start on a generation chunk and lie inside the set!");
 
-	void* data;
-	vkMapMemory(device, stagingBuffer.GetVkBufferMemory(), 0, bufferSize, 0, &data);
-	memcpy(data, m_vIndices.data(), (size_t)bufferSize);
-	vkUnmapMemory(device, stagingBuffer.GetVkBufferMemory());
-
-	m_IndexBuffer= std::make_unique<Buffer>(physicalDevice, device, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, bufferSize);
+	m_InstanceCount = instanceCount;
+	m_FirstInstance = firstInstance;
+	m_TotalInstanceCount = totalInstanceCount;
+}
 
-	CopyBuffer(device, commandPool, stagingBuffer, *m_IndexBuffer, bufferSize, graphicsQueue);
+void Mesh::ReleaseCpuData()
+{
+	// The index count and instance grid stay, drawing and culling only need those
+	std::vector<uint32_t>().swap(m_vIndices);
+	std::vector<InstanceVertex>().swap(m_vInstanceData);
 }
 
- void Mesh::CopyBuffer(const VkDevice& device, const CommandPool& commandPool, const Buffer& srcBuffer, const Buffer& dstBuffer, VkDeviceSize size, VkQueue graphicsQueue)
- {
-	 CommandBuffer commandBuffer = commandPool.CreateCommandBuffer();
+void Mesh::GenerateInstances()
+{
+	m_vInstanceData.resize(m_InstanceCount);
+
+	// Layout and random streams follow the whole set, so a range generates the same instances the full set has there
+	const uint32_t meshesPerSide = std::max(static_cast<uint32_t>(sqrtf(static_cast<float>(std::max(m_TotalInstanceCount, m_InstanceCount)))), 1u);
+	const uint32_t firstChunk = m_FirstInstance / InstancedMeshData::chunkSize;
+	const uint32_t chunkCount = (m_InstanceCount + InstancedMeshData::chunkSize - 1) / InstancedMeshData::chunkSize;
+	const glm::mat4 baseTransform = GetVertexConstant().model;
+
+	ThreadPool::Get().ParallelFor(chunkCount, [&](uint32_t chunk)
+		{
+			Pcg32 rng{ m_InstancedMeshData.seed, firstChunk + chunk };
+			const uint32_t firstInstance = chunk * InstancedMeshData::chunkSize;
+			const uint32_t lastInstance = std::min(firstInstance + InstancedMeshData::chunkSize, m_InstanceCount);
+			for (uint32_t i = firstInstance; i < lastInstance; ++i)
+			{
+				InstanceVertex instance{};
+				instance.modelTransform = baseTransform * m_InstancedMeshData.CreateTransform(m_FirstInstance + i, meshesPerSide, rng);
+				if (m_RotationEnabled)
+					m_InstancedMeshData.RandomizeAnimation(instance, rng);
+				if (!m_vAtlasCells.empty())
+					instance.atlasRect = m_vAtlasCells[rng.NextUInt() % m_vAtlasCells.size()];
+				m_vInstanceData[i] = instance;
+			}
+		});
+}
 
-	 VkCommandBufferBeginInfo beginInfo{};
-	 beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	 beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+void Mesh::CreateInstancedVertexBuffer(const VulkanContext& context, UploadBatch& batch)
+{
+	VkDeviceSize bufferSize = sizeof(InstanceVertex) * m_vInstanceData.size();
 
-	 vkBeginCommandBuffer(commandBuffer.GetVkCommandBuffer(), &beginInfo);
+	// Animation is evaluated on the GPU, so the instances are uploaded once and never touched again
+	m_InstanceBuffer = std::make_unique<Buffer>(context, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, bufferSize);
 
-	 VkBufferCopy copyRegion{};
-	 copyRegion.size = size;
-	 vkCmdCopyBuffer(commandBuffer.GetVkCommandBuffer(), srcBuffer.GetVkBuffer(), dstBuffer.GetVkBuffer(), 1, &copyRegion);
+	context.pTransferQueue->CopyToBuffer(batch, m_vInstanceData.data(), bufferSize, m_InstanceBuffer->GetVkBuffer(), VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+}
 
-	 vkEndCommandBuffer(commandBuffer.GetVkCommandBuffer());
+std::shared_ptr<Buffer> Mesh::CreateIndexBuffer(const VulkanContext& context, UploadBatch& batch, const std::vector<uint32_t>& vIndices)
+{
+	VkDeviceSize bufferSize = sizeof(uint32_t) * vIndices.size();
 
-	 VkSubmitInfo submitInfo{};
-	 submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	 commandBuffer.Submit(submitInfo);
+	auto pIndexBuffer = std::make_shared<Buffer>(context, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, bufferSize);
 
-	 vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	 vkQueueWaitIdle(graphicsQueue);
+	context.pTransferQueue->CopyToBuffer(batch, vIndices.data(), bufferSize, pIndexBuffer->GetVkBuffer(), VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+	return pIndexBuffer;
+}
 
-	 commandBuffer.FreeBuffer(device, commandPool);
- }
  //////////////////////////////////////////////
 
 
  void Mesh2D::AddVertex(const glm::vec2& pos, const glm::vec3& color)
  {
-	 m_vVertices.push_back(Vertex2D{ pos, color });
+	 AddVertex(Vertex2D{ pos, color });
  }
 
  void Mesh2D::AddVertex(const Vertex2D& vertex)
  {
+	 m_LocalBounds.Expand(glm::vec3(vertex.pos, 0.f));
 	 m_vVertices.push_back(vertex);
  }
 
+ void Mesh2D::SetVertices(std::vector<Vertex2D>&& vVertices)
+ {
+	 m_vVertices = std::move(vVertices);
+	 m_LocalBounds = BoundingBox{};
+	 for (const Vertex2D& vertex : m_vVertices)
+		 m_LocalBounds.Expand(glm::vec3(vertex.pos, 0.f));
+ }
+
  std::unique_ptr<Mesh2D> Mesh2D::CreateRectangle(const VulkanContext& context, const CommandPool& commandPool, std::shared_ptr<Texture> pTexture, int top, int left, int bottom, int right)
  {
 	 auto rect = std::make_unique<Mesh2D>();
-	 const std::vector<Vertex2D> vertices = 
+	 std::vector<Vertex2D> vertices = 
 	 {
 		 {glm::vec2{left, top},		glm::vec3{1.0f,0.0f,0.0f}, glm::vec2{ 0, 0}},
 		 {glm::vec2{right, top},	glm::vec3{0.0f,1.0f,0.0f}, glm::vec2{ 1, 0}},
@@ -138,9 +270,7 @@ void Mesh::CreateIndexBuffer(VkPhysicalDevice physicalDevice, VkDevice device, c
 		 {glm::vec2{left, bottom},	glm::vec3{0.0f,0.0f,1.0f}, glm::vec2{ 0, 1}}
 	 };
 
-	 for (const auto& vertex : vertices)
-		 rect->AddVertex(vertex);
-
+	 rect->SetVertices(std::move(vertices));
 	 rect->SetIndices(std::vector<uint32_t>{0, 1, 2, 0, 2, 3});
 	 rect->SetTexture(pTexture);
 	 return rect;
@@ -156,15 +286,18 @@ void Mesh::CreateIndexBuffer(VkPhysicalDevice physicalDevice, VkDevice device, c
 	 Vertex2D centerVertex{ center, glm::vec3{1.0f,0.0f,0.0f}, glm::vec2{0.5f,0.5f} };
 	 Vertex2D currEdgeVertex{ {}, glm::vec3{0.0f,0.0f,1.0f} };
 
+	 std::vector<Vertex2D> vVertices{};
 	 std::vector<uint32_t> vIndices{};
+	 vVertices.reserve(numberOfSegments + 1);
+	 vIndices.reserve(numberOfSegments * 3);
 
-	 oval->AddVertex(centerVertex);
+	 vVertices.push_back(centerVertex);
 	 for (int i{}; i < numberOfSegments; i++)
 	 {
 		 currEdgeVertex.pos = center + radius * glm::vec2(glm::cos(radians * i), glm::sin(radians * i));
 		 currEdgeVertex.texCoord = centerVertex.texCoord + glm::vec2{ 0.5f * glm::cos(radians * i),0.5f * glm::sin(radians * i) };
 
-		 oval->AddVertex(currEdgeVertex);
+		 vVertices.push_back(currEdgeVertex);
 
 		 vIndices.push_back(0);
 		 vIndices.push_back(i + 1);
@@ -174,68 +307,125 @@ void Mesh::CreateIndexBuffer(VkPhysicalDevice physicalDevice, VkDevice device, c
 			 vIndices.push_back(i + 2);
 	 }
 
-	 oval->SetIndices(vIndices);
+	 oval->SetVertices(std::move(vVertices));
+	 oval->SetIndices(std::move(vIndices));
 	 oval->SetTexture(pTexture);
 
 	 return oval;
  }
 
- void Mesh2D::CreateVertexBuffer(VkPhysicalDevice physicalDevice, VkDevice device, const CommandPool& commandPool, VkQueue graphicsQueue)
+ void Mesh2D::CreateVertexBuffer(const VulkanContext& context, UploadBatch& batch)
 {
-	VkDeviceSize bufferSize = sizeof(decltype(m_vVertices)::value_type) * m_vVertices.size();
-
-	Buffer stagingBuffer{ physicalDevice, device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,bufferSize };
-
-	void* data;
-	vkMapMemory(device, stagingBuffer.GetVkBufferMemory(), 0, bufferSize, 0, &data);
-	memcpy(data, m_vVertices.data(), (size_t)bufferSize);
-	vkUnmapMemory(device, stagingBuffer.GetVkBufferMemory());
-
-	m_VertexBuffer = std::make_unique<Buffer>(physicalDevice, device, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, bufferSize);
+	m_VertexBuffer = UploadVertices(context, batch, m_vVertices);
+}
 
-	CopyBuffer(device, commandPool, stagingBuffer, *m_VertexBuffer, bufferSize, graphicsQueue);
+ void Mesh2D::ReleaseCpuData()
+{
+	std::vector<Vertex2D>().swap(m_vVertices);
+	Mesh::ReleaseCpuData();
 }
 
  //////////////////////////////////////////////
 
 void Mesh3D::AddVertex(const glm::vec3& pos, const glm::vec3& normal, const glm::vec3& color)
 {
+	m_LocalBounds.Expand(pos);
 	m_vVertices.push_back(Vertex3D{ pos, normal, color });
 }
 
 void Mesh3D::AddVertex(Vertex3D vertex)
 {
 	vertex.color = { 1,1,1 };
+	m_LocalBounds.Expand(vertex.pos);
 	m_vVertices.push_back(vertex);
 }
 
+void Mesh3D::SetVertices(std::vector<Vertex3D>&& vVertices)
+{
+	m_vVertices = std::move(vVertices);
+	m_LocalBounds = BoundingBox{};
+	for (const Vertex3D& vertex : m_vVertices)
+		m_LocalBounds.Expand(vertex.pos);
+}
+
 std::unique_ptr<Mesh3D> Mesh3D::CreateMesh(const std::string& fileName, std::shared_ptr<Texture> pTexture, const VulkanContext& context, const CommandPool& commandPool)
+{
+	return CreateMesh(MeshAsset::Import(fileName, MeshImportOptions{}), pTexture);
+}
+
+std::unique_ptr<Mesh3D> Mesh3D::CreateMesh(std::shared_ptr<MeshAsset> pAsset, std::shared_ptr<Texture> pTexture)
 {
 	auto mesh = std::make_unique<Mesh3D>();
-	std::vector<Vertex3D> vertices{};
-	std::vector<uint32_t> indices{};
-	ParseOBJ(fileName, vertices, indices);
-	for (const auto& vertex : vertices)
-		mesh->AddVertex(vertex);
-	
-	mesh->SetIndices(indices);
+	mesh->m_LocalBounds = pAsset->bounds;
+	mesh->m_IndexCount = pAsset->indexCount;
+	mesh->m_pAsset = std::move(pAsset);
 	mesh->SetTexture(pTexture);
-	
 	return mesh;
 }
 
-void Mesh3D::CreateVertexBuffer(VkPhysicalDevice physicalDevice, VkDevice device, const CommandPool& commandPool, VkQueue graphicsQueue)
+std::unique_ptr<Mesh3D> Mesh3D::CreateImpostor(Mesh3D& source, std::shared_ptr<Texture> pAtlas, const glm::vec4& sphere, uint32_t framesPerSide, float fadeStart, float fadeEnd)
 {
-	VkDeviceSize bufferSize = sizeof(decltype(m_vVertices)::value_type) * m_vVertices.size();
+	if (source.m_InstanceCount <= 1)
+		throw std::runtime_error("impostors only stand in for instanced meshes!");
 
-	Buffer stagingBuffer{ physicalDevice, device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,bufferSize };
-
-	void* data;
-	vkMapMemory(device, stagingBuffer.GetVkBufferMemory(), 0, bufferSize, 0, &data);
-	memcpy(data, m_vVertices.data(), (size_t)bufferSize);
-	vkUnmapMemory(device, stagingBuffer.GetVkBufferMemory());
+	// The vertex shader turns the corners into the frame's plane, the uvs cover one frame with v down like the bake
+	auto impostor = std::make_unique<Mesh3D>();
+	impostor->m_vVertices =
+	{
+		Vertex3D{ glm::vec3{ -1.f, -1.f, 0.f }, glm::vec3{ 0.f, 0.f, 1.f }, glm::vec3{ 1.f }, glm::vec2{ 0.f, 1.f } },
+		Vertex3D{ glm::vec3{ 1.f, -1.f, 0.f }, glm::vec3{ 0.f, 0.f, 1.f }, glm::vec3{ 1.f }, glm::vec2{ 1.f, 1.f } },
+		Vertex3D{ glm::vec3{ 1.f, 1.f, 0.f }, glm::vec3{ 0.f, 0.f, 1.f }, glm::vec3{ 1.f }, glm::vec2{ 1.f, 0.f } },
+		Vertex3D{ glm::vec3{ -1.f, 1.f, 0.f }, glm::vec3{ 0.f, 0.f, 1.f }, glm::vec3{ 1.f }, glm::vec2{ 0.f, 0.f } }
+	};
+	impostor->SetIndices(std::vector<uint32_t>{ 0, 1, 2, 0, 2, 3 });
+	// Culling goes by the cells of the source, which are built around its bounds
+	impostor->m_LocalBounds = source.m_LocalBounds;
+	impostor->SetTexture(pAtlas);
+
+	source.SetLodFade(fadeStart, fadeEnd);
+	MeshData vertexConstant = source.GetVertexConstant();
+	vertexConstant.impostorSphere = sphere;
+	vertexConstant.impostorFrames = framesPerSide;
+	impostor->SetVertexConstant(vertexConstant);
+
+	impostor->m_InstanceCount = source.m_InstanceCount;
+	impostor->m_FirstInstance = source.m_FirstInstance;
+	impostor->m_TotalInstanceCount = source.m_TotalInstanceCount;
+	impostor->m_RotationEnabled = source.m_RotationEnabled;
+	impostor->m_pTransforms = source.m_pTransforms;
+	impostor->m_TransformNode = source.m_TransformNode;
+	impostor->m_pInstanceSource = &source;
+	impostor->m_ReplacedIndexCount = source.GetIndexCount();
+	return impostor;
+}
 
-	m_VertexBuffer = std::make_unique<Buffer>(physicalDevice, device, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, bufferSize);
+void Mesh3D::CreateVertexBuffer(const VulkanContext& context, UploadBatch& batch)
+{
+	if (!m_pAsset)
+	{
+		m_VertexBuffer = UploadVertices(context, batch, m_vVertices);
+		return;
+	}
 
-	CopyBuffer(device, commandPool, stagingBuffer, *m_VertexBuffer, bufferSize, graphicsQueue);
-}
\ No newline at end of file
+	// The first mesh of an asset uploads it, the others only take the buffers
+	if (!m_pAsset->pVertexBuffer)
+	{
+		m_pAsset->pVertexBuffer = UploadVertices(context, batch, m_pAsset->vVertices);
+		m_pAsset->pIndexBuffer = CreateIndexBuffer(context, batch, m_pAsset->vIndices);
+
+		// Later meshes of the asset only take the buffers, so nothing reads these again
+		if (m_pAsset->cpuDataPolicy == CpuDataPolicy::ReleaseAfterUpload)
+		{
+			std::vector<Vertex3D>().swap(m_pAsset->vVertices);
+			std::vector<uint32_t>().swap(m_pAsset->vIndices);
+		}
+	}
+	m_VertexBuffer = m_pAsset->pVertexBuffer;
+	m_IndexBuffer = m_pAsset->pIndexBuffer;
+}
+void Mesh3D::ReleaseCpuData()
+{
+	// An asset's data belongs to the asset, its own import options decide about it
+	std::vector<Vertex3D>().swap(m_vVertices);
+	Mesh::ReleaseCpuData();
+}
@@ -1,13 +1,21 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/scalar_constants.hpp>
 #include <vector>
+#include <span>
 #include "vulkanbase/VulkanUtil.h"
 #include "Vertex.h"
 #include "Buffer.h"
 #include "CommandPool.h"
+#include "TransferQueue.h"
 #include "Texture.h"
 #include "Instance.h"
+#include "Random.h"
+#include "TransformHierarchy.h"
+#include "InstanceGrid.h"
+#include "Frustum.h"
+#include "RenderQueue.h"
 
 struct InstancedMeshData
 {
@@ -21,29 +29,85 @@ struct InstancedMeshData
 	float maxAngle{ 360.f };
 	glm::vec3 rotationAxis{ 0,1,0 };
 
-	void RandomizeTranslation(glm::mat4& mat) const
-	{
-		glm::vec3 translation(GetRand(minOffset.x, maxOffset.x), GetRand(minOffset.y, maxOffset.y), GetRand(minOffset.z, maxOffset.z));
-		mat = glm::translate(mat, translation);
-	}
+	// Per-instance spin evaluated in the vertex shader, in degrees per second
+	float minAngularSpeed{ 90.f };
+	float maxAngularSpeed{ 90.f };
+	glm::vec3 animationAxis{ 0,1,0 };
 
-	void RandomizeScale(glm::mat4& mat) const
-	{
-		mat = glm::scale(mat, glm::vec3(GetRand(minScale, maxScale)));
-	}
+	uint64_t seed{ 0 };
+
+	// Edge length of the culling cells, 0 picks one automatically from the instance count
+	float cellSize{ 0.f };
+	// Orders the instances inside every cell along a Morton curve instead of the order they were generated in
+	bool spatialOrder{ false };
+
+	// Instances are generated in chunks of this size, each with its own random stream,
+	// so the result only depends on the seed and not on how many threads did the work.
+	static constexpr uint32_t chunkSize{ 4096 };
 
-	void RandomizeRotation(glm::mat4& mat) const
+	// Builds translate * rotate * scale for one instance straight into the affine columns
+	glm::mat4 CreateTransform(uint32_t instanceIndex, uint32_t meshesPerSide, Pcg32& rng) const
 	{
-		mat = glm::rotate(mat, GetRand(minAngle, maxAngle), rotationAxis);
+		const float x = static_cast<float>(instanceIndex % meshesPerSide);
+		const float y = static_cast<float>(instanceIndex / meshesPerSide);
+
+		glm::vec3 translation = (maxOffset - minOffset) * glm::vec3(x, 0, y) / 2.f;
+		translation += glm::vec3(rng.NextFloat(minOffset.x, maxOffset.x), rng.NextFloat(minOffset.y, maxOffset.y), rng.NextFloat(minOffset.z, maxOffset.z));
+		const float angle = glm::radians(rng.NextFloat(minAngle, maxAngle));
+		const float scale = rng.NextFloat(minScale, maxScale);
+
+		const glm::vec3 axis = glm::normalize(rotationAxis);
+		const float c = glm::cos(angle);
+		const float s = glm::sin(angle);
+		const glm::vec3 t = (1.f - c) * axis;
+
+		glm::mat4 transform{ 1.f };
+		transform[0] = glm::vec4(t.x * axis.x + c, t.x * axis.y + s * axis.z, t.x * axis.z - s * axis.y, 0.f) * scale;
+		transform[1] = glm::vec4(t.y * axis.x - s * axis.z, t.y * axis.y + c, t.y * axis.z + s * axis.x, 0.f) * scale;
+		transform[2] = glm::vec4(t.z * axis.x + s * axis.y, t.z * axis.y - s * axis.x, t.z * axis.z + c, 0.f) * scale;
+		transform[3] = glm::vec4(translation, 1.f);
+		return transform;
 	}
 
-private:
-	float GetRand(float min, float max) const
+	void RandomizeAnimation(InstanceVertex& instance, Pcg32& rng) const
 	{
-		return min + static_cast<float>(rand()) / (static_cast<float>(RAND_MAX / (max - min)));
+		instance.animation = glm::vec4(glm::normalize(animationAxis), glm::radians(rng.NextFloat(minAngularSpeed, maxAngularSpeed)));
+		instance.animationPhase = rng.NextFloat(0.f, glm::two_pi<float>());
 	}
 };
 
+// What happens to the CPU copies of vertices, indices and instances once they are staged for the GPU.
+// The staging buffers hold their own copy until the transfer finished, so nothing else needs them after that.
+enum class CpuDataPolicy
+{
+	Keep,
+	ReleaseAfterUpload
+};
+
+// How a mesh file is turned into vertices, part of the asset cache key next to the file name
+struct MeshImportOptions
+{
+	bool flipAxisAndWinding{ true };
+	CpuDataPolicy cpuDataPolicy{ CpuDataPolicy::Keep };
+
+	bool operator==(const MeshImportOptions& other) const = default;
+};
+
+// Geometry of one imported file. Every mesh created from it shares it, the first one to initialize uploads
+// the buffers and the others bind the same ones.
+struct MeshAsset
+{
+	std::vector<Vertex3D> vVertices{};
+	std::vector<uint32_t> vIndices{};
+	BoundingBox bounds{};
+	uint32_t indexCount{ 0 };	// outlives vIndices when those are released
+	CpuDataPolicy cpuDataPolicy{ CpuDataPolicy::Keep };
+	std::shared_ptr<Buffer> pVertexBuffer{};
+	std::shared_ptr<Buffer> pIndexBuffer{};
+
+	static std::shared_ptr<MeshAsset> Import(const std::string& fileName, const MeshImportOptions& options);
+};
+
 class Mesh
 {
 public:
@@ -54,47 +118,96 @@ public:
     Mesh& operator=(const Mesh& other) = delete;
     Mesh& operator=(Mesh&& other) noexcept = delete;
 
-	void Initialize(const VkPhysicalDevice& physicalDevice, const VkDevice& device, const CommandPool& commandPool, VkQueue graphicsQueue);
-	void Initialize(const VulkanContext& context, const CommandPool& commandPool);
+	// Records the vertex, index and instance uploads into the batch, meshes initialized in the same frame share one submit
+	void Initialize(const VulkanContext& context, UploadBatch& batch);
+	// An impostor has to wait for the mesh whose instances it draws
+	bool IsReadyToInitialize() const { return !m_pInstanceSource || m_pInstanceSource->m_InstanceBuffer; }
 
+	// Safe while a frame that draws the mesh is in flight, the buffers and texture go through the deletion queue
 	void DestroyMesh(const VkDevice& device);
 
-	void Draw(VkPipelineLayout pipelineLayout, const VkCommandBuffer& cmdBuffer);
+	void BindGeometry(const VkCommandBuffer& cmdBuffer) const;
+	// What the shaders read for this mesh this frame, the transform node and the spin folded in
+	MeshData GetObjectData() const;
+	void Draw(const VkCommandBuffer& cmdBuffer, uint32_t firstInstance, uint32_t instanceCount) const;
+	void DrawIndirect(const VkCommandBuffer& cmdBuffer, VkBuffer drawBuffer, VkDeviceSize offset, uint32_t drawCount) const;
+	// Queues one draw per visible run of instances, or a single draw for a non-instanced mesh.
+	// Without mergeCells every visible cell gets its own draw so it can be occlusion tested on its own.
+	void CollectDraws(uint32_t pipelineId, uint32_t meshIndex, uint32_t descriptorSetIndex, const Frustum& frustum, const glm::mat4& view, RenderQueue& queue, bool mergeCells = true) const;
+	uint32_t GetIndexCount() const { return m_IndexCount; }
+	// Indices per instance of the mesh an impostor stands in for, 0 for every other mesh
+	uint32_t GetReplacedIndexCount() const { return m_ReplacedIndexCount; }
 
 	void SetIndices(const std::vector<uint32_t>& vIndices);
+	void SetIndices(std::vector<uint32_t>&& vIndices);
+	// Empty once released, see CpuDataPolicy
+	std::span<const uint32_t> GetIndices() const { return m_vIndices; }
+	void SetCpuDataPolicy(CpuDataPolicy policy) { m_CpuDataPolicy = policy; }
 
-	void SetInstanceCount(uint32_t instanceCount) { m_InstanceCount = instanceCount; }
+	void SetInstanceCount(uint32_t instanceCount) { m_InstanceCount = instanceCount; m_FirstInstance = 0; m_TotalInstanceCount = instanceCount; }
+	// Generates instances [firstInstance, firstInstance + instanceCount) of a set of totalInstanceCount, exactly as the
+	// mesh holding the whole set would. firstInstance has to start a generation chunk.
+	void SetInstanceRange(uint32_t firstInstance, uint32_t instanceCount, uint32_t totalInstanceCount);
 
 	void SetInstancedMeshData(const InstancedMeshData& data) { m_InstancedMeshData = data; }
+	// Every instance picks one of these texture atlas cells at random, an empty list maps the whole texture
+	void SetAtlasCells(const std::vector<glm::vec4>& vAtlasCells) { m_vAtlasCells = vAtlasCells; }
 
 	void SetVertexConstant(const MeshData& vertexConstant) { m_VertexConstant = vertexConstant; }
 	const MeshData& GetVertexConstant() const { return m_VertexConstant; }
+	void SetTextureIndex(uint32_t textureIndex) { m_VertexConstant.textureIndex = textureIndex; }
+	// Instance distances over which an impostor takes over from this mesh, cells entirely past fadeEnd are skipped
+	void SetLodFade(float fadeStart, float fadeEnd) { m_VertexConstant.lodFade = glm::vec2{ fadeStart, fadeEnd }; }
+
+	// The node's world matrix is applied on top of the vertex constant every draw
+	void SetTransformNode(const TransformHierarchy* pTransforms, uint32_t node) { m_pTransforms = pTransforms; m_TransformNode = node; }
+	uint32_t GetTransformNode() const { return m_TransformNode; }
 
 	void SetTexture(std::shared_ptr<Texture> pTexture) { m_pTexture = pTexture; }
 	Texture* GetTexture() const { return m_pTexture ? m_pTexture.get() : nullptr; }
 
-	void CopyBuffer(const VkDevice& device, const CommandPool& commandPool, const Buffer& stagingBuffer, const Buffer& dstBuffer, VkDeviceSize size, VkQueue graphicsQueue); 
-	void ToggleRotation(bool enabled) { m_RotationEnabled = enabled; }
+	void ToggleRotation(bool enabled, float degreesPerSecond = 90.f) { m_RotationEnabled = enabled; m_RotationSpeed = degreesPerSecond; }
 	bool RotationEnabled() const { return m_RotationEnabled; }
+	const BoundingBox& GetLocalBounds() const { return m_LocalBounds; }
+	const InstanceGrid& GetInstanceGrid() const { return m_InstanceGrid; }
 protected:
 	Mesh() = default;
-	std::unique_ptr<Buffer> m_VertexBuffer;
-	std::unique_ptr<Buffer> m_IndexBuffer;
+	static std::shared_ptr<Buffer> CreateIndexBuffer(const VulkanContext& context, UploadBatch& batch, const std::vector<uint32_t>& vIndices);
+	// Frees the CPU copies the mesh owns, the derived meshes add their vertices
+	virtual void ReleaseCpuData();
+
+	// Shared with other meshes when they come from the same asset
+	std::shared_ptr<Buffer> m_VertexBuffer;
+	std::shared_ptr<Buffer> m_IndexBuffer;
 	std::vector<uint32_t> m_vIndices{};
+	uint32_t m_IndexCount{ 0 };
 	MeshData m_VertexConstant{};
 	std::shared_ptr<Texture> m_pTexture{ nullptr };
 	uint32_t m_InstanceCount{ 1 };
+	uint32_t m_FirstInstance{ 0 };
+	uint32_t m_TotalInstanceCount{ 1 };
 	std::vector<InstanceVertex> m_vInstanceData;
-	std::unique_ptr<Buffer> m_InstanceBuffer;
+	std::shared_ptr<Buffer> m_InstanceBuffer;
 	InstancedMeshData m_InstancedMeshData{};
+	std::vector<glm::vec4> m_vAtlasCells{};
+	InstanceGrid m_InstanceGrid{};
+	BoundingBox m_LocalBounds{};
+	const TransformHierarchy* m_pTransforms{ nullptr };
+	uint32_t m_TransformNode{ TransformHierarchy::invalidNode };
+	// An impostor draws the instances of its mesh, it takes over their buffer and grid once that mesh initialized
+	const Mesh* m_pInstanceSource{ nullptr };
+	uint32_t m_ReplacedIndexCount{ 0 };
 
 
 private:
-	virtual void CreateVertexBuffer(VkPhysicalDevice physicalDevice, VkDevice device, const CommandPool& commandPool, VkQueue graphicsQueue) = 0;
-	void CreateInstancedVertexBuffer(VkPhysicalDevice physicalDevice, VkDevice device, const CommandPool& commandPool, VkQueue graphicsQueue);
-	void CreateIndexBuffer(VkPhysicalDevice physicalDevice, VkDevice device, const CommandPool& commandPool, VkQueue graphicsQueue);
+	// May set the index buffer as well, for geometry that comes with one
+	virtual void CreateVertexBuffer(const VulkanContext& context, UploadBatch& batch) = 0;
+	void CreateInstancedVertexBuffer(const VulkanContext& context, UploadBatch& batch);
+	void GenerateInstances();
 
 	bool m_RotationEnabled{ false };
+	float m_RotationSpeed{ 90.f };
+	CpuDataPolicy m_CpuDataPolicy{ CpuDataPolicy::Keep };
 };
 
 class Mesh2D : public Mesh
@@ -106,12 +219,14 @@ public:
 	~Mesh2D() = default;
 	void AddVertex(const glm::vec2& pos, const glm::vec3& color);
 	void AddVertex(const Vertex2D& vertex);
-	std::vector<Vertex2D> GetVertices() const { return m_vVertices; }
+	void SetVertices(std::vector<Vertex2D>&& vVertices);
+	std::span<const Vertex2D> GetVertices() const { return m_vVertices; }
 
 	static std::unique_ptr<Mesh2D> CreateRectangle(const VulkanContext& context, const CommandPool& commandPool, std::shared_ptr<Texture> pTexture, int top, int left, int bottom, int right);
 	static std::unique_ptr<Mesh2D> CreateOval(const VulkanContext& context, const CommandPool& commandPool, std::shared_ptr<Texture> pTexture, glm::vec2 center, glm::vec2 radius, int numberOfSegments);
 private:
-	virtual void CreateVertexBuffer(VkPhysicalDevice physicalDevice, VkDevice device, const CommandPool& commandPool, VkQueue graphicsQueue) override;
+	virtual void CreateVertexBuffer(const VulkanContext& context, UploadBatch& batch) override;
+	virtual void ReleaseCpuData() override;
 
 	std::vector<Vertex2D> m_vVertices{};
 };
@@ -125,11 +240,20 @@ public:
 	~Mesh3D() = default;
 	void AddVertex(const glm::vec3& pos, const glm::vec3& normal, const glm::vec3& color);
 	void AddVertex(Vertex3D vertex);
-	std::vector<Vertex3D> GetVertices() const { return m_vVertices; }
+	void SetVertices(std::vector<Vertex3D>&& vVertices);
+	// The asset's vertices for a mesh created from one
+	std::span<const Vertex3D> GetVertices() const { return m_pAsset ? std::span<const Vertex3D>{ m_pAsset->vVertices } : std::span<const Vertex3D>{ m_vVertices }; }
 
 	static std::unique_ptr<Mesh3D> CreateMesh(const std::string& fileName, std::shared_ptr<Texture> pTexture, const VulkanContext& context, const CommandPool& commandPool);
+	// Draws from the asset's buffers instead of its own, the vertices are not copied into the mesh
+	static std::unique_ptr<Mesh3D> CreateMesh(std::shared_ptr<MeshAsset> pAsset, std::shared_ptr<Texture> pTexture);
+	// A camera facing quad that draws the instances of source from a baked ImpostorAtlas, it has to be initialized
+	// after source and sets the fade on it as well
+	static std::unique_ptr<Mesh3D> CreateImpostor(Mesh3D& source, std::shared_ptr<Texture> pAtlas, const glm::vec4& sphere, uint32_t framesPerSide, float fadeStart, float fadeEnd);
 private:
-	virtual void CreateVertexBuffer(VkPhysicalDevice physicalDevice, VkDevice device, const CommandPool& commandPool, VkQueue graphicsQueue) override;
+	virtual void CreateVertexBuffer(const VulkanContext& context, UploadBatch& batch) override;
+	virtual void ReleaseCpuData() override;
 
 	std::vector<Vertex3D> m_vVertices{};
+	std::shared_ptr<MeshAsset> m_pAsset{};
 };
\ No newline at end of file
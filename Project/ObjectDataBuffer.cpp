@@ -0,0 +1,97 @@
+//---------------------------
+// Includes
+//---------------------------
+#include "ObjectDataBuffer.h"
+#include <algorithm>
+#include <stdexcept>
+
+//---------------------------
+// Member functions
+//---------------------------
+
+void ObjectDataBuffer::Initialize(const VulkanContext& context, uint32_t initialCapacity, uint32_t framesInFlight)
+{
+	m_Context = context;
+
+	VkDescriptorSetLayoutBinding objectBinding{};
+	objectBinding.binding = 0;
+	objectBinding.descriptorCount = 1;
+	objectBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	objectBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &objectBinding;
+	if (vkCreateDescriptorSetLayout(m_Context.device, &layoutInfo, nullptr, &m_DescriptorSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create object data descriptor set layout!");
+
+	m_vFrames.resize(std::max(framesInFlight, 1u));
+	m_DescriptorAllocator.Initialize(m_Context.device, { { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f } }, static_cast<uint32_t>(m_vFrames.size()));
+	for (Frame& frame : m_vFrames)
+	{
+		frame.descriptorSet = m_DescriptorAllocator.Allocate(m_DescriptorSetLayout);
+		CreateFrameBuffer(frame, std::max(initialCapacity, 1u));
+	}
+	m_Frame = 0;
+}
+
+void ObjectDataBuffer::Cleanup()
+{
+	m_vFrames.clear();
+	m_vObjects.clear();
+	m_DescriptorAllocator.Cleanup();
+	vkDestroyDescriptorSetLayout(m_Context.device, m_DescriptorSetLayout, nullptr);
+	m_DescriptorSetLayout = VK_NULL_HANDLE;
+}
+
+void ObjectDataBuffer::BeginFrame()
+{
+	m_Frame = (m_Frame + 1) % static_cast<uint32_t>(m_vFrames.size());
+	m_vObjects.clear();
+}
+
+void ObjectDataBuffer::Upload()
+{
+	if (m_vObjects.empty())
+		return;
+
+	// Only this frame's buffer is replaced, so nothing another frame in flight reads goes away
+	Frame& frame = m_vFrames[m_Frame];
+	if (m_vObjects.size() > frame.capacity)
+		CreateFrameBuffer(frame, std::max(static_cast<uint32_t>(m_vObjects.size()), frame.capacity * 2));
+
+	frame.buffer->Upload(m_vObjects.data(), 0, sizeof(MeshData) * m_vObjects.size());
+}
+
+void ObjectDataBuffer::Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex) const
+{
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, setIndex, 1, &m_vFrames[m_Frame].descriptorSet, 0, nullptr);
+}
+
+void ObjectDataBuffer::CreateFrameBuffer(Frame& frame, uint32_t capacity)
+{
+	frame.capacity = capacity;
+	frame.buffer = std::make_unique<Buffer>(
+		m_Context,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		sizeof(MeshData) * capacity
+	);
+	frame.buffer->Map();
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = frame.buffer->GetVkBuffer();
+	bufferInfo.offset = 0;
+	bufferInfo.range = VK_WHOLE_SIZE;
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = frame.descriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(m_Context.device, 1, &descriptorWrite, 0, nullptr);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <vector>
+#include <memory>
+#include "vulkanbase/VulkanUtil.h"
+#include "Buffer.h"
+#include "Vertex.h"
+#include "DescriptorAllocator.h"
+
+//-----------------------------------------------------
+// ObjectDataBuffer Class
+//-----------------------------------------------------
+// Per object shader data for one pipeline, written contiguously once per frame into a persistently mapped
+// storage buffer. Draws only push the index of their object, so the data can outgrow the push constant
+// limit and stays readable by compute work. Every frame in flight has its own buffer and set.
+class ObjectDataBuffer final
+{
+public:
+	ObjectDataBuffer() = default;
+	~ObjectDataBuffer() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	ObjectDataBuffer(const ObjectDataBuffer& other)					= delete;
+	ObjectDataBuffer(ObjectDataBuffer&& other) noexcept				= delete;
+	ObjectDataBuffer& operator=(const ObjectDataBuffer& other)		= delete;
+	ObjectDataBuffer& operator=(ObjectDataBuffer&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	void Initialize(const VulkanContext& context, uint32_t initialCapacity, uint32_t framesInFlight = 1);
+	void Cleanup();
+
+	// Moves on to the next frame's buffer and clears the objects, the frame that used it before has to be finished
+	void BeginFrame();
+	// Returns the index the shaders find the object at
+	uint32_t Add(const MeshData& object) { m_vObjects.push_back(object); return static_cast<uint32_t>(m_vObjects.size() - 1); }
+	// Copies the frame's objects in one go, growing the frame's buffer first when they do not fit
+	void Upload();
+
+	void Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex) const;
+	VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_DescriptorSetLayout; }
+
+private:
+	struct Frame
+	{
+		std::unique_ptr<Buffer> buffer{};
+		uint32_t capacity{ 0 };
+		VkDescriptorSet descriptorSet{};
+	};
+
+	void CreateFrameBuffer(Frame& frame, uint32_t capacity);
+
+	VulkanContext m_Context{};
+	VkDescriptorSetLayout m_DescriptorSetLayout{};
+	DescriptorAllocator m_DescriptorAllocator{};
+
+	std::vector<Frame> m_vFrames{};
+	uint32_t m_Frame{ 0 };
+	std::vector<MeshData> m_vObjects{};
+};
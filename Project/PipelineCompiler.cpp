@@ -0,0 +1,81 @@
+//---------------------------
+// Includes
+//---------------------------
+#include "PipelineCompiler.h"
+#include <stdexcept>
+#include "ThreadPool.h"
+
+//---------------------------
+// Member functions
+//---------------------------
+
+void PipelineCompiler::Initialize(VkDevice device)
+{
+	m_Device = device;
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &m_PipelineCache) != VK_SUCCESS)
+		throw std::runtime_error("failed to create pipeline cache!");
+}
+
+void PipelineCompiler::Cleanup()
+{
+	for (auto& [stateKey, pEntry] : m_Entries)
+	{
+		if (pEntry->compile.valid())
+			pEntry->compile.wait();
+		vkDestroyPipeline(m_Device, pEntry->pipeline.load(), nullptr);
+	}
+	m_Entries.clear();
+
+	vkDestroyPipelineCache(m_Device, m_PipelineCache, nullptr);
+	m_PipelineCache = VK_NULL_HANDLE;
+}
+
+VkPipeline PipelineCompiler::Request(size_t stateKey, const CompileFunction& compile, size_t fallbackKey)
+{
+	auto [it, inserted] = m_Entries.try_emplace(stateKey, nullptr);
+	if (inserted)
+	{
+		it->second = std::make_unique<Entry>();
+		++m_PendingCount;
+
+		// The entry is never erased before Cleanup, which waits for this task, so the raw pointer stays valid
+		Entry* pEntry = it->second.get();
+		it->second->compile = ThreadPool::Get().Enqueue([this, pEntry, compile, pipelineCache = m_PipelineCache]()
+			{
+				try
+				{
+					const VkPipeline pipeline = compile(pipelineCache);
+					pEntry->pipeline.store(pipeline, std::memory_order_release);
+				}
+				catch (...)
+				{
+					--m_PendingCount;
+					throw;
+				}
+				--m_PendingCount;
+			}).share();
+	}
+
+	if (const VkPipeline pipeline = GetReadyPipeline(stateKey))
+		return pipeline;
+	return fallbackKey != 0 ? GetReadyPipeline(fallbackKey) : VK_NULL_HANDLE;
+}
+
+VkPipeline PipelineCompiler::GetReadyPipeline(size_t stateKey)
+{
+	const auto it = m_Entries.find(stateKey);
+	if (it == m_Entries.end())
+		return VK_NULL_HANDLE;
+
+	Entry& entry = *it->second;
+	if (const VkPipeline pipeline = entry.pipeline.load(std::memory_order_acquire))
+		return pipeline;
+
+	// A finished task without a pipeline threw, get() hands the stored exception to the caller each time
+	if (entry.compile.valid() && entry.compile.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		entry.compile.get();
+	return VK_NULL_HANDLE;
+}
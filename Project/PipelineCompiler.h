@@ -0,0 +1,65 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <memory>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <unordered_map>
+#include "vulkanbase/VulkanUtil.h"
+
+//-----------------------------------------------------
+// PipelineCompiler Class
+//-----------------------------------------------------
+// Compiles pipelines on the thread pool so a new state combination never stalls a frame. Pipelines are
+// looked up by a hash of everything that went into their create info, the first request for a key starts the
+// compile and every request after it gets the finished pipeline, swapped in atomically by the worker.
+// All compiles share one pipeline cache, which Vulkan synchronizes internally.
+class PipelineCompiler final
+{
+public:
+	// Builds the create info and creates the pipeline, runs on a worker thread
+	using CompileFunction = std::function<VkPipeline(VkPipelineCache)>;
+
+	PipelineCompiler() = default;
+	~PipelineCompiler() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	PipelineCompiler(const PipelineCompiler& other)					= delete;
+	PipelineCompiler(PipelineCompiler&& other) noexcept				= delete;
+	PipelineCompiler& operator=(const PipelineCompiler& other)		= delete;
+	PipelineCompiler& operator=(PipelineCompiler&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	void Initialize(VkDevice device);
+	// Waits for compiles still running, everything they read has to outlive this call
+	void Cleanup();
+
+	// Returns the pipeline for the key once it is compiled. Until then the fallback key's pipeline is returned
+	// if that one is ready, otherwise VK_NULL_HANDLE and the caller skips its draws for the frame.
+	// A compile that failed rethrows its exception on every request for its key.
+	VkPipeline Request(size_t stateKey, const CompileFunction& compile, size_t fallbackKey = 0);
+
+	uint32_t GetPendingCount() const { return m_PendingCount.load(std::memory_order_relaxed); }
+
+private:
+	struct Entry
+	{
+		std::atomic<VkPipeline> pipeline{ VK_NULL_HANDLE };
+		// Shared so a failed compile keeps its exception, a plain future would be spent after the first get()
+		std::shared_future<void> compile{};
+	};
+
+	VkPipeline GetReadyPipeline(size_t stateKey);
+
+	VkDevice m_Device{};
+	VkPipelineCache m_PipelineCache{};
+	std::unordered_map<size_t, std::unique_ptr<Entry>> m_Entries{};
+	std::atomic<uint32_t> m_PendingCount{ 0 };
+};
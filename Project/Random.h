@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+
+// PCG32 (XSH-RR) generator. Small, fast and fully deterministic for a given seed and stream,
+// so every chunk of work can own one and produce the same numbers regardless of which thread runs it.
+class Pcg32 final
+{
+public:
+	Pcg32(uint64_t seed, uint64_t stream = 0)
+		: m_Increment{ (stream << 1u) | 1u }
+	{
+		NextUInt();
+		m_State += seed;
+		NextUInt();
+	}
+
+	uint32_t NextUInt()
+	{
+		const uint64_t oldState = m_State;
+		m_State = oldState * 6364136223846793005ULL + m_Increment;
+		const uint32_t xorShifted = static_cast<uint32_t>(((oldState >> 18u) ^ oldState) >> 27u);
+		const uint32_t rotation = static_cast<uint32_t>(oldState >> 59u);
+		return (xorShifted >> rotation) | (xorShifted << ((~rotation + 1u) & 31u));
+	}
+
+	// Uniform float in [0, 1)
+	float NextFloat()
+	{
+		return static_cast<float>(NextUInt() >> 8) * (1.f / 16777216.f);
+	}
+
+	float NextFloat(float min, float max)
+	{
+		return min + (max - min) * NextFloat();
+	}
+
+private:
+	uint64_t m_State{ 0 };
+	uint64_t m_Increment{ 1 };
+};
@@ -0,0 +1,62 @@
+
+//---------------------------
+// Includes
+//---------------------------
+#include "RenderQueue.h"
+#include <array>
+#include <bit>
+#include <algorithm>
+
+//---------------------------
+// Member functions
+//---------------------------
+
+uint64_t RenderQueue::CreateSortKey(uint32_t pipeline, uint32_t material, uint32_t geometry, float viewDepth)
+{
+	// The bit pattern of a positive float grows with its value, its top 24 bits are a cheap monotonic depth
+	const uint32_t depthBits = std::bit_cast<uint32_t>(std::max(viewDepth, 0.f)) >> 8;
+
+	return (static_cast<uint64_t>(pipeline & 0xFF) << 56)
+		| (static_cast<uint64_t>(material & 0xFFFF) << 40)
+		| (static_cast<uint64_t>(geometry & 0xFFFF) << 24)
+		| static_cast<uint64_t>(depthBits & 0xFFFFFF);
+}
+
+void RenderQueue::Sort()
+{
+	// LSD radix sort on 8 bit digits. A digit that is equal for every key is skipped,
+	// which is most of them since only a handful of pipelines, materials and meshes exist.
+	m_vScratch.resize(m_vCommands.size());
+	for (uint32_t shift = 0; shift < 64; shift += 8)
+	{
+		std::array<uint32_t, 257> offsets{};
+		for (const DrawCommand& command : m_vCommands)
+			++offsets[((command.sortKey >> shift) & 0xFF) + 1];
+
+		if (std::any_of(offsets.begin() + 1, offsets.end(), [this](uint32_t count) { return count == m_vCommands.size(); }))
+			continue;
+
+		for (size_t digit = 0; digit < 256; ++digit)
+			offsets[digit + 1] += offsets[digit];
+
+		for (const DrawCommand& command : m_vCommands)
+			m_vScratch[offsets[(command.sortKey >> shift) & 0xFF]++] = command;
+
+		m_vCommands.swap(m_vScratch);
+	}
+}
+
+uint32_t RenderQueue::CountBinds() const
+{
+	uint32_t bindCount{ 0 };
+	const DrawCommand* pPrevious{ nullptr };
+	for (const DrawCommand& command : m_vCommands)
+	{
+		if (!pPrevious || command.descriptorSetIndex != pPrevious->descriptorSetIndex)
+			++bindCount;
+		if (!pPrevious || command.meshIndex != pPrevious->meshIndex)
+			++bindCount;
+		pPrevious = &command;
+	}
+	return bindCount;
+}
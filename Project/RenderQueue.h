@@ -0,0 +1,65 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <vector>
+#include <cstdint>
+#include "Frustum.h"
+
+struct DrawCommand
+{
+	uint64_t sortKey{ 0 };
+	uint32_t meshIndex{ 0 };
+	uint32_t descriptorSetIndex{ 0 };
+	uint32_t firstInstance{ 0 };
+	uint32_t instanceCount{ 1 };
+	BoundingBox bounds{};	// world space, used by the occlusion test
+};
+
+struct DrawStats
+{
+	uint32_t queuedDraws{ 0 };		// draws left after frustum culling, each one an occlusion candidate when that is on
+	uint32_t drawCalls{ 0 };		// draw commands recorded, a multi draw indirect run counts once
+	uint32_t binds{ 0 };
+	uint32_t unsortedBinds{ 0 };	// binds the same draws would have needed in submission order
+	uint64_t vertices{ 0 };			// indices times instances of every draw, before occlusion culling
+	uint64_t impostorVerticesSaved{ 0 };	// what the impostors' instances would have cost as their meshes
+
+	DrawStats& operator+=(const DrawStats& other)
+	{
+		queuedDraws += other.queuedDraws;
+		drawCalls += other.drawCalls;
+		binds += other.binds;
+		unsortedBinds += other.unsortedBinds;
+		vertices += other.vertices;
+		impostorVerticesSaved += other.impostorVerticesSaved;
+		return *this;
+	}
+};
+
+//-----------------------------------------------------
+// RenderQueue Class
+//-----------------------------------------------------
+// Collects the draws of a frame and orders them by a 64 bit state key:
+//	[63..56] pipeline | [55..40] material | [39..24] geometry | [23..0] view depth
+// so draws sharing state end up next to each other and opaque draws inside a state run go front to back.
+// The pipeline field is the shader permutation, so keys from different pipelines order the same way in one queue.
+class RenderQueue final
+{
+public:
+	static uint64_t CreateSortKey(uint32_t pipeline, uint32_t material, uint32_t geometry, float viewDepth);
+
+	void Clear() { m_vCommands.clear(); }
+	void Push(const DrawCommand& command) { m_vCommands.push_back(command); }
+	void Sort();
+	// Descriptor set and geometry binds needed to submit the commands in their current order
+	uint32_t CountBinds() const;
+
+	const std::vector<DrawCommand>& GetCommands() const { return m_vCommands; }
+	bool IsEmpty() const { return m_vCommands.empty(); }
+
+private:
+	std::vector<DrawCommand> m_vCommands{};
+	std::vector<DrawCommand> m_vScratch{};
+};
@@ -0,0 +1,174 @@
+//---------------------------
+// Includes
+//---------------------------
+#include "ResidencyManager.h"
+#include <algorithm>
+
+//---------------------------
+// Member functions
+//---------------------------
+
+ResidencyManager& ResidencyManager::Get()
+{
+	static ResidencyManager residencyManager{};
+	return residencyManager;
+}
+
+void ResidencyManager::Initialize(VkPhysicalDevice physicalDevice, bool memoryBudget)
+{
+	m_PhysicalDevice = physicalDevice;
+	m_MemoryBudget = memoryBudget;
+
+	VkPhysicalDeviceMemoryProperties memProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+	m_vTypeHeaps.resize(memProperties.memoryTypeCount);
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i)
+		m_vTypeHeaps[i] = memProperties.memoryTypes[i].heapIndex;
+
+	m_vHeaps.resize(memProperties.memoryHeapCount);
+	m_vUsageAtRefresh.resize(memProperties.memoryHeapCount);
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; ++i)
+	{
+		m_vHeaps[i].size = memProperties.memoryHeaps[i].size;
+		m_vHeaps[i].deviceLocal = (memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+	}
+	RefreshBudgets();
+}
+
+VkResult ResidencyManager::Allocate(VkDevice device, const VkMemoryAllocateInfo& allocInfo, VkDeviceMemory& memory)
+{
+	const uint32_t heapIndex = m_vTypeHeaps[allocInfo.memoryTypeIndex];
+
+	// Making room up front is cheaper than letting the driver fail or silently page. The memory has to be gone
+	// before this allocation, which is safe because candidates were not used by the frame in flight.
+	if (GetHeapUsage(heapIndex) + allocInfo.allocationSize > m_vHeaps[heapIndex].budget)
+		EvictFromHeap(heapIndex, allocInfo.allocationSize, true);
+
+	VkResult result = vkAllocateMemory(device, &allocInfo, nullptr, &memory);
+	if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY && EvictFromHeap(heapIndex, allocInfo.allocationSize, true))
+		result = vkAllocateMemory(device, &allocInfo, nullptr, &memory);
+	if (result != VK_SUCCESS)
+		return result;
+
+	m_Allocations.emplace(memory, Allocation{ heapIndex, allocInfo.allocationSize });
+	m_vHeaps[heapIndex].trackedUsage += allocInfo.allocationSize;
+	++m_vHeaps[heapIndex].allocationCount;
+	return result;
+}
+
+void ResidencyManager::Free(VkDevice device, VkDeviceMemory memory)
+{
+	if (memory == VK_NULL_HANDLE)
+		return;
+
+	vkFreeMemory(device, memory, nullptr);
+
+	auto it = m_Allocations.find(memory);
+	if (it == m_Allocations.end())
+		return;
+
+	MemoryHeapStats& heap = m_vHeaps[it->second.heapIndex];
+	heap.trackedUsage -= it->second.size;
+	--heap.allocationCount;
+	m_Allocations.erase(it);
+}
+
+void ResidencyManager::Register(Evictable* pEvictable)
+{
+	m_vEvictables.push_back(pEvictable);
+}
+
+void ResidencyManager::Unregister(Evictable* pEvictable)
+{
+	std::erase(m_vEvictables, pEvictable);
+}
+
+void ResidencyManager::Update()
+{
+	++m_FrameIndex;
+	RefreshBudgets();
+
+	for (uint32_t heapIndex = 0; heapIndex < m_vHeaps.size(); ++heapIndex)
+	{
+		if (GetHeapUsage(heapIndex) > m_vHeaps[heapIndex].budget)
+			EvictFromHeap(heapIndex, 0, false);
+	}
+}
+
+void ResidencyManager::RefreshBudgets()
+{
+	if (!m_MemoryBudget)
+	{
+		for (MemoryHeapStats& heap : m_vHeaps)
+		{
+			heap.budget = static_cast<VkDeviceSize>(static_cast<double>(heap.size) * fallbackBudgetFraction);
+			heap.usage = heap.trackedUsage;
+		}
+		return;
+	}
+
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+	budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+	VkPhysicalDeviceMemoryProperties2 memProperties{};
+	memProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	memProperties.pNext = &budgetProperties;
+	vkGetPhysicalDeviceMemoryProperties2(m_PhysicalDevice, &memProperties);
+
+	for (uint32_t i = 0; i < m_vHeaps.size(); ++i)
+	{
+		m_vHeaps[i].budget = budgetProperties.heapBudget[i];
+		m_vHeaps[i].usage = budgetProperties.heapUsage[i];
+		m_vUsageAtRefresh[i] = m_vHeaps[i].trackedUsage;
+	}
+}
+
+bool ResidencyManager::EvictFromHeap(uint32_t heapIndex, VkDeviceSize bytes, bool immediate)
+{
+	// Oldest first. What this frame used may already be in recorded commands, what the last one used is likely needed again.
+	std::vector<Evictable*> vCandidates{};
+	for (Evictable* pEvictable : m_vEvictables)
+	{
+		const VkDeviceMemory memory = pEvictable->GetEvictableMemory();
+		if (memory == VK_NULL_HANDLE || pEvictable->GetLastUsedFrame() + 1 >= m_FrameIndex)
+			continue;
+
+		auto it = m_Allocations.find(memory);
+		if (it != m_Allocations.end() && it->second.heapIndex == heapIndex)
+			vCandidates.push_back(pEvictable);
+	}
+	std::sort(vCandidates.begin(), vCandidates.end(), [](const Evictable* pLeft, const Evictable* pRight)
+		{
+			return pLeft->GetLastUsedFrame() < pRight->GetLastUsedFrame();
+		});
+
+	// Deferred evictions only lower the usage once the deletion queue flushes, what they released is counted here instead
+	bool evicted{ false };
+	VkDeviceSize released{ 0 };
+	for (Evictable* pEvictable : vCandidates)
+	{
+		const VkDeviceSize usage = GetHeapUsage(heapIndex);
+		if ((usage > released ? usage - released : 0) + bytes <= m_vHeaps[heapIndex].budget)
+			break;
+
+		const VkDeviceSize size = m_Allocations.at(pEvictable->GetEvictableMemory()).size;
+		pEvictable->Evict(immediate);
+		if (!immediate)
+			released += size;
+		m_EvictedBytes += size;
+		++m_EvictionCount;
+		evicted = true;
+	}
+	return evicted;
+}
+
+VkDeviceSize ResidencyManager::GetHeapUsage(uint32_t heapIndex) const
+{
+	const MemoryHeapStats& heap = m_vHeaps[heapIndex];
+	if (!m_MemoryBudget)
+		return heap.trackedUsage;
+
+	// The driver's number is only refreshed once a frame, what was allocated or freed since is applied on top
+	const VkDeviceSize usage = heap.usage + heap.trackedUsage;
+	return usage > m_vUsageAtRefresh[heapIndex] ? usage - m_vUsageAtRefresh[heapIndex] : 0;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <vector>
+#include <unordered_map>
+#include "vulkanbase/VulkanUtil.h"
+
+struct MemoryHeapStats
+{
+	VkDeviceSize size{ 0 };
+	VkDeviceSize budget{ 0 };
+	VkDeviceSize usage{ 0 };		// reported by the driver with VK_EXT_memory_budget, the tracked usage otherwise
+	VkDeviceSize trackedUsage{ 0 };	// everything allocated through the residency manager
+	uint32_t allocationCount{ 0 };
+	bool deviceLocal{ false };
+};
+
+// Something that can hand its device memory back and restore it later on its own, e.g. a streamed texture
+class Evictable
+{
+public:
+	virtual ~Evictable() = default;
+
+	// The allocation Evict() frees, VK_NULL_HANDLE while nothing is resident
+	virtual VkDeviceMemory GetEvictableMemory() const = 0;
+	virtual uint64_t GetLastUsedFrame() const = 0;
+	// Deferred frees go through the deletion queue. Immediate ones are only asked for when no frame in flight
+	// can still use the memory, so an allocation waiting on it can go ahead right away.
+	virtual void Evict(bool immediate) = 0;
+};
+
+//-----------------------------------------------------
+// ResidencyManager Class
+//-----------------------------------------------------
+// Every device allocation goes through here, so usage is known per heap. When a device local heap runs over
+// its budget, or an allocation fails, the least recently used evictables give their memory back.
+// Like the rest of the Vulkan objects it is only used from the main thread.
+class ResidencyManager final
+{
+public:
+	// Below the budget extension the heap size is all there is, which other processes share
+	static constexpr float fallbackBudgetFraction{ 0.8f };
+
+	ResidencyManager() = default;
+	~ResidencyManager() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	ResidencyManager(const ResidencyManager& other)					= delete;
+	ResidencyManager(ResidencyManager&& other) noexcept				= delete;
+	ResidencyManager& operator=(const ResidencyManager& other)		= delete;
+	ResidencyManager& operator=(ResidencyManager&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	static ResidencyManager& Get();
+
+	// Has to run before the first allocation, memoryBudget says whether VK_EXT_memory_budget was enabled on the device
+	void Initialize(VkPhysicalDevice physicalDevice, bool memoryBudget);
+
+	// vkAllocateMemory and vkFreeMemory with bookkeeping. A failed allocation evicts and tries once more.
+	VkResult Allocate(VkDevice device, const VkMemoryAllocateInfo& allocInfo, VkDeviceMemory& memory);
+	void Free(VkDevice device, VkDeviceMemory memory);
+
+	// Evictables are registered for their whole life
+	void Register(Evictable* pEvictable);
+	void Unregister(Evictable* pEvictable);
+
+	// Starts a new frame, refreshes the budgets and evicts until every heap fits again.
+	// The previous frame must have finished, nothing used in it is evicted anyway.
+	void Update();
+
+	uint64_t GetFrameIndex() const { return m_FrameIndex; }
+	bool HasMemoryBudget() const { return m_MemoryBudget; }
+	const std::vector<MemoryHeapStats>& GetHeapStats() const { return m_vHeaps; }
+	uint32_t GetEvictionCount() const { return m_EvictionCount; }
+	VkDeviceSize GetEvictedBytes() const { return m_EvictedBytes; }
+
+private:
+	struct Allocation
+	{
+		uint32_t heapIndex{ 0 };
+		VkDeviceSize size{ 0 };
+	};
+
+	void RefreshBudgets();
+	// Evicts from the heap until bytes more fit under its budget, returns false when nothing is left to evict
+	bool EvictFromHeap(uint32_t heapIndex, VkDeviceSize bytes, bool immediate);
+	VkDeviceSize GetHeapUsage(uint32_t heapIndex) const;
+
+	VkPhysicalDevice m_PhysicalDevice{};
+	bool m_MemoryBudget{ false };
+	std::vector<uint32_t> m_vTypeHeaps{};
+	std::vector<MemoryHeapStats> m_vHeaps{};
+
+	std::unordered_map<VkDeviceMemory, Allocation> m_Allocations{};
+	std::vector<VkDeviceSize> m_vUsageAtRefresh{};	// tracked usage when the driver last reported its own
+
+	std::vector<Evictable*> m_vEvictables{};
+	uint64_t m_FrameIndex{ 1 };
+	uint32_t m_EvictionCount{ 0 };
+	VkDeviceSize m_EvictedBytes{ 0 };
+};
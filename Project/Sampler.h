@@ -0,0 +1,35 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include "vulkanbase/VulkanUtil.h"
+#include "DeletionQueue.h"
+
+//-----------------------------------------------------
+// Sampler Class
+//-----------------------------------------------------
+// A sampler shared by everything that asked the asset cache for the same create info.
+// It goes through the deletion queue once the last user lets go of it.
+class Sampler final
+{
+public:
+	explicit Sampler(VkSampler sampler) : m_Sampler{ sampler } {}
+	~Sampler() { DeletionQueue::Get().Destroy(m_Sampler); }
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	Sampler(const Sampler& other)					= delete;
+	Sampler(Sampler&& other) noexcept				= delete;
+	Sampler& operator=(const Sampler& other)		= delete;
+	Sampler& operator=(Sampler&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	VkSampler GetVkSampler() const { return m_Sampler; }
+
+private:
+	VkSampler m_Sampler{};
+};
@@ -0,0 +1,470 @@
+#include "Scene.h"
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <stdexcept>
+#include <type_traits>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace
+{
+	constexpr uint32_t sceneMagic{ 0x43534B56 }; // "VKSC"
+	constexpr uint32_t sceneVersion{ 5 };
+
+	template<typename T>
+	void WriteValue(std::ostream& stream, const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template<typename T>
+	void ReadValue(std::istream& stream, T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		if (!stream.read(reinterpret_cast<char*>(&value), sizeof(T)))
+			throw std::runtime_error("unexpected end of binary scene file!");
+	}
+
+	void WriteString(std::ostream& stream, const std::string& value)
+	{
+		WriteValue(stream, static_cast<uint32_t>(value.size()));
+		stream.write(value.data(), value.size());
+	}
+
+	void ReadString(std::istream& stream, std::string& value)
+	{
+		uint32_t size{};
+		ReadValue(stream, size);
+		value.resize(size);
+		if (size > 0 && !stream.read(value.data(), size))
+			throw std::runtime_error("unexpected end of binary scene file!");
+	}
+
+	// Field by field, so adding a field to the struct cannot silently shift the layout of files with the same version
+	void WriteInstancedData(std::ostream& stream, const InstancedMeshData& data)
+	{
+		WriteValue(stream, data.minOffset);
+		WriteValue(stream, data.maxOffset);
+		WriteValue(stream, data.minScale);
+		WriteValue(stream, data.maxScale);
+		WriteValue(stream, data.minAngle);
+		WriteValue(stream, data.maxAngle);
+		WriteValue(stream, data.rotationAxis);
+		WriteValue(stream, data.minAngularSpeed);
+		WriteValue(stream, data.maxAngularSpeed);
+		WriteValue(stream, data.animationAxis);
+		WriteValue(stream, data.seed);
+		WriteValue(stream, data.cellSize);
+		WriteValue(stream, data.spatialOrder);
+	}
+
+	void ReadInstancedData(std::istream& stream, InstancedMeshData& data)
+	{
+		ReadValue(stream, data.minOffset);
+		ReadValue(stream, data.maxOffset);
+		ReadValue(stream, data.minScale);
+		ReadValue(stream, data.maxScale);
+		ReadValue(stream, data.minAngle);
+		ReadValue(stream, data.maxAngle);
+		ReadValue(stream, data.rotationAxis);
+		ReadValue(stream, data.minAngularSpeed);
+		ReadValue(stream, data.maxAngularSpeed);
+		ReadValue(stream, data.animationAxis);
+		ReadValue(stream, data.seed);
+		ReadValue(stream, data.cellSize);
+		ReadValue(stream, data.spatialOrder);
+	}
+
+	void ReadVec3(std::istringstream& line, glm::vec3& value)
+	{
+		line >> value.x >> value.y >> value.z;
+	}
+
+	ScenePipeline ParsePipeline(const std::string& name)
+	{
+		if (name == "3d")
+			return ScenePipeline::Pipeline3D;
+		if (name == "instanced")
+			return ScenePipeline::Instanced;
+		throw std::runtime_error("unknown scene pipeline '" + name + "'!");
+	}
+
+	void ParseMeshProperty(const std::string& key, std::istringstream& line, SceneEntry& entry)
+	{
+		InstancedMeshData& instancedData = entry.instancedData;
+		if (key == "position")
+			ReadVec3(line, entry.transform.position);
+		else if (key == "rotation")
+		{
+			line >> entry.transform.rotationDegrees;
+			ReadVec3(line, entry.transform.rotationAxis);
+		}
+		else if (key == "scale")
+		{
+			float scale{};
+			line >> scale;
+			entry.transform.scale = glm::vec3(scale);
+		}
+		else if (key == "rotate")
+			line >> entry.rotationSpeed;
+		else if (key == "instances")
+			line >> entry.instanceCount;
+		else if (key == "minOffset")
+			ReadVec3(line, instancedData.minOffset);
+		else if (key == "maxOffset")
+			ReadVec3(line, instancedData.maxOffset);
+		else if (key == "scaleRange")
+			line >> instancedData.minScale >> instancedData.maxScale;
+		else if (key == "angleRange")
+			line >> instancedData.minAngle >> instancedData.maxAngle;
+		else if (key == "axis")
+			ReadVec3(line, instancedData.rotationAxis);
+		else if (key == "speedRange")
+			line >> instancedData.minAngularSpeed >> instancedData.maxAngularSpeed;
+		else if (key == "seed")
+			line >> instancedData.seed;
+		else if (key == "cellSize")
+			line >> instancedData.cellSize;
+		else if (key == "spatialOrder")
+			instancedData.spatialOrder = true;
+		else if (key == "impostor")
+		{
+			line >> entry.impostor.fadeStart >> entry.impostor.fadeEnd;
+			if (entry.impostor.framesPerSide == 0)
+				entry.impostor.framesPerSide = 8;
+		}
+		else if (key == "impostorFrames")
+			line >> entry.impostor.framesPerSide;
+		else if (key == "impostorFrameSize")
+			line >> entry.impostor.frameSize;
+		else
+			throw std::runtime_error("unknown mesh property '" + key + "'!");
+	}
+}
+
+glm::mat4 SceneTransform::ToMatrix() const
+{
+	glm::mat4 matrix = glm::translate(glm::mat4(1.f), position);
+	matrix = glm::rotate(matrix, glm::radians(rotationDegrees), rotationAxis);
+	return glm::scale(matrix, scale);
+}
+
+SceneDescription SceneDescription::Load(const std::string& fileName)
+{
+	if (fileName.ends_with(".bin"))
+		return LoadBinary(fileName);
+	return LoadText(fileName);
+}
+
+//	texture <id> <image>
+//	atlas <id> <padding> <image> [image...]
+//	rectangle <texture> <top> <left> <bottom> <right>
+//	oval <texture> <centerX> <centerY> <radiusX> <radiusY> <segments>
+//	mesh <3d|instanced> <obj> <texture> [position x y z] [rotation degrees x y z] [scale s] [rotate degreesPerSecond]
+//		[instances n] [minOffset x y z] [maxOffset x y z] [scaleRange min max] [angleRange min max] [axis x y z] [speedRange min max] [seed n] [cellSize size] [spatialOrder]
+//		[impostor fadeStart fadeEnd] [impostorFrames n] [impostorFrameSize texels]
+SceneDescription SceneDescription::LoadText(const std::string& fileName)
+{
+	std::ifstream file{ fileName };
+	if (!file.is_open())
+		throw std::runtime_error("failed to open scene file " + fileName + "!");
+
+	SceneDescription scene{};
+	std::string lineText{};
+	int lineNumber{ 0 };
+	while (std::getline(file, lineText))
+	{
+		++lineNumber;
+		std::istringstream line{ lineText };
+		std::string command{};
+		if (!(line >> command) || command[0] == '#')
+			continue;
+
+		SceneEntry entry{};
+		if (command == "texture")
+		{
+			entry.type = SceneEntryType::Texture;
+			line >> entry.name >> entry.file;
+		}
+		else if (command == "atlas")
+		{
+			entry.type = SceneEntryType::Atlas;
+			line >> entry.name >> entry.atlasPadding;
+
+			std::string image{};
+			while (line >> image)
+				entry.atlasImages.push_back(image);
+			if (entry.atlasImages.empty())
+				throw std::runtime_error("atlas on line " + std::to_string(lineNumber) + " has no images!");
+		}
+		else if (command == "rectangle")
+		{
+			entry.type = SceneEntryType::Rectangle;
+			entry.pipeline = ScenePipeline::Pipeline2D;
+			line >> entry.texture >> entry.shape.x >> entry.shape.y >> entry.shape.z >> entry.shape.w;
+		}
+		else if (command == "oval")
+		{
+			entry.type = SceneEntryType::Oval;
+			entry.pipeline = ScenePipeline::Pipeline2D;
+			line >> entry.texture >> entry.shape.x >> entry.shape.y >> entry.shape.z >> entry.shape.w >> entry.segments;
+		}
+		else if (command == "mesh")
+		{
+			std::string pipeline{};
+			entry.type = SceneEntryType::Mesh;
+			line >> pipeline >> entry.file >> entry.texture;
+			entry.pipeline = ParsePipeline(pipeline);
+
+			std::string key{};
+			while (line >> key)
+				ParseMeshProperty(key, line, entry);
+		}
+		else
+			throw std::runtime_error("unknown scene command '" + command + "' on line " + std::to_string(lineNumber) + "!");
+
+		if (line.fail() && !line.eof())
+			throw std::runtime_error("failed to parse scene file line " + std::to_string(lineNumber) + "!");
+
+		scene.entries.push_back(std::move(entry));
+	}
+	return scene;
+}
+
+SceneDescription SceneDescription::LoadBinary(const std::string& fileName)
+{
+	std::ifstream file{ fileName, std::ios::binary };
+	if (!file.is_open())
+		throw std::runtime_error("failed to open scene file " + fileName + "!");
+
+	uint32_t magic{}, version{}, entryCount{};
+	ReadValue(file, magic);
+	ReadValue(file, version);
+	if (magic != sceneMagic || version != sceneVersion)
+		throw std::runtime_error("unsupported binary scene file " + fileName + "!");
+	ReadValue(file, entryCount);
+
+	SceneDescription scene{};
+	scene.entries.resize(entryCount);
+	for (SceneEntry& entry : scene.entries)
+	{
+		ReadValue(file, entry.type);
+		ReadValue(file, entry.pipeline);
+		ReadString(file, entry.name);
+		ReadString(file, entry.file);
+		ReadString(file, entry.texture);
+		uint32_t imageCount{};
+		ReadValue(file, imageCount);
+		entry.atlasImages.resize(imageCount);
+		for (std::string& image : entry.atlasImages)
+			ReadString(file, image);
+		ReadValue(file, entry.atlasPadding);
+		ReadValue(file, entry.transform);
+		ReadValue(file, entry.rotationSpeed);
+		ReadValue(file, entry.instanceCount);
+		ReadInstancedData(file, entry.instancedData);
+		ReadValue(file, entry.impostor);
+		ReadValue(file, entry.shape);
+		ReadValue(file, entry.segments);
+	}
+	return scene;
+}
+
+void SceneDescription::SaveBinary(const std::string& fileName) const
+{
+	std::ofstream file{ fileName, std::ios::binary };
+	if (!file.is_open())
+		throw std::runtime_error("failed to create scene file " + fileName + "!");
+
+	WriteValue(file, sceneMagic);
+	WriteValue(file, sceneVersion);
+	WriteValue(file, static_cast<uint32_t>(entries.size()));
+	for (const SceneEntry& entry : entries)
+	{
+		WriteValue(file, entry.type);
+		WriteValue(file, entry.pipeline);
+		WriteString(file, entry.name);
+		WriteString(file, entry.file);
+		WriteString(file, entry.texture);
+		WriteValue(file, static_cast<uint32_t>(entry.atlasImages.size()));
+		for (const std::string& image : entry.atlasImages)
+			WriteString(file, image);
+		WriteValue(file, entry.atlasPadding);
+		WriteValue(file, entry.transform);
+		WriteValue(file, entry.rotationSpeed);
+		WriteValue(file, entry.instanceCount);
+		WriteInstancedData(file, entry.instancedData);
+		WriteValue(file, entry.impostor);
+		WriteValue(file, entry.shape);
+		WriteValue(file, entry.segments);
+	}
+}
+
+//////////////////////////////////////////////
+
+SceneLoader::SceneLoader(const VulkanContext& context, CommandPool& commandPool, GraphicsPipeline<Mesh3D>& pipeline3D, GraphicsPipeline<Mesh3D>& pipelineInstanced, GraphicsPipeline<Mesh3D>& pipelineFaded, GraphicsPipeline<Mesh3D>& pipelineImpostors, TransformHierarchy& transforms)
+	: m_Context{ context }
+	, m_CommandPool{ commandPool }
+	, m_Pipeline3D{ pipeline3D }
+	, m_PipelineInstanced{ pipelineInstanced }
+	, m_PipelineFaded{ pipelineFaded }
+	, m_PipelineImpostors{ pipelineImpostors }
+	, m_Transforms{ transforms }
+{
+}
+
+void SceneLoader::Load(const std::string& fileName)
+{
+	m_Scene = SceneDescription::Load(fileName);
+	m_NextEntry = 0;
+}
+
+uint32_t SceneLoader::Update(float budgetMilliseconds)
+{
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point start = Clock::now();
+
+	uint32_t processedCount{ 0 };
+	while (!IsDone() && budgetMilliseconds > 0.f)
+	{
+		ProcessEntry(m_Scene.entries[m_NextEntry++]);
+		++processedCount;
+
+		if (std::chrono::duration<float, std::milli>(Clock::now() - start).count() >= budgetMilliseconds)
+			break;
+	}
+	return processedCount;
+}
+
+void SceneLoader::ProcessEntry(const SceneEntry& entry)
+{
+	switch (entry.type)
+	{
+	case SceneEntryType::Texture:
+	{
+		// Bound as a placeholder right away, the mips follow through the streamer. Ids naming the same file share one texture.
+		m_Textures[entry.name] = m_Context.pAssetCache->LoadTexture(entry.file);
+		m_TextureFiles[entry.name] = entry.file;
+		break;
+	}
+	case SceneEntryType::Atlas:
+	{
+		TextureAtlas atlas{};
+		for (const std::string& image : entry.atlasImages)
+			atlas.AddImage(image);
+		atlas.Build(entry.atlasPadding);
+		m_Textures[entry.name] = atlas.CreateTexture(m_Context);
+		m_AtlasCells[entry.name] = atlas.GetCellRects();
+		break;
+	}
+	case SceneEntryType::Rectangle:
+	case SceneEntryType::Oval:
+		m_vSprites.push_back(SceneSprite{ FindTexture(entry.texture), entry.type, entry.shape, entry.segments });
+		break;
+	case SceneEntryType::Mesh:
+	{
+		// Every entry with the same file draws from the same vertex and index buffers
+		MeshImportOptions importOptions{};
+		importOptions.cpuDataPolicy = m_CpuDataPolicy;
+		auto createMesh = [&]()
+			{
+				auto pMesh = Mesh3D::CreateMesh(m_Context.pAssetCache->LoadMesh(entry.file, importOptions), FindTexture(entry.texture));
+				pMesh->SetCpuDataPolicy(m_CpuDataPolicy);
+				if (entry.rotationSpeed != 0.f)
+					pMesh->ToggleRotation(true, entry.rotationSpeed);
+				return pMesh;
+			};
+
+		if (entry.pipeline != ScenePipeline::Instanced)
+		{
+			auto pMesh = createMesh();
+			const glm::quat rotation = glm::angleAxis(glm::radians(entry.transform.rotationDegrees), glm::normalize(entry.transform.rotationAxis));
+			pMesh->SetTransformNode(&m_Transforms, m_Transforms.CreateNode(TransformHierarchy::invalidNode, entry.transform.position, rotation, entry.transform.scale));
+			m_Pipeline3D.AddMesh(std::move(pMesh));
+			break;
+		}
+
+		const BakedImpostor* pBaked = entry.impostor.framesPerSide > 0 ? &BakeImpostor(entry, importOptions) : nullptr;
+
+		// Each range becomes a mesh of its own, so the pipelines generate, grid and upload a large set over several
+		// frames. The ranges generate the same instances the whole set would have had.
+		for (uint32_t firstInstance{ 0 }; firstInstance < entry.instanceCount; )
+		{
+			uint32_t instanceCount = std::min(maxInstancesPerMesh, entry.instanceCount - firstInstance);
+			// A single instance left over would be drawn as a plain mesh, the last range takes it along
+			if (entry.instanceCount - firstInstance - instanceCount == 1)
+				++instanceCount;
+
+			// Instances bake the mesh transform in when they get generated
+			auto pMesh = createMesh();
+			pMesh->SetInstancedMeshData(entry.instancedData);
+			pMesh->SetVertexConstant(MeshData{ entry.transform.ToMatrix() });
+			pMesh->SetInstanceRange(firstInstance, instanceCount, entry.instanceCount);
+			if (auto it = m_AtlasCells.find(entry.texture); it != m_AtlasCells.end())
+				pMesh->SetAtlasCells(it->second);
+
+			// The impostor takes over the mesh's instances when it initializes, so it goes into a pipeline updated after this one
+			std::unique_ptr<Mesh3D> pImpostor{};
+			if (pBaked)
+				pImpostor = Mesh3D::CreateImpostor(*pMesh, pBaked->pAtlas, pBaked->sphere, pBaked->framesPerSide, entry.impostor.fadeStart, entry.impostor.fadeEnd);
+
+			// Only meshes with an impostor dither over the fade band, the others keep early depth testing
+			if (pImpostor)
+			{
+				m_PipelineFaded.AddMesh(std::move(pMesh));
+				m_PipelineImpostors.AddMesh(std::move(pImpostor));
+			}
+			else
+				m_PipelineInstanced.AddMesh(std::move(pMesh));
+			firstInstance += instanceCount;
+		}
+		break;
+	}
+	}
+}
+
+void SceneLoader::SubmitSprites(SpriteBatch& spriteBatch) const
+{
+	for (const SceneSprite& sprite : m_vSprites)
+	{
+		if (sprite.type == SceneEntryType::Rectangle)
+			spriteBatch.DrawQuad(sprite.pTexture.get(), sprite.shape);
+		else
+			spriteBatch.DrawOval(sprite.pTexture.get(), { sprite.shape.x, sprite.shape.y }, { sprite.shape.z, sprite.shape.w }, sprite.segments);
+	}
+}
+
+const SceneLoader::BakedImpostor& SceneLoader::BakeImpostor(const SceneEntry& entry, const MeshImportOptions& importOptions)
+{
+	// Every instance of an atlas textured mesh shows another cell, a single bake cannot stand in for them
+	auto textureFile = m_TextureFiles.find(entry.texture);
+	if (textureFile == m_TextureFiles.end())
+		throw std::runtime_error("impostors need a plain texture, '" + entry.texture + "' is not one!");
+	if (entry.impostor.fadeEnd <= entry.impostor.fadeStart)
+		throw std::runtime_error("impostor fade of " + entry.file + " has to end after it starts!");
+
+	const std::string key = entry.file + '|' + textureFile->second + '|' + std::to_string(entry.impostor.framesPerSide) + '|' + std::to_string(entry.impostor.frameSize);
+	if (auto it = m_Impostors.find(key); it != m_Impostors.end())
+		return it->second;
+
+	// The cached asset may have dropped its vertices after upload, the bake then reads a private import
+	std::shared_ptr<MeshAsset> pAsset = m_Context.pAssetCache->LoadMesh(entry.file, importOptions);
+	if (pAsset->vVertices.empty())
+		pAsset = MeshAsset::Import(entry.file, importOptions);
+
+	ImpostorAtlas atlas{};
+	atlas.Bake(pAsset->vVertices, pAsset->vIndices, textureFile->second, entry.impostor.framesPerSide, entry.impostor.frameSize);
+	return m_Impostors[key] = BakedImpostor{ atlas.CreateTexture(m_Context), atlas.GetSphere(), atlas.GetFramesPerSide() };
+}
+
+std::shared_ptr<Texture> SceneLoader::FindTexture(const std::string& name) const
+{
+	auto it = m_Textures.find(name);
+	if (it == m_Textures.end())
+		throw std::runtime_error("scene references unknown texture '" + name + "'!");
+	return it->second;
+}
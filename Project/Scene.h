@@ -0,0 +1,143 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "vulkanbase/VulkanUtil.h"
+#include "CommandPool.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include "StreamedTexture.h"
+#include "GraphicsPipeline.h"
+#include "TransformHierarchy.h"
+#include "SpriteBatch.h"
+#include "AssetCache.h"
+#include "ImpostorAtlas.h"
+
+enum class SceneEntryType : uint8_t
+{
+	Texture,
+	Atlas,
+	Rectangle,
+	Oval,
+	Mesh
+};
+
+enum class ScenePipeline : uint8_t
+{
+	Pipeline2D,
+	Pipeline3D,
+	Instanced
+};
+
+struct SceneTransform
+{
+	glm::vec3 position{ 0, 0, 0 };
+	glm::vec3 rotationAxis{ 0, 1, 0 };
+	float rotationDegrees{ 0.f };
+	glm::vec3 scale{ 1, 1, 1 };
+
+	glm::mat4 ToMatrix() const;
+};
+
+// One entry is also one streaming chunk
+struct SceneEntry
+{
+	SceneEntryType type{ SceneEntryType::Texture };
+	ScenePipeline pipeline{ ScenePipeline::Pipeline3D };
+	std::string name{};		// texture id
+	std::string file{};		// image for textures, obj for meshes
+	std::string texture{};	// texture id used by shapes and meshes
+
+	std::vector<std::string> atlasImages{};
+	uint32_t atlasPadding{ 4 };
+
+	SceneTransform transform{};
+	float rotationSpeed{ 0.f };	// degrees per second, 0 disables rotation
+
+	uint32_t instanceCount{ 1 };
+	InstancedMeshData instancedData{};
+	ImpostorSettings impostor{};	// instanced meshes only
+
+	glm::vec4 shape{};		// rectangle: top, left, bottom, right. oval: center xy, radius xy
+	int segments{ 0 };
+};
+
+// Scene files come in two flavours with the same content:
+// a line based text format (.txt) meant to be edited by hand and a binary format (.bin) that loads without parsing
+class SceneDescription final
+{
+public:
+	static SceneDescription Load(const std::string& fileName);
+	static SceneDescription LoadText(const std::string& fileName);
+	static SceneDescription LoadBinary(const std::string& fileName);
+	void SaveBinary(const std::string& fileName) const;
+
+	std::vector<SceneEntry> entries{};
+};
+
+// Turns scene entries into textures and meshes a few at a time, so rendering can start
+// before the whole scene is resident and later chunks stream in over the following frames.
+class SceneLoader final
+{
+public:
+	SceneLoader(const VulkanContext& context, CommandPool& commandPool, GraphicsPipeline<Mesh3D>& pipeline3D, GraphicsPipeline<Mesh3D>& pipelineInstanced, GraphicsPipeline<Mesh3D>& pipelineFaded, GraphicsPipeline<Mesh3D>& pipelineImpostors, TransformHierarchy& transforms);
+
+	void Load(const std::string& fileName);
+
+	// Processes chunks until the time budget is spent, at least one unless it was spent before the call.
+	// Returns how many were processed.
+	uint32_t Update(float budgetMilliseconds);
+
+	bool IsDone() const { return m_NextEntry >= m_Scene.entries.size(); }
+	size_t GetLoadedChunkCount() const { return m_NextEntry; }
+	size_t GetChunkCount() const { return m_Scene.entries.size(); }
+
+	// Rectangles and ovals are not meshes, they are handed to the sprite batch again every frame
+	void SubmitSprites(SpriteBatch& spriteBatch) const;
+
+	// Applies to the meshes and mesh assets created from here on
+	void SetCpuDataPolicy(CpuDataPolicy policy) { m_CpuDataPolicy = policy; }
+
+private:
+	// Instanced entries are split into meshes of at most this many instances, a whole multiple of the generation chunks
+	static constexpr uint32_t maxInstancesPerMesh{ 4 * InstancedMeshData::chunkSize };
+
+	struct SceneSprite
+	{
+		std::shared_ptr<Texture> pTexture{};
+		SceneEntryType type{ SceneEntryType::Rectangle };
+		glm::vec4 shape{};
+		int segments{ 0 };
+	};
+
+	struct BakedImpostor
+	{
+		std::shared_ptr<Texture> pAtlas{};
+		glm::vec4 sphere{};
+		uint32_t framesPerSide{ 0 };
+	};
+
+	void ProcessEntry(const SceneEntry& entry);
+	// Entries with the same mesh, texture and frame layout share one bake
+	const BakedImpostor& BakeImpostor(const SceneEntry& entry, const MeshImportOptions& importOptions);
+	std::shared_ptr<Texture> FindTexture(const std::string& name) const;
+
+	VulkanContext m_Context;
+	CommandPool& m_CommandPool;
+	GraphicsPipeline<Mesh3D>& m_Pipeline3D;
+	GraphicsPipeline<Mesh3D>& m_PipelineInstanced;
+	GraphicsPipeline<Mesh3D>& m_PipelineFaded;	// instanced meshes that fade into an impostor
+	GraphicsPipeline<Mesh3D>& m_PipelineImpostors;
+	TransformHierarchy& m_Transforms;
+
+	SceneDescription m_Scene{};
+	size_t m_NextEntry{ 0 };
+	std::unordered_map<std::string, std::shared_ptr<Texture>> m_Textures{};
+	std::unordered_map<std::string, std::vector<glm::vec4>> m_AtlasCells{};	// texture id -> cell rects, only for atlases
+	std::unordered_map<std::string, std::string> m_TextureFiles{};			// texture id -> image, only for textures
+	std::unordered_map<std::string, BakedImpostor> m_Impostors{};
+	std::vector<SceneSprite> m_vSprites{};
+	CpuDataPolicy m_CpuDataPolicy{ CpuDataPolicy::Keep };
+};
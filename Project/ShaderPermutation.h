@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include "GP2Shader.h"
+
+enum class LightingModel : uint32_t
+{
+	Unlit,			// texture only
+	Lambert,		// diffuse with a fixed ambient floor
+	HalfLambert		// wrapped diffuse, softer falloff on the dark side
+};
+
+enum class VertexFormat : uint32_t
+{
+	Vertex3D,
+	Vertex2D		// xy position only, no normal
+};
+
+// One variant of the mesh shaders. Every field is a specialization constant, so the branches a permutation
+// does not take are compiled out of its pipeline instead of being evaluated per vertex or fragment.
+struct ShaderPermutation
+{
+	// Constant 0 is the bindless texture array size, set by the pipeline
+	static constexpr uint32_t instancedConstant{ 1 };
+	static constexpr uint32_t lightingConstant{ 2 };
+	static constexpr uint32_t textureAtlasConstant{ 3 };
+	static constexpr uint32_t vertexFormatConstant{ 4 };
+	static constexpr uint32_t impostorConstant{ 5 };
+	static constexpr uint32_t lodFadeConstant{ 6 };
+
+	// Highest vertex input location of the mesh shaders plus one, the instance attributes start at 4
+	static constexpr uint32_t vertexInputCount{ 11 };
+	static constexpr uint32_t firstInstanceLocation{ 4 };
+
+	static constexpr const char* vertexShaderFile{ "shaders/mesh.vert.spv" };
+	static constexpr const char* fragmentShaderFile{ "shaders/mesh.frag.spv" };
+
+	bool instanced{ false };
+	LightingModel lighting{ LightingModel::Lambert };
+	bool textureAtlas{ false };		// per instance atlas cell, only read when instanced
+	VertexFormat vertexFormat{ VertexFormat::Vertex3D };
+	bool impostor{ false };			// instanced quads showing a frame of the octahedral impostor atlas, Vertex3D only
+	bool lodFade{ false };			// dithers over a fade band between a mesh and its impostor, costs early depth testing
+
+	// Distinct for every permutation and fits the pipeline field of a draw sort key
+	uint32_t GetId() const
+	{
+		return (instanced ? 1u : 0u)
+			| (static_cast<uint32_t>(lighting) << 1)
+			| ((textureAtlas ? 1u : 0u) << 3)
+			| (static_cast<uint32_t>(vertexFormat) << 4)
+			| ((impostor ? 1u : 0u) << 5)
+			| ((lodFade ? 1u : 0u) << 6);
+	}
+
+	void ApplyTo(GP2Shader& shader) const
+	{
+		shader.setSpecializationConstant(instancedConstant, instanced ? 1 : 0);
+		shader.setSpecializationConstant(lightingConstant, static_cast<uint32_t>(lighting));
+		shader.setSpecializationConstant(textureAtlasConstant, textureAtlas ? 1 : 0);
+		shader.setSpecializationConstant(vertexFormatConstant, static_cast<uint32_t>(vertexFormat));
+		shader.setSpecializationConstant(impostorConstant, impostor ? 1 : 0);
+		shader.setSpecializationConstant(lodFadeConstant, lodFade ? 1 : 0);
+	}
+};
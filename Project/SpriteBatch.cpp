@@ -0,0 +1,367 @@
+
+//---------------------------
+// Includes
+//---------------------------
+#include "SpriteBatch.h"
+#include "TransferQueue.h"
+#include <algorithm>
+#include <bit>
+#include <numbers>
+#include <numeric>
+#include <stdexcept>
+
+namespace
+{
+	// Starting size of each frame's pool chain, it grows when a frame draws more distinct textures
+	constexpr uint32_t initialSpriteTextures{ 64 };
+}
+
+//---------------------------
+// Member functions
+//---------------------------
+
+void SpriteBatch::Initialize(const VulkanContext& context, uint32_t initialQuadCapacity, uint32_t framesInFlight)
+{
+	m_Context = context;
+	m_FrameCount = std::max(framesInFlight, 1u);
+
+	CreateDescriptorSetLayout();
+	m_DescriptorAllocator.Initialize(m_Context.device, { { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.f } }, initialSpriteTextures, m_FrameCount);
+	CreatePipeline();
+	CreateIndexBuffer();
+	CreateVertexBuffer(std::max(initialQuadCapacity, 1u));
+}
+
+void SpriteBatch::Cleanup()
+{
+	m_VertexBuffer.reset();
+	m_IndexBuffer.reset();
+	m_FrameDescriptorSets.clear();
+	m_DescriptorAllocator.Cleanup();
+
+	vkDestroyPipeline(m_Context.device, m_Pipeline, nullptr);
+	vkDestroyPipelineLayout(m_Context.device, m_PipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_Context.device, m_DescriptorSetLayout, nullptr);
+	m_Pipeline = VK_NULL_HANDLE;
+	m_PipelineLayout = VK_NULL_HANDLE;
+	m_DescriptorSetLayout = VK_NULL_HANDLE;
+}
+
+void SpriteBatch::Begin()
+{
+	m_FrameIndex = (m_FrameIndex + 1) % m_FrameCount;
+	m_DescriptorAllocator.BeginFrame();
+	m_FrameDescriptorSets.clear();
+	m_vSortKeys.clear();
+	m_vQuads.clear();
+	m_vTextures.clear();
+	m_TextureIndices.clear();
+	m_vBatches.clear();
+	m_Stats = SpriteBatchStats{};
+}
+
+void SpriteBatch::DrawQuad(const Texture* pTexture, const glm::vec4& rect, const glm::vec4& uvRect, const glm::vec3& color, uint32_t layer)
+{
+	// rect: top, left, bottom, right like Mesh2D::CreateRectangle
+	const glm::vec2 uvMin{ uvRect.x, uvRect.y };
+	const glm::vec2 uvMax{ uvRect.x + uvRect.z, uvRect.y + uvRect.w };
+	AddQuad(pTexture, layer, {
+		Vertex2D{ glm::vec2{ rect.y, rect.x }, color, uvMin },
+		Vertex2D{ glm::vec2{ rect.w, rect.x }, color, glm::vec2{ uvMax.x, uvMin.y } },
+		Vertex2D{ glm::vec2{ rect.w, rect.z }, color, uvMax },
+		Vertex2D{ glm::vec2{ rect.y, rect.z }, color, glm::vec2{ uvMin.x, uvMax.y } } });
+}
+
+void SpriteBatch::DrawOval(const Texture* pTexture, const glm::vec2& center, const glm::vec2& radius, int segmentCount, const glm::vec3& color, uint32_t layer)
+{
+	if (segmentCount < 3)
+		return;
+
+	const float radians = std::numbers::pi_v<float> * 2.f / segmentCount;
+	auto edgeVertex = [&](int segment)
+		{
+			const glm::vec2 direction{ glm::cos(radians * segment), glm::sin(radians * segment) };
+			return Vertex2D{ center + radius * direction, color, glm::vec2{ 0.5f, 0.5f } + 0.5f * direction };
+		};
+
+	// The quad indices 0 1 2, 0 2 3 turn center, e0, e1, e2 into the fan triangles of two segments.
+	// With an odd segment count the last quad repeats its final vertex, which makes its second triangle degenerate.
+	const Vertex2D centerVertex{ center, color, glm::vec2{ 0.5f, 0.5f } };
+	for (int segment = 0; segment < segmentCount; segment += 2)
+	{
+		const int last = std::min(segment + 2, segmentCount);
+		AddQuad(pTexture, layer, { centerVertex, edgeVertex(segment), edgeVertex(segment + 1), edgeVertex(last) });
+	}
+}
+
+void SpriteBatch::End()
+{
+	const uint32_t quadCount = static_cast<uint32_t>(m_vQuads.size());
+	m_Stats.quads = quadCount;
+	m_Stats.vertices = quadCount * 4;
+	if (quadCount == 0)
+		return;
+
+	// Submission order is kept within a layer and texture, UI code usually submits in order already
+	m_vOrder.resize(quadCount);
+	std::iota(m_vOrder.begin(), m_vOrder.end(), 0);
+	if (!std::is_sorted(m_vSortKeys.begin(), m_vSortKeys.end()))
+		std::stable_sort(m_vOrder.begin(), m_vOrder.end(), [this](uint32_t a, uint32_t b) { return m_vSortKeys[a] < m_vSortKeys[b]; });
+
+	// Growing is rare, so waiting for the queue instead of tracking every region's last use is fine
+	if (quadCount > m_QuadCapacity)
+	{
+		vkQueueWaitIdle(m_Context.graphicsQueue);
+		CreateVertexBuffer(std::bit_ceil(quadCount));
+	}
+
+	const VkDeviceSize frameOffset = static_cast<VkDeviceSize>(m_FrameIndex) * m_QuadCapacity * sizeof(std::array<Vertex2D, 4>);
+	uint32_t previousTexture{ UINT32_MAX };
+	for (uint32_t i = 0; i < quadCount; ++i)
+	{
+		const uint32_t quadIndex = m_vOrder[i];
+		m_VertexBuffer->Upload(m_vQuads[quadIndex].data(), frameOffset + i * sizeof(std::array<Vertex2D, 4>), sizeof(std::array<Vertex2D, 4>));
+
+		const uint32_t textureIndex = static_cast<uint32_t>(m_vSortKeys[quadIndex]);
+		if (textureIndex != previousTexture || m_vBatches.back().quadCount == maxQuadsPerFlush)
+		{
+			m_vBatches.push_back(Batch{ GetDescriptorSet(m_vTextures[textureIndex]), i, 0 });
+			previousTexture = textureIndex;
+		}
+		++m_vBatches.back().quadCount;
+	}
+	m_Stats.flushes = static_cast<uint32_t>(m_vBatches.size());
+}
+
+void SpriteBatch::Record(const CommandBuffer& buffer, VkExtent2D extent, const glm::mat4& viewProjection) const
+{
+	if (m_vBatches.empty())
+		return;
+
+	const VkCommandBuffer commandBuffer = buffer.GetVkCommandBuffer();
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
+
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)extent.width;
+	viewport.height = (float)extent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = extent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	vkCmdPushConstants(commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &viewProjection);
+	m_VertexBuffer->BindAsVertexBuffer(commandBuffer);
+	vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer->GetVkBuffer(), 0, VK_INDEX_TYPE_UINT16);
+
+	// Every batch starts at index 0, the vertex offset moves the shared quad indices onto the batch's vertices
+	const int32_t frameVertexOffset = static_cast<int32_t>(m_FrameIndex * m_QuadCapacity * 4);
+	VkDescriptorSet boundSet{ VK_NULL_HANDLE };
+	for (const Batch& batch : m_vBatches)
+	{
+		if (batch.descriptorSet != boundSet)
+		{
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &batch.descriptorSet, 0, nullptr);
+			boundSet = batch.descriptorSet;
+		}
+		vkCmdDrawIndexed(commandBuffer, batch.quadCount * 6, 1, 0, frameVertexOffset + static_cast<int32_t>(batch.firstQuad * 4), 0);
+	}
+}
+
+void SpriteBatch::CreateDescriptorSetLayout()
+{
+	VkDescriptorSetLayoutBinding samplerBinding{};
+	samplerBinding.binding = 0;
+	samplerBinding.descriptorCount = 1;
+	samplerBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	samplerBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &samplerBinding;
+	if (vkCreateDescriptorSetLayout(m_Context.device, &layoutInfo, nullptr, &m_DescriptorSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create sprite batch descriptor set layout!");
+}
+
+void SpriteBatch::CreatePipeline()
+{
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(glm::mat4);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	if (vkCreatePipelineLayout(m_Context.device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create sprite batch pipeline layout!");
+
+	const VkVertexInputBindingDescription bindingDescription = Vertex2D::GetBindingDescription();
+	const std::vector<VkVertexInputAttributeDescription> attributeDescriptions = Vertex2D::GetAttributeDescriptions();
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	// Both windings show up, ovals go counter clockwise and rectangles clockwise
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
+	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizer.depthBiasEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	// Sprites are drawn over the finished scene, so they blend instead of depth testing
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_TRUE;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_FALSE;
+	depthStencil.depthWriteEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
+	std::vector<VkDynamicState> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	m_Shader.initialize(m_Context);
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = static_cast<uint32_t>(m_Shader.getShaderStages().size());
+	pipelineInfo.pStages = m_Shader.getShaderStages().data();
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.layout = m_PipelineLayout;
+	pipelineInfo.renderPass = m_Context.renderPass;
+	pipelineInfo.subpass = 0;
+
+	if (vkCreateGraphicsPipelines(m_Context.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_Pipeline) != VK_SUCCESS)
+		throw std::runtime_error("failed to create sprite batch pipeline!");
+
+	m_Shader.destroyShaderModules(m_Context.device);
+}
+
+void SpriteBatch::CreateIndexBuffer()
+{
+	std::vector<uint16_t> vIndices(maxQuadsPerFlush * 6);
+	for (uint32_t quad = 0; quad < maxQuadsPerFlush; ++quad)
+	{
+		const uint16_t first = static_cast<uint16_t>(quad * 4);
+		const std::array<uint16_t, 6> quadIndices{ first, static_cast<uint16_t>(first + 1), static_cast<uint16_t>(first + 2), first, static_cast<uint16_t>(first + 2), static_cast<uint16_t>(first + 3) };
+		std::copy(quadIndices.begin(), quadIndices.end(), vIndices.begin() + quad * 6);
+	}
+
+	const VkDeviceSize bufferSize = sizeof(uint16_t) * vIndices.size();
+	m_IndexBuffer = std::make_unique<Buffer>(m_Context, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, bufferSize);
+
+	TransferQueue& transferQueue = *m_Context.pTransferQueue;
+	UploadBatch batch = transferQueue.Begin();
+	transferQueue.CopyToBuffer(batch, vIndices.data(), bufferSize, m_IndexBuffer->GetVkBuffer(), VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+	transferQueue.Submit(std::move(batch));
+}
+
+void SpriteBatch::CreateVertexBuffer(uint32_t quadCapacity)
+{
+	// Host visible and mapped for its whole life, the vertices are rewritten every frame anyway
+	m_QuadCapacity = quadCapacity;
+	const VkDeviceSize bufferSize = static_cast<VkDeviceSize>(quadCapacity) * m_FrameCount * sizeof(std::array<Vertex2D, 4>);
+	m_VertexBuffer = std::make_unique<Buffer>(m_Context, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, bufferSize);
+	m_VertexBuffer->Map();
+}
+
+VkDescriptorSet SpriteBatch::GetDescriptorSet(const Texture* pTexture)
+{
+	// One set per texture per frame, written with whatever view the texture has right now
+	auto [it, inserted] = m_FrameDescriptorSets.try_emplace(pTexture, VK_NULL_HANDLE);
+	if (!inserted)
+		return it->second;
+
+	it->second = m_DescriptorAllocator.Allocate(m_DescriptorSetLayout);
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = pTexture->GetTextureImageView();
+	imageInfo.sampler = pTexture->GetTextureSampler();
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = it->second;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(m_Context.device, 1, &descriptorWrite, 0, nullptr);
+
+	return it->second;
+}
+
+void SpriteBatch::AddQuad(const Texture* pTexture, uint32_t layer, const std::array<Vertex2D, 4>& vertices)
+{
+	// Textures get a frame local index in order of first use, the key sorts by layer first and texture second
+	const auto [it, inserted] = m_TextureIndices.try_emplace(pTexture, static_cast<uint32_t>(m_vTextures.size()));
+	if (inserted)
+	{
+		m_vTextures.push_back(pTexture);
+		pTexture->MarkUsed();
+	}
+	const uint32_t textureIndex = it->second;
+
+	m_vSortKeys.push_back((static_cast<uint64_t>(layer) << 32) | textureIndex);
+	m_vQuads.push_back(vertices);
+}
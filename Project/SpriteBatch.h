@@ -0,0 +1,106 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <array>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "vulkanbase/VulkanUtil.h"
+#include "CommandBuffer.h"
+#include "Buffer.h"
+#include "Texture.h"
+#include "Vertex.h"
+#include "GP2Shader.h"
+#include "DescriptorAllocator.h"
+
+struct SpriteBatchStats
+{
+	uint32_t quads{ 0 };
+	uint32_t vertices{ 0 };
+	uint32_t flushes{ 0 };	// draw calls, one per texture change or full index buffer
+};
+
+//-----------------------------------------------------
+// SpriteBatch Class
+//-----------------------------------------------------
+// Immediate mode 2D renderer. Everything submitted between Begin() and End() is sorted by layer and texture,
+// written into a persistently mapped vertex buffer and drawn with one indexed draw per texture run.
+// All quads share one static index buffer, ovals are fans stored as quads that cover two segments each.
+class SpriteBatch final
+{
+public:
+	// 16 bit indices address 65536 vertices, which is exactly this many quads
+	static constexpr uint32_t maxQuadsPerFlush{ 16384 };
+
+	SpriteBatch() = default;
+	~SpriteBatch() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	SpriteBatch(const SpriteBatch& other)					= delete;
+	SpriteBatch(SpriteBatch&& other) noexcept				= delete;
+	SpriteBatch& operator=(const SpriteBatch& other)		= delete;
+	SpriteBatch& operator=(SpriteBatch&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	// Every frame in flight owns one region of the vertex buffer. The pipeline does no depth testing,
+	// so it should be recorded last in a render pass compatible with the context's one.
+	void Initialize(const VulkanContext& context, uint32_t initialQuadCapacity = 4096, uint32_t framesInFlight = 1);
+	void Cleanup();
+
+	void Begin();
+	// Rectangles in pixels, uv rect as offset and scale. Lower layers are drawn first, within a layer textures are grouped.
+	void DrawQuad(const Texture* pTexture, const glm::vec4& rect, const glm::vec4& uvRect = { 0, 0, 1, 1 }, const glm::vec3& color = { 1, 1, 1 }, uint32_t layer = 0);
+	void DrawOval(const Texture* pTexture, const glm::vec2& center, const glm::vec2& radius, int segmentCount, const glm::vec3& color = { 1, 1, 1 }, uint32_t layer = 0);
+	// Sorts and writes the frame's vertices, has to run after the frame's fence was waited on and before recording
+	void End();
+	void Record(const CommandBuffer& buffer, VkExtent2D extent, const glm::mat4& viewProjection) const;
+
+	const SpriteBatchStats& GetStats() const { return m_Stats; }
+
+private:
+	struct Batch
+	{
+		VkDescriptorSet descriptorSet{};
+		uint32_t firstQuad{ 0 };
+		uint32_t quadCount{ 0 };
+	};
+
+	void CreateDescriptorSetLayout();
+	void CreatePipeline();
+	void CreateIndexBuffer();
+	void CreateVertexBuffer(uint32_t quadCapacity);
+	VkDescriptorSet GetDescriptorSet(const Texture* pTexture);
+	void AddQuad(const Texture* pTexture, uint32_t layer, const std::array<Vertex2D, 4>& vertices);
+
+	VulkanContext m_Context{};
+	GP2Shader m_Shader{ "shaders/sprite.vert.spv", "shaders/sprite.frag.spv" };
+	VkPipelineLayout m_PipelineLayout{};
+	VkPipeline m_Pipeline{};
+
+	// Sets only live for the frame that wrote them, so streamed views never have to be tracked
+	TransientDescriptorAllocator m_DescriptorAllocator{};
+	VkDescriptorSetLayout m_DescriptorSetLayout{};
+	std::unordered_map<const Texture*, VkDescriptorSet> m_FrameDescriptorSets{};
+
+	std::unique_ptr<Buffer> m_IndexBuffer{};
+	std::unique_ptr<Buffer> m_VertexBuffer{};
+	uint32_t m_QuadCapacity{ 0 };
+	uint32_t m_FrameCount{ 1 };
+	uint32_t m_FrameIndex{ 0 };
+
+	// Quads are collected first and only written to the mapped buffer once they are in draw order
+	std::vector<uint64_t> m_vSortKeys{};
+	std::vector<std::array<Vertex2D, 4>> m_vQuads{};
+	std::vector<uint32_t> m_vOrder{};
+	std::vector<const Texture*> m_vTextures{};
+	std::unordered_map<const Texture*, uint32_t> m_TextureIndices{};	// texture -> index in m_vTextures
+	std::vector<Batch> m_vBatches{};
+	SpriteBatchStats m_Stats{};
+};
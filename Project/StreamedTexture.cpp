@@ -0,0 +1,234 @@
+#include "StreamedTexture.h"
+#include <bit>
+#include <array>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <stb_image.h>
+#include "ThreadPool.h"
+#include "DeletionQueue.h"
+
+StreamedTexture::StreamedTexture(const std::string& fileName, const VulkanContext& context)
+	: Texture(context)
+	, m_FileName{ fileName }
+{
+	const std::string filePath = "resources/" + fileName;
+
+	// Only the header is read here, so the sampler and the level count are known before any pixel is
+	int texWidth, texHeight, texChannels;
+	if (!stbi_info(filePath.c_str(), &texWidth, &texHeight, &texChannels))
+		throw std::runtime_error("failed to read texture image info!");
+
+	m_Width = static_cast<uint32_t>(texWidth);
+	m_Height = static_cast<uint32_t>(texHeight);
+	m_MipLevels = static_cast<uint32_t>(std::bit_width(std::max(m_Width, m_Height)));
+	m_ResidentMip = m_MipLevels;
+
+	CreatePlaceholder();
+	CreateTextureSampler();
+	StartDecode();
+	ResidencyManager::Get().Register(this);
+}
+
+StreamedTexture::~StreamedTexture()
+{
+	ResidencyManager::Get().Unregister(this);
+
+	// The decode task only touches its own copies, but it must not outlive the texture that waits for it
+	if (m_DecodedMips.valid())
+		m_DecodedMips.wait();
+
+	// The base destructor owns the current view, which must not be the placeholder one
+	if (m_TextureImageView == m_PlaceholderView)
+		m_TextureImageView = VK_NULL_HANDLE;
+
+	DeletionQueue& deletionQueue = DeletionQueue::Get();
+	deletionQueue.Destroy(m_PlaceholderView);
+	deletionQueue.Destroy(m_PlaceholderImage);
+	deletionQueue.Free(m_PlaceholderMemory);
+}
+
+void StreamedTexture::StartDecode()
+{
+	m_DecodedMips = ThreadPool::Get().Enqueue([filePath = "resources/" + m_FileName, mipLevelCount = m_MipLevels]()
+		{
+			int width, height, channels;
+			stbi_uc* pixels = stbi_load(filePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+			if (!pixels)
+				throw std::runtime_error("failed to load texture image!");
+
+			std::vector<TextureMipLevel> vMipLevels{ { static_cast<uint32_t>(width), static_cast<uint32_t>(height) } };
+			vMipLevels[0].pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+			stbi_image_free(pixels);
+
+			GenerateMipLevels(vMipLevels, mipLevelCount);
+			return vMipLevels;
+		});
+}
+
+VkDeviceSize StreamedTexture::StreamNextMip(UploadBatch& batch, VkDeviceSize budget)
+{
+	if (IsFullyResident())
+		return 0;
+
+	if (m_vMipLevels.empty())
+	{
+		// After an eviction the file is only decoded again once something draws the texture
+		if (!m_DecodedMips.valid())
+		{
+			if (m_LastUsedFrame > m_EvictedFrame)
+				StartDecode();
+			return 0;
+		}
+		if (m_DecodedMips.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return 0;
+		m_vMipLevels = m_DecodedMips.get();
+	}
+
+	const uint32_t mipLevel = m_ResidentMip - 1;
+	TextureMipLevel& level = m_vMipLevels[mipLevel];
+	const VkDeviceSize levelSize = level.pixels.size();
+	if (levelSize > budget)
+		return 0;
+
+	// The full image only gets allocated once there is something to put in it
+	if (m_TextureImage == VK_NULL_HANDLE)
+		CreateImage(m_Width, m_Height, m_MipLevels, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_TextureImage, m_TextureImageMemory);
+
+	m_Context.pTransferQueue->CopyToImage(batch, level.pixels.data(), levelSize, m_TextureImage, mipLevel, level.width, level.height);
+	std::vector<uint8_t>().swap(level.pixels);
+	MarkUsed();
+
+	m_ResidentMip = mipLevel;
+	PublishView(mipLevel);
+	return levelSize;
+}
+
+void StreamedTexture::Evict(bool immediate)
+{
+	// The old view may still be in a descriptor until the next refresh, so it retires like a replaced one
+	if (m_TextureImageView != m_PlaceholderView)
+		DeletionQueue::Get().Destroy(m_TextureImageView);
+	m_TextureImageView = m_PlaceholderView;
+	++m_ViewVersion;
+
+	// Only the view can still be in a descriptor, the image is not read by the frame in flight
+	if (immediate)
+	{
+		vkDestroyImage(m_Context.device, m_TextureImage, nullptr);
+		ResidencyManager::Get().Free(m_Context.device, m_TextureImageMemory);
+	}
+	else
+	{
+		DeletionQueue::Get().Destroy(m_TextureImage);
+		DeletionQueue::Get().Free(m_TextureImageMemory);
+	}
+	m_TextureImage = VK_NULL_HANDLE;
+	m_TextureImageMemory = VK_NULL_HANDLE;
+
+	m_vMipLevels.clear();
+	m_ResidentMip = m_MipLevels;
+	m_EvictedFrame = ResidencyManager::Get().GetFrameIndex();
+}
+
+void StreamedTexture::CreatePlaceholder()
+{
+	const std::array<uint8_t, 4> grey{ 128, 128, 128, 255 };
+
+	CreateImage(1, 1, 1, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_PlaceholderImage, m_PlaceholderMemory);
+
+	TransferQueue& transferQueue = *m_Context.pTransferQueue;
+	UploadBatch batch = transferQueue.Begin();
+	transferQueue.CopyToImage(batch, grey.data(), grey.size(), m_PlaceholderImage, 0, 1, 1);
+	transferQueue.Submit(std::move(batch));
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = m_PlaceholderImage;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(m_Context.device, &viewInfo, nullptr, &m_PlaceholderView) != VK_SUCCESS)
+		throw std::runtime_error("failed to create placeholder image view!");
+
+	m_TextureImageView = m_PlaceholderView;
+}
+
+void StreamedTexture::PublishView(uint32_t baseMip)
+{
+	// Levels below the base are not written yet, so the view itself is what clamps the sampled LOD
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = m_TextureImage;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = baseMip;
+	viewInfo.subresourceRange.levelCount = m_MipLevels - baseMip;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	VkImageView view{};
+	if (vkCreateImageView(m_Context.device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+		throw std::runtime_error("failed to create texture image view!");
+
+	// The previous frame may still sample the old view, it is destroyed once that frame is known to be done
+	if (m_TextureImageView != m_PlaceholderView)
+		DeletionQueue::Get().Destroy(m_TextureImageView);
+
+	m_TextureImageView = view;
+	++m_ViewVersion;
+}
+
+void TextureStreamer::Update(TransferQueue& transferQueue, VkDeviceSize budget)
+{
+	m_UploadedBytes = 0;
+
+	std::erase_if(m_vTextures, [](const std::weak_ptr<StreamedTexture>& pWeakTexture) { return pWeakTexture.expired(); });
+
+	if (m_vTextures.empty())
+		return;
+
+	// Round robin over the textures, one mip each per pass, so large textures do not starve small ones
+	UploadBatch batch = transferQueue.Begin();
+	const size_t textureCount = m_vTextures.size();
+	m_NextTexture %= textureCount;
+	bool uploaded{ true };
+	while (uploaded && m_UploadedBytes < budget)
+	{
+		uploaded = false;
+		for (size_t i{}; i < textureCount && m_UploadedBytes < budget; ++i)
+		{
+			const std::shared_ptr<StreamedTexture> pTexture = m_vTextures[(m_NextTexture + i) % textureCount].lock();
+			if (!pTexture)
+				continue;
+
+			// The first mip of a frame is always allowed, otherwise one oversized level would stall its texture forever
+			const VkDeviceSize allowance = m_UploadedBytes == 0 ? std::numeric_limits<VkDeviceSize>::max() : budget - m_UploadedBytes;
+			const VkDeviceSize uploadedBytes = pTexture->StreamNextMip(batch, allowance);
+			m_UploadedBytes += uploadedBytes;
+			uploaded |= uploadedBytes > 0;
+		}
+	}
+	m_NextTexture = (m_NextTexture + 1) % textureCount;
+	transferQueue.Submit(std::move(batch));
+}
+
+size_t TextureStreamer::GetPendingTextureCount() const
+{
+	return std::count_if(m_vTextures.begin(), m_vTextures.end(), [](const std::weak_ptr<StreamedTexture>& pWeakTexture)
+		{
+			const std::shared_ptr<StreamedTexture> pTexture = pWeakTexture.lock();
+			return pTexture && !pTexture->IsFullyResident();
+		});
+}
+
+void TextureStreamer::Cleanup()
+{
+	m_vTextures.clear();
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <vector>
+#include <string>
+#include <memory>
+#include <future>
+#include "vulkanbase/VulkanUtil.h"
+#include "TransferQueue.h"
+#include "Texture.h"
+#include "ResidencyManager.h"
+
+//-----------------------------------------------------
+// StreamedTexture Class
+//-----------------------------------------------------
+// Texture that is usable the moment it is constructed. Until real data arrives its view shows a one texel placeholder.
+// The file is decoded and its mip chain built on the thread pool, after which the TextureStreamer uploads
+// one mip at a time, smallest first. Every upload publishes a new view whose base level is the finest resident mip.
+// When memory runs low the residency manager can evict it back to the placeholder, it streams in again once drawn.
+class StreamedTexture final : public Texture, public Evictable
+{
+public:
+	StreamedTexture(const std::string& fileName, const VulkanContext& context);
+	~StreamedTexture() override;
+
+	// Adds the copy of the next missing mip to the batch when it is decoded and no larger than the budget
+	VkDeviceSize StreamNextMip(UploadBatch& batch, VkDeviceSize budget);
+
+	bool IsFullyResident() const { return m_ResidentMip == 0; }
+	uint32_t GetResidentMip() const { return m_ResidentMip; }
+	uint32_t GetMipLevelCount() const { return m_MipLevels; }
+
+	VkDeviceMemory GetEvictableMemory() const override { return m_TextureImageMemory; }
+	uint64_t GetLastUsedFrame() const override { return m_LastUsedFrame; }
+	void Evict(bool immediate) override;
+
+private:
+	void StartDecode();
+	void CreatePlaceholder();
+	void PublishView(uint32_t baseMip);
+
+	std::string m_FileName{};
+	uint32_t m_Width{ 0 };
+	uint32_t m_Height{ 0 };
+
+	VkImage m_PlaceholderImage{};
+	VkDeviceMemory m_PlaceholderMemory{};
+	VkImageView m_PlaceholderView{};
+
+	std::future<std::vector<TextureMipLevel>> m_DecodedMips{};
+	std::vector<TextureMipLevel> m_vMipLevels{};
+	uint32_t m_ResidentMip{ 0 };	// finest uploaded level, equal to the level count while only the placeholder is bound
+	uint64_t m_EvictedFrame{ 0 };
+};
+
+//-----------------------------------------------------
+// TextureStreamer Class
+//-----------------------------------------------------
+// Spreads the mip uploads of all streamed textures over frames so no frame copies more than its byte budget.
+// A single mip larger than the whole budget still goes through, alone in its frame.
+// Fully resident textures stay in the list, an eviction can make them stream again.
+class TextureStreamer final
+{
+public:
+	TextureStreamer() = default;
+	~TextureStreamer() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	TextureStreamer(const TextureStreamer& other)					= delete;
+	TextureStreamer(TextureStreamer&& other) noexcept				= delete;
+	TextureStreamer& operator=(const TextureStreamer& other)		= delete;
+	TextureStreamer& operator=(TextureStreamer&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	void Add(const std::shared_ptr<StreamedTexture>& pTexture) { m_vTextures.push_back(pTexture); }
+	// Submits this frame's mips as one transfer batch. The previous frame must have finished,
+	// its retired views are released here.
+	void Update(TransferQueue& transferQueue, VkDeviceSize budget);
+	void Cleanup();
+
+	VkDeviceSize GetUploadedBytes() const { return m_UploadedBytes; }
+	// Textures that still have mips to stream, either for the first time or after an eviction
+	size_t GetPendingTextureCount() const;
+
+private:
+	std::vector<std::weak_ptr<StreamedTexture>> m_vTextures{};
+	size_t m_NextTexture{ 0 };
+	VkDeviceSize m_UploadedBytes{ 0 };
+};
@@ -1,11 +1,40 @@
 #include "Texture.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
-#include "Buffer.h"
+#include <array>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "TransferQueue.h"
+#include "DeletionQueue.h"
+#include "AssetCache.h"
+
+namespace
+{
+	// Textures are sampled as sRGB, so mips are averaged in linear space to keep their brightness
+	const std::array<float, 256>& GetSrgbToLinearTable()
+	{
+		static const std::array<float, 256> table = []()
+			{
+				std::array<float, 256> values{};
+				for (size_t i{}; i < values.size(); ++i)
+				{
+					const float srgb = static_cast<float>(i) / 255.f;
+					values[i] = srgb <= 0.04045f ? srgb / 12.92f : glm::pow((srgb + 0.055f) / 1.055f, 2.4f);
+				}
+				return values;
+			}();
+		return table;
+	}
+
+	uint8_t LinearToSrgb(float linear)
+	{
+		const float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * glm::pow(linear, 1.f / 2.4f) - 0.055f;
+		return static_cast<uint8_t>(glm::clamp(srgb * 255.f + 0.5f, 0.f, 255.f));
+	}
+}
 
-Texture::Texture(const std::string& fileName, const VulkanContext& context, CommandPool& commandPool)
+Texture::Texture(const std::string& fileName, const VulkanContext& context)
 {
-	m_CommandPool = &commandPool;
 	m_Context = context;
 
 	CreateTextureImage(fileName);
@@ -13,12 +42,28 @@ Texture::Texture(const std::string& fileName, const VulkanContext& context, Comm
 	CreateTextureSampler();
 }
 
+Texture::Texture(const std::vector<TextureMipLevel>& vMipLevels, const VulkanContext& context)
+{
+	m_Context = context;
+	m_MipLevels = static_cast<uint32_t>(vMipLevels.size());
+
+	CreateTextureImage(vMipLevels);
+	CreateTextureImageView(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+	CreateTextureSampler();
+}
+
+Texture::Texture(const VulkanContext& context)
+{
+	m_Context = context;
+}
+
 Texture::~Texture()
 {
-	vkDestroyImageView(m_Context.device, m_TextureImageView, nullptr);
-	vkDestroyImage(m_Context.device, m_TextureImage, nullptr);
-	vkFreeMemory(m_Context.device, m_TextureImageMemory, nullptr);
-	vkDestroySampler(m_Context.device, m_TextureSampler, nullptr);
+	// The last reference may go mid-session, everything outlives the frames that could still sample it
+	DeletionQueue& deletionQueue = DeletionQueue::Get();
+	deletionQueue.Destroy(m_TextureImageView);
+	deletionQueue.Destroy(m_TextureImage);
+	deletionQueue.Free(m_TextureImageMemory);
 }
 
 void Texture::CreateTextureImage(const std::string& fileName)
@@ -31,20 +76,32 @@ void Texture::CreateTextureImage(const std::string& fileName)
 	if (!pixels)
 		throw std::runtime_error("failed to load texture image!");
 
-	auto stagingBuffer = std::make_unique<Buffer>(m_Context, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, imageSize);
+	CreateImage(texWidth, texHeight, m_MipLevels, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_TextureImage, m_TextureImageMemory);
 
-	void* data;
-	vkMapMemory(m_Context.device, stagingBuffer->GetVkBufferMemory(), 0, imageSize, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(imageSize));
-	vkUnmapMemory(m_Context.device, stagingBuffer->GetVkBufferMemory());
+	TransferQueue& transferQueue = *m_Context.pTransferQueue;
+	UploadBatch batch = transferQueue.Begin();
+	transferQueue.CopyToImage(batch, pixels, imageSize, m_TextureImage, 0, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+	transferQueue.Submit(std::move(batch));
 
 	stbi_image_free(pixels);
+}
 
-	CreateImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_TextureImage, m_TextureImageMemory);
+void Texture::CreateTextureImage(const std::vector<TextureMipLevel>& vMipLevels)
+{
+	if (vMipLevels.empty())
+		throw std::runtime_error("texture needs at least one mip level!");
+
+	CreateImage(vMipLevels[0].width, vMipLevels[0].height, m_MipLevels, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_TextureImage, m_TextureImageMemory);
 
-	TransitionImageLayout(m_TextureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	CopyBufferToImage(stagingBuffer->GetVkBuffer(), m_TextureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-	TransitionImageLayout(m_TextureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	// All levels go out in one batch, the frame that first samples the texture waits for it
+	TransferQueue& transferQueue = *m_Context.pTransferQueue;
+	UploadBatch batch = transferQueue.Begin();
+	for (uint32_t level = 0; level < m_MipLevels; ++level)
+	{
+		const TextureMipLevel& mipLevel = vMipLevels[level];
+		transferQueue.CopyToImage(batch, mipLevel.pixels.data(), mipLevel.pixels.size(), m_TextureImage, level, mipLevel.width, mipLevel.height);
+	}
+	transferQueue.Submit(std::move(batch));
 }
 
 void Texture::CreateTextureImageView(VkFormat format, VkImageAspectFlags aspectFlags)
@@ -56,7 +113,7 @@ void Texture::CreateTextureImageView(VkFormat format, VkImageAspectFlags aspectF
 	viewInfo.format = format;
 	viewInfo.subresourceRange.aspectMask = aspectFlags;
 	viewInfo.subresourceRange.baseMipLevel = 0;
-	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.levelCount = m_MipLevels;
 	viewInfo.subresourceRange.baseArrayLayer = 0;
 	viewInfo.subresourceRange.layerCount = 1;
 
@@ -83,47 +140,13 @@ void Texture::CreateTextureSampler()
 	samplerInfo.compareEnable = VK_FALSE;
 	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
 	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.minLod = 0.f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
-	if (vkCreateSampler(m_Context.device, &samplerInfo, nullptr, &m_TextureSampler) != VK_SUCCESS)
-		throw std::runtime_error("failed to create texture sampler!");
-}
-
-VkCommandBuffer Texture::BeginSingleTimeCommands()
-{
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = m_CommandPool->GetCommandPool();
-	allocInfo.commandBufferCount = 1;
-
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(m_Context.device, &allocInfo, &commandBuffer);
-
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-	return commandBuffer;
+	m_pSampler = m_Context.pAssetCache->GetSampler(samplerInfo);
 }
 
-void Texture::EndSingleTimeCommands(VkCommandBuffer commandBuffer)
-{
-	vkEndCommandBuffer(commandBuffer);
-
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	vkQueueSubmit(m_Context.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(m_Context.graphicsQueue);
-
-	vkFreeCommandBuffers(m_Context.device, m_CommandPool->GetCommandPool(), 1, &commandBuffer);
-}
-
-void Texture::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
+void Texture::CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
 {
 	VkImageCreateInfo imageInfo{};
 	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -131,7 +154,7 @@ void Texture::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkIm
 	imageInfo.extent.width = width;
 	imageInfo.extent.height = height;
 	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = 1;
+	imageInfo.mipLevels = mipLevels;
 	imageInfo.arrayLayers = 1;
 	imageInfo.format = format;
 	imageInfo.tiling = tiling;
@@ -151,98 +174,12 @@ void Texture::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkIm
 	allocInfo.allocationSize = memRequirements.size;
 	allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties);
 
-	if (vkAllocateMemory(m_Context.device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
+	if (ResidencyManager::Get().Allocate(m_Context.device, allocInfo, imageMemory) != VK_SUCCESS)
 		throw std::runtime_error("failed to allocate image memory!");
 
 	vkBindImageMemory(m_Context.device, image, imageMemory, 0);
 }
 
-void Texture::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
-{
-	VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
-
-	VkBufferCopy copyRegion{};
-	copyRegion.size = size;
-	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-	EndSingleTimeCommands(commandBuffer);
-}
-
-void Texture::TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
-{
-	VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
-
-	VkImageMemoryBarrier barrier{};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.oldLayout = oldLayout;
-	barrier.newLayout = newLayout;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.image = image;
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = 1;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
-
-	VkPipelineStageFlags sourceStage;
-	VkPipelineStageFlags destinationStage;
-
-	if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-	{
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-	{
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	}
-	else
-		throw std::invalid_argument("unsupported layout transition!");
-
-	vkCmdPipelineBarrier(
-		commandBuffer,
-		sourceStage, destinationStage,
-		0,
-		0, nullptr,
-		0, nullptr,
-		1, &barrier
-	);
-
-	EndSingleTimeCommands(commandBuffer);
-}
-
-void Texture::CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
-{
-	VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
-
-	VkBufferImageCopy region{};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
-	region.imageOffset = { 0, 0, 0 };
-	region.imageExtent = {
-		width,
-		height,
-		1
-	};
-
-	vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-	EndSingleTimeCommands(commandBuffer);
-}
-
 uint32_t Texture::FindMemoryType(uint32_t typeFilter, const VkMemoryPropertyFlags& properties) const
 {
 	VkPhysicalDeviceMemoryProperties memProperties;
@@ -256,3 +193,45 @@ uint32_t Texture::FindMemoryType(uint32_t typeFilter, const VkMemoryPropertyFlag
 
 	throw std::runtime_error("failed to find suitable memory type!");
 }
+
+void Texture::GenerateMipLevels(std::vector<TextureMipLevel>& vMipLevels, uint32_t mipLevelCount)
+{
+	const std::array<float, 256>& toLinear = GetSrgbToLinearTable();
+
+	while (!vMipLevels.empty() && vMipLevels.size() < mipLevelCount)
+	{
+		const TextureMipLevel& source = vMipLevels.back();
+		TextureMipLevel target{ std::max(source.width / 2, 1u), std::max(source.height / 2, 1u) };
+		target.pixels.resize(static_cast<size_t>(target.width) * target.height * 4);
+
+		// Each target texel averages its 2x2 footprint, less where the source is one texel wide. The last row or
+		// column of a target also takes an odd source's last one along, so no edge texels are dropped.
+		for (uint32_t y = 0; y < target.height; ++y)
+			for (uint32_t x = 0; x < target.width; ++x)
+			{
+				const uint32_t firstRow = std::min(y * 2, source.height - 1);
+				const uint32_t lastRow = y + 1 == target.height ? source.height - 1 : y * 2 + 1;
+				const uint32_t firstColumn = std::min(x * 2, source.width - 1);
+				const uint32_t lastColumn = x + 1 == target.width ? source.width - 1 : x * 2 + 1;
+
+				std::array<float, 3> sum{};
+				uint32_t alphaSum{ 0 };
+				for (uint32_t row = firstRow; row <= lastRow; ++row)
+					for (uint32_t column = firstColumn; column <= lastColumn; ++column)
+					{
+						const uint8_t* pSource = &source.pixels[(static_cast<size_t>(row) * source.width + column) * 4];
+						for (size_t channel{}; channel < 3; ++channel)
+							sum[channel] += toLinear[pSource[channel]];
+						alphaSum += pSource[3];
+					}
+
+				const uint32_t texelCount = (lastRow - firstRow + 1) * (lastColumn - firstColumn + 1);
+				uint8_t* pTarget = &target.pixels[(static_cast<size_t>(y) * target.width + x) * 4];
+				for (size_t channel{}; channel < 3; ++channel)
+					pTarget[channel] = LinearToSrgb(sum[channel] / texelCount);
+				pTarget[3] = static_cast<uint8_t>((alphaSum + texelCount / 2) / texelCount);
+			}
+
+		vMipLevels.push_back(std::move(target));
+	}
+}
@@ -1,35 +1,60 @@
 #pragma once
 #include <vulkan/vulkan_core.h>
+#include <memory>
 #include "vulkanbase/VulkanUtil.h"
-#include "CommandPool.h"
+#include "ResidencyManager.h"
+#include "Sampler.h"
 
-class Texture final
+// Tightly packed RGBA8 pixels of one mip level
+struct TextureMipLevel
+{
+	uint32_t width{ 0 };
+	uint32_t height{ 0 };
+	std::vector<uint8_t> pixels{};
+};
+
+class Texture
 {
 public:
-	Texture(const std::string& fileName, const VulkanContext& context, CommandPool& commandPool);
-	~Texture();
+	Texture(const std::string& fileName, const VulkanContext& context);
+	// Uploads a prebuilt mip chain, level 0 first
+	Texture(const std::vector<TextureMipLevel>& vMipLevels, const VulkanContext& context);
+	virtual ~Texture();
+
+	Texture(const Texture& other) = delete;
+	Texture(Texture&& other) noexcept = delete;
+	Texture& operator=(const Texture& other) = delete;
+	Texture& operator=(Texture&& other) noexcept = delete;
 
 	VkImage GetTextureImage() const { return m_TextureImage; }
 	VkImageView GetTextureImageView() const { return m_TextureImageView; }
-	VkSampler GetTextureSampler() const { return m_TextureSampler; }
-private:
+	VkSampler GetTextureSampler() const { return m_pSampler->GetVkSampler(); }
+	// Goes up whenever the image view gets replaced, descriptors that cached the old view have to be rewritten
+	uint32_t GetViewVersion() const { return m_ViewVersion; }
+	// Called for every texture a frame draws with, eviction goes least recently used first
+	void MarkUsed() const { m_LastUsedFrame = ResidencyManager::Get().GetFrameIndex(); }
+
+	// Appends levels to the chain until it has mipLevelCount of them, each a 2x2 box filter of the previous one in linear space
+	static void GenerateMipLevels(std::vector<TextureMipLevel>& vMipLevels, uint32_t mipLevelCount);
+protected:
+	// Leaves image, view and sampler to the derived class
+	Texture(const VulkanContext& context);
+
 	void CreateTextureImage(const std::string& fileName);
+	void CreateTextureImage(const std::vector<TextureMipLevel>& vMipLevels);
 	void CreateTextureImageView(VkFormat format, VkImageAspectFlags aspectFlags);
+	// Every texture shares the same sampler from the asset cache, the views limit the mips instead of the sampler
 	void CreateTextureSampler();
 
-	VkCommandBuffer BeginSingleTimeCommands();
-	void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
-
-	void CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
-	void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-	void TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-	void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+	void CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
 	uint32_t FindMemoryType(uint32_t typeFilter, const VkMemoryPropertyFlags& properties) const;
 
 	VkImage m_TextureImage{};
 	VkDeviceMemory m_TextureImageMemory{};
 	VkImageView m_TextureImageView{};
-	VkSampler m_TextureSampler{};
-	CommandPool* m_CommandPool{};
+	std::shared_ptr<Sampler> m_pSampler{};
+	uint32_t m_MipLevels{ 1 };
+	uint32_t m_ViewVersion{ 0 };
+	mutable uint64_t m_LastUsedFrame{ 0 };
 	VulkanContext m_Context{};
 };			
\ No newline at end of file
@@ -0,0 +1,144 @@
+
+//---------------------------
+// Includes
+//---------------------------
+#include "TextureAtlas.h"
+#include <stb_image.h>
+#include <algorithm>
+#include <bit>
+#include <numeric>
+#include <stdexcept>
+
+namespace
+{
+	uint32_t AlignUp(uint32_t value, uint32_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+//---------------------------
+// Member functions
+//---------------------------
+
+uint32_t TextureAtlas::AddImage(const std::string& fileName)
+{
+	int width, height, channels;
+	const std::string filePath = "resources/" + fileName;
+	stbi_uc* pixels = stbi_load(filePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!pixels)
+		throw std::runtime_error("failed to load texture atlas image " + fileName + "!");
+
+	TextureMipLevel image{};
+	image.width = static_cast<uint32_t>(width);
+	image.height = static_cast<uint32_t>(height);
+	image.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+	stbi_image_free(pixels);
+
+	m_vImages.push_back(std::move(image));
+	return static_cast<uint32_t>(m_vImages.size() - 1);
+}
+
+void TextureAtlas::Build(uint32_t padding)
+{
+	if (m_vImages.empty())
+		throw std::runtime_error("texture atlas has no images!");
+
+	// Every level halves the gutter, stop at the level where it is one texel wide.
+	// Cells start and end on multiples of the last level's texel size so no texel of any level straddles two cells.
+	const uint32_t mipLevelCount = padding > 0 ? static_cast<uint32_t>(std::bit_width(padding)) : 1;
+	const uint32_t alignment = 1u << (mipLevelCount - 1);
+
+	uint64_t totalArea{ 0 };
+	uint32_t largestSide{ alignment };
+	for (const TextureMipLevel& image : m_vImages)
+	{
+		const uint32_t cellWidth = AlignUp(image.width + 2 * padding, alignment);
+		const uint32_t cellHeight = AlignUp(image.height + 2 * padding, alignment);
+		totalArea += static_cast<uint64_t>(cellWidth) * cellHeight;
+		largestSide = std::max({ largestSide, cellWidth, cellHeight });
+	}
+
+	uint32_t atlasSize = std::bit_ceil(std::max(largestSide, static_cast<uint32_t>(glm::sqrt(static_cast<double>(totalArea)))));
+	std::vector<CellPlacement> vPlacements{};
+	for (;; atlasSize *= 2)
+	{
+		if (atlasSize > maxAtlasSize)
+			throw std::runtime_error("texture atlas images do not fit in the maximum atlas size!");
+		if (Pack(atlasSize, padding, alignment, vPlacements))
+			break;
+	}
+
+	m_vMipLevels.clear();
+	m_vMipLevels.push_back(TextureMipLevel{ atlasSize, atlasSize, std::vector<uint8_t>(static_cast<size_t>(atlasSize) * atlasSize * 4, 0) });
+	Compose(padding, alignment, vPlacements);
+	// The cell alignment guarantees the box filter never mixes texels of two cells
+	Texture::GenerateMipLevels(m_vMipLevels, mipLevelCount);
+}
+
+std::shared_ptr<Texture> TextureAtlas::CreateTexture(const VulkanContext& context) const
+{
+	if (m_vMipLevels.empty())
+		throw std::runtime_error("texture atlas has not been built!");
+	return std::make_shared<Texture>(m_vMipLevels, context);
+}
+
+bool TextureAtlas::Pack(uint32_t atlasSize, uint32_t padding, uint32_t alignment, std::vector<CellPlacement>& vPlacements) const
+{
+	// Shelf packing, tallest cells first so every shelf wastes little height
+	std::vector<uint32_t> vOrder(m_vImages.size());
+	std::iota(vOrder.begin(), vOrder.end(), 0);
+	std::stable_sort(vOrder.begin(), vOrder.end(), [this](uint32_t a, uint32_t b) { return m_vImages[a].height > m_vImages[b].height; });
+
+	vPlacements.assign(m_vImages.size(), CellPlacement{});
+	uint32_t x{ 0 }, y{ 0 }, shelfHeight{ 0 };
+	for (uint32_t imageIndex : vOrder)
+	{
+		const uint32_t cellWidth = AlignUp(m_vImages[imageIndex].width + 2 * padding, alignment);
+		const uint32_t cellHeight = AlignUp(m_vImages[imageIndex].height + 2 * padding, alignment);
+		if (x + cellWidth > atlasSize)
+		{
+			y += shelfHeight;
+			x = 0;
+			shelfHeight = 0;
+		}
+		if (cellWidth > atlasSize || y + cellHeight > atlasSize)
+			return false;
+
+		vPlacements[imageIndex] = CellPlacement{ x, y };
+		x += cellWidth;
+		shelfHeight = std::max(shelfHeight, cellHeight);
+	}
+	return true;
+}
+
+void TextureAtlas::Compose(uint32_t padding, uint32_t alignment, const std::vector<CellPlacement>& vPlacements)
+{
+	TextureMipLevel& atlas = m_vMipLevels[0];
+	const float atlasSize = static_cast<float>(atlas.width);
+
+	m_vCellRects.resize(m_vImages.size());
+	for (size_t i{}; i < m_vImages.size(); ++i)
+	{
+		const TextureMipLevel& image = m_vImages[i];
+		const CellPlacement& placement = vPlacements[i];
+		const uint32_t cellWidth = AlignUp(image.width + 2 * padding, alignment);
+		const uint32_t cellHeight = AlignUp(image.height + 2 * padding, alignment);
+
+		// The gutter, including the alignment slack, repeats the closest edge texel of the image
+		for (uint32_t cellY = 0; cellY < cellHeight; ++cellY)
+		{
+			const uint32_t sourceY = std::min(static_cast<uint32_t>(std::max(static_cast<int>(cellY) - static_cast<int>(padding), 0)), image.height - 1);
+			for (uint32_t cellX = 0; cellX < cellWidth; ++cellX)
+			{
+				const uint32_t sourceX = std::min(static_cast<uint32_t>(std::max(static_cast<int>(cellX) - static_cast<int>(padding), 0)), image.width - 1);
+				const uint8_t* pSource = &image.pixels[(static_cast<size_t>(sourceY) * image.width + sourceX) * 4];
+				uint8_t* pTarget = &atlas.pixels[(static_cast<size_t>(placement.y + cellY) * atlas.width + placement.x + cellX) * 4];
+				std::copy(pSource, pSource + 4, pTarget);
+			}
+		}
+
+		m_vCellRects[i] = glm::vec4{ (placement.x + padding) / atlasSize, (placement.y + padding) / atlasSize,
+			image.width / atlasSize, image.height / atlasSize };
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <vector>
+#include <string>
+#include <memory>
+#include <glm/glm.hpp>
+#include "vulkanbase/VulkanUtil.h"
+#include "Texture.h"
+
+//-----------------------------------------------------
+// TextureAtlas Class
+//-----------------------------------------------------
+// Packs many images into one power of two texture. Every cell is surrounded by a gutter of replicated
+// edge pixels and aligned so it stays on whole texels down to the last mip level, where the gutter is one texel wide.
+// That way linear filtering of any mip never bleeds a neighbouring cell into a cell's UV range.
+class TextureAtlas final
+{
+public:
+	static constexpr uint32_t maxAtlasSize{ 8192 };
+
+	TextureAtlas() = default;
+	~TextureAtlas() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	TextureAtlas(const TextureAtlas& other)					= delete;
+	TextureAtlas(TextureAtlas&& other) noexcept				= delete;
+	TextureAtlas& operator=(const TextureAtlas& other)		= delete;
+	TextureAtlas& operator=(TextureAtlas&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	// Loads from the resources folder like Texture does, returns the cell index of the image
+	uint32_t AddImage(const std::string& fileName);
+
+	// The padding is the gutter in texels at level 0, it also decides the mip count: log2(padding) + 1
+	void Build(uint32_t padding = 4);
+	std::shared_ptr<Texture> CreateTexture(const VulkanContext& context) const;
+
+	// xy: uv offset, zw: uv scale of the cell, without its gutter
+	const glm::vec4& GetCellRect(uint32_t cellIndex) const { return m_vCellRects[cellIndex]; }
+	const std::vector<glm::vec4>& GetCellRects() const { return m_vCellRects; }
+	uint32_t GetCellCount() const { return static_cast<uint32_t>(m_vImages.size()); }
+
+private:
+	struct CellPlacement
+	{
+		uint32_t x{ 0 };
+		uint32_t y{ 0 };
+	};
+
+	bool Pack(uint32_t atlasSize, uint32_t padding, uint32_t alignment, std::vector<CellPlacement>& vPlacements) const;
+	void Compose(uint32_t padding, uint32_t alignment, const std::vector<CellPlacement>& vPlacements);
+
+	std::vector<TextureMipLevel> m_vImages{};
+	std::vector<TextureMipLevel> m_vMipLevels{};
+	std::vector<glm::vec4> m_vCellRects{};
+};
@@ -0,0 +1,117 @@
+
+//---------------------------
+// Includes
+//---------------------------
+#include "ThreadPool.h"
+#include <algorithm>
+
+//---------------------------
+// Member functions
+//---------------------------
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+	threadCount = std::max(threadCount, 1u);
+	for (uint32_t i{}; i < threadCount; ++i)
+		m_vWorkers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_Stopping = true;
+	}
+	m_Condition.notify_all();
+	for (std::thread& worker : m_vWorkers)
+		worker.join();
+}
+
+ThreadPool& ThreadPool::Get()
+{
+	static ThreadPool threadPool{};
+	return threadPool;
+}
+
+void ThreadPool::ParallelFor(uint32_t taskCount, const std::function<void(uint32_t)>& func)
+{
+	if (taskCount == 0)
+		return;
+
+	// Helpers that only get scheduled after all work is done must not touch this stack frame,
+	// so the shared counters live on the heap.
+	struct SharedState
+	{
+		std::atomic<uint32_t> nextTask{ 0 };
+		std::atomic<uint32_t> finishedTasks{ 0 };
+		std::atomic<bool> failed{ false };
+		std::exception_ptr pException{};	// the first one thrown, written once by whoever set failed
+		std::mutex doneMutex{};
+		std::condition_variable doneCondition{};
+	};
+	auto pState = std::make_shared<SharedState>();
+	const std::function<void(uint32_t)>* pFunc = &func;
+
+	auto runTasks = [pState, pFunc, taskCount]()
+	{
+		for (uint32_t task = pState->nextTask++; task < taskCount; task = pState->nextTask++)
+		{
+			// A throwing task still counts as finished, otherwise the caller would wait forever.
+			// Once one has thrown the rest are skipped, the caller rethrows after every task is accounted for.
+			if (!pState->failed.load(std::memory_order_relaxed))
+			{
+				try
+				{
+					(*pFunc)(task);
+				}
+				catch (...)
+				{
+					if (!pState->failed.exchange(true))
+						pState->pException = std::current_exception();
+				}
+			}
+			if (++pState->finishedTasks == taskCount)
+			{
+				std::lock_guard lock{ pState->doneMutex };
+				pState->doneCondition.notify_all();
+			}
+		}
+	};
+
+	const uint32_t helperCount = std::min(taskCount - 1, GetThreadCount());
+	{
+		std::lock_guard lock{ m_Mutex };
+		for (uint32_t i{}; i < helperCount; ++i)
+			m_Tasks.emplace(runTasks);
+	}
+	m_Condition.notify_all();
+
+	runTasks();
+
+	{
+		std::unique_lock lock{ pState->doneMutex };
+		pState->doneCondition.wait(lock, [&]() { return pState->finishedTasks == taskCount; });
+	}
+
+	// The finished count was raised after the exception was stored, so it is visible here
+	if (pState->pException)
+		std::rethrow_exception(pState->pException);
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock lock{ m_Mutex };
+			m_Condition.wait(lock, [this]() { return m_Stopping || !m_Tasks.empty(); });
+			if (m_Stopping && m_Tasks.empty())
+				return;
+
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop();
+		}
+		task();
+	}
+}
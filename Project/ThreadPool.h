@@ -0,0 +1,69 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+
+//-----------------------------------------------------
+// ThreadPool Class
+//-----------------------------------------------------
+class ThreadPool final
+{
+public:
+	explicit ThreadPool(uint32_t threadCount = std::thread::hardware_concurrency());
+	~ThreadPool();
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	ThreadPool(const ThreadPool& other)					= delete;
+	ThreadPool(ThreadPool&& other) noexcept				= delete;
+	ThreadPool& operator=(const ThreadPool& other)		= delete;
+	ThreadPool& operator=(ThreadPool&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	static ThreadPool& Get();
+
+	template<typename Func>
+	std::future<std::invoke_result_t<Func>> Enqueue(Func&& func);
+
+	// Calls func(taskIndex) for every index in [0, taskCount) and blocks until all of them are done.
+	// The calling thread helps out, so this is safe to call from inside a task.
+	// The first exception a task throws is rethrown here once every task has finished or been skipped.
+	void ParallelFor(uint32_t taskCount, const std::function<void(uint32_t)>& func);
+
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_vWorkers.size()); }
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> m_vWorkers{};
+	std::queue<std::function<void()>> m_Tasks{};
+	std::mutex m_Mutex{};
+	std::condition_variable m_Condition{};
+	bool m_Stopping{ false };
+};
+
+template<typename Func>
+inline std::future<std::invoke_result_t<Func>> ThreadPool::Enqueue(Func&& func)
+{
+	using Result = std::invoke_result_t<Func>;
+	auto pTask = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+	std::future<Result> result = pTask->get_future();
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_Tasks.emplace([pTask]() { (*pTask)(); });
+	}
+	m_Condition.notify_one();
+	return result;
+}
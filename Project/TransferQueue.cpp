@@ -0,0 +1,254 @@
+//---------------------------
+// Includes
+//---------------------------
+#include "TransferQueue.h"
+#include <algorithm>
+#include <stdexcept>
+
+//---------------------------
+// Member functions
+//---------------------------
+
+void TransferQueue::Initialize(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, uint32_t queueFamily, uint32_t graphicsFamily, bool timelineSemaphores)
+{
+	m_PhysicalDevice = physicalDevice;
+	m_Device = device;
+	m_Queue = queue;
+	m_QueueFamily = queueFamily;
+	m_GraphicsFamily = graphicsFamily;
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = queueFamily;
+
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &m_CommandPool) != VK_SUCCESS)
+		throw std::runtime_error("failed to create transfer command pool!");
+
+	if (!timelineSemaphores)
+		return;
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &m_TimelineSemaphore) != VK_SUCCESS)
+		throw std::runtime_error("failed to create transfer timeline semaphore!");
+}
+
+void TransferQueue::Cleanup()
+{
+	vkQueueWaitIdle(m_Queue);
+	for (PendingBatch& batch : m_vPendingBatches)
+		FreeBatch(batch.commandBuffer, batch.vStagingBuffers);
+	m_vPendingBatches.clear();
+
+	vkDestroySemaphore(m_Device, m_TimelineSemaphore, nullptr);
+	vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
+}
+
+UploadBatch TransferQueue::Begin()
+{
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = m_CommandPool;
+	allocInfo.commandBufferCount = 1;
+
+	UploadBatch batch{};
+	if (vkAllocateCommandBuffers(m_Device, &allocInfo, &batch.commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate transfer command buffer!");
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+
+	return batch;
+}
+
+void TransferQueue::CopyToBuffer(UploadBatch& batch, const void* pData, VkDeviceSize size, VkBuffer buffer, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage)
+{
+	const Buffer& stagingBuffer = Stage(batch, pData, size);
+
+	VkBufferCopy copyRegion{};
+	copyRegion.size = size;
+	vkCmdCopyBuffer(batch.commandBuffer, stagingBuffer.GetVkBuffer(), buffer, 1, &copyRegion);
+
+	VkBufferMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = dstAccess;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = buffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	if (!IsDedicated())
+	{
+		vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+		return;
+	}
+
+	// Release: the destination access is the acquiring queue's business
+	barrier.srcQueueFamilyIndex = m_QueueFamily;
+	barrier.dstQueueFamilyIndex = m_GraphicsFamily;
+	barrier.dstAccessMask = 0;
+	vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = dstAccess;
+	m_vBufferAcquires.push_back(barrier);
+	m_AcquireStages |= dstStage;
+}
+
+void TransferQueue::CopyToImage(UploadBatch& batch, const void* pData, VkDeviceSize size, VkImage image, uint32_t mipLevel, uint32_t width, uint32_t height)
+{
+	const Buffer& stagingBuffer = Stage(batch, pData, size);
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = mipLevel;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region{};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = mipLevel;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { width, height, 1 };
+	vkCmdCopyBufferToImage(batch.commandBuffer, stagingBuffer.GetVkBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	// Release and acquire both carry the layout transition, it happens once in between
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	if (!IsDedicated())
+	{
+		vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		return;
+	}
+
+	barrier.srcQueueFamilyIndex = m_QueueFamily;
+	barrier.dstQueueFamilyIndex = m_GraphicsFamily;
+	barrier.dstAccessMask = 0;
+	vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	m_vImageAcquires.push_back(barrier);
+	m_AcquireStages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+}
+
+uint64_t TransferQueue::Submit(UploadBatch&& batch)
+{
+	vkEndCommandBuffer(batch.commandBuffer);
+	if (batch.vStagingBuffers.empty())
+	{
+		FreeBatch(batch.commandBuffer, batch.vStagingBuffers);
+		return 0;
+	}
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+	if (m_TimelineSemaphore == VK_NULL_HANDLE)
+	{
+		vkQueueSubmit(m_Queue, 1, &submitInfo, VK_NULL_HANDLE);
+		vkQueueWaitIdle(m_Queue);
+		FreeBatch(batch.commandBuffer, batch.vStagingBuffers);
+		return 0;
+	}
+
+	const uint64_t value = ++m_SubmittedValue;
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &value;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &m_TimelineSemaphore;
+
+	if (vkQueueSubmit(m_Queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		throw std::runtime_error("failed to submit transfer command buffer!");
+
+	m_vPendingBatches.push_back(PendingBatch{ value, batch.commandBuffer, std::move(batch.vStagingBuffers) });
+	// On the graphics queue itself submission order already does the waiting
+	if (IsDedicated())
+		m_AcquireValue = value;
+	return value;
+}
+
+uint64_t TransferQueue::RecordAcquires(VkCommandBuffer commandBuffer)
+{
+	// The frame waits on the timeline at the transfer stage, so that is where the acquires start
+	if (!m_vBufferAcquires.empty() || !m_vImageAcquires.empty())
+	{
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, m_AcquireStages, 0,
+			0, nullptr,
+			static_cast<uint32_t>(m_vBufferAcquires.size()), m_vBufferAcquires.data(),
+			static_cast<uint32_t>(m_vImageAcquires.size()), m_vImageAcquires.data());
+	}
+	m_vBufferAcquires.clear();
+	m_vImageAcquires.clear();
+	m_AcquireStages = 0;
+
+	const uint64_t value = m_AcquireValue;
+	m_AcquireValue = 0;
+	return value;
+}
+
+void TransferQueue::CollectFinished()
+{
+	if (m_vPendingBatches.empty())
+		return;
+
+	uint64_t completedValue{ 0 };
+	vkGetSemaphoreCounterValue(m_Device, m_TimelineSemaphore, &completedValue);
+
+	// Values are signalled in submission order, so finished batches are always at the front
+	auto firstPending = std::find_if(m_vPendingBatches.begin(), m_vPendingBatches.end(), [completedValue](const PendingBatch& batch) { return batch.value > completedValue; });
+	for (auto it = m_vPendingBatches.begin(); it != firstPending; ++it)
+		FreeBatch(it->commandBuffer, it->vStagingBuffers);
+	m_vPendingBatches.erase(m_vPendingBatches.begin(), firstPending);
+}
+
+Buffer& TransferQueue::Stage(UploadBatch& batch, const void* pData, VkDeviceSize size)
+{
+	auto stagingBuffer = std::make_unique<Buffer>(m_PhysicalDevice, m_Device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, size);
+	stagingBuffer->Map();
+	stagingBuffer->Upload(pData, 0, size);
+	batch.vStagingBuffers.push_back(std::move(stagingBuffer));
+	return *batch.vStagingBuffers.back();
+}
+
+void TransferQueue::FreeBatch(VkCommandBuffer commandBuffer, std::vector<std::unique_ptr<Buffer>>& vStagingBuffers)
+{
+	vkFreeCommandBuffers(m_Device, m_CommandPool, 1, &commandBuffer);
+	vStagingBuffers.clear();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <vector>
+#include <memory>
+#include "vulkanbase/VulkanUtil.h"
+#include "Buffer.h"
+
+// Copies recorded together and submitted at once, the staging buffers live until the GPU is done with them
+struct UploadBatch
+{
+	VkCommandBuffer commandBuffer{};
+	std::vector<std::unique_ptr<Buffer>> vStagingBuffers{};
+};
+
+//-----------------------------------------------------
+// TransferQueue Class
+//-----------------------------------------------------
+// Runs asset uploads on a transfer only queue family when the device has one, so they overlap rendering.
+// Every written buffer or image is released to the graphics family at the end of its batch, the matching
+// acquire barriers are recorded into the frame's command buffer, which waits on the batch's timeline value.
+// Without a dedicated family the graphics queue is used and plain barriers suffice, without timeline
+// semaphores every batch is waited on right after its submit.
+class TransferQueue final
+{
+public:
+	TransferQueue() = default;
+	~TransferQueue() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	TransferQueue(const TransferQueue& other)					= delete;
+	TransferQueue(TransferQueue&& other) noexcept				= delete;
+	TransferQueue& operator=(const TransferQueue& other)		= delete;
+	TransferQueue& operator=(TransferQueue&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	void Initialize(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, uint32_t queueFamily, uint32_t graphicsFamily, bool timelineSemaphores);
+	void Cleanup();
+
+	UploadBatch Begin();
+	// Stage the data and record the copy plus the release to the graphics family
+	void CopyToBuffer(UploadBatch& batch, const void* pData, VkDeviceSize size, VkBuffer buffer, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage);
+	// The level is discarded first and ends up in shader read only layout for the fragment shader
+	void CopyToImage(UploadBatch& batch, const void* pData, VkDeviceSize size, VkImage image, uint32_t mipLevel, uint32_t width, uint32_t height);
+	// Returns the timeline value the batch signals, an empty batch is dropped without a submit
+	uint64_t Submit(UploadBatch&& batch);
+
+	// Graphics side, once per frame after the last upload and before the first draw.
+	// Returns the timeline value the frame has to wait for at the transfer stage, 0 when it does not have to wait.
+	uint64_t RecordAcquires(VkCommandBuffer commandBuffer);
+	// Frees the command and staging buffers of batches the GPU finished
+	void CollectFinished();
+
+	bool IsDedicated() const { return m_QueueFamily != m_GraphicsFamily; }
+	VkSemaphore GetTimelineSemaphore() const { return m_TimelineSemaphore; }
+
+private:
+	struct PendingBatch
+	{
+		uint64_t value{ 0 };
+		VkCommandBuffer commandBuffer{};
+		std::vector<std::unique_ptr<Buffer>> vStagingBuffers{};
+	};
+
+	Buffer& Stage(UploadBatch& batch, const void* pData, VkDeviceSize size);
+	void FreeBatch(VkCommandBuffer commandBuffer, std::vector<std::unique_ptr<Buffer>>& vStagingBuffers);
+
+	VkPhysicalDevice m_PhysicalDevice{};
+	VkDevice m_Device{};
+	VkQueue m_Queue{};
+	uint32_t m_QueueFamily{ 0 };
+	uint32_t m_GraphicsFamily{ 0 };
+	VkCommandPool m_CommandPool{};
+
+	VkSemaphore m_TimelineSemaphore{};
+	uint64_t m_SubmittedValue{ 0 };
+	std::vector<PendingBatch> m_vPendingBatches{};
+
+	// Acquire halves of the releases recorded since the last frame
+	std::vector<VkBufferMemoryBarrier> m_vBufferAcquires{};
+	std::vector<VkImageMemoryBarrier> m_vImageAcquires{};
+	VkPipelineStageFlags m_AcquireStages{ 0 };
+	uint64_t m_AcquireValue{ 0 };
+};
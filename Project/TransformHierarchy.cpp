@@ -0,0 +1,177 @@
+
+//---------------------------
+// Includes
+//---------------------------
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <stdexcept>
+
+//---------------------------
+// Member functions
+//---------------------------
+
+uint32_t TransformHierarchy::CreateNode(uint32_t parent, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	const uint32_t node = GetNodeCount();
+	if (parent != invalidNode && parent >= node)
+		throw std::invalid_argument("parent transform has to be created before its children!");
+
+	m_vParents.push_back(parent);
+	m_vPositions.push_back(position);
+	m_vRotations.push_back(rotation);
+	m_vScales.push_back(scale);
+	m_vWorldMatrices.emplace_back(1.f);
+	m_vDirty.push_back(0);
+
+	MarkDirty(node);
+	return node;
+}
+
+void TransformHierarchy::SetLocalPosition(uint32_t node, const glm::vec3& position)
+{
+	m_vPositions[node] = position;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::SetLocalRotation(uint32_t node, const glm::quat& rotation)
+{
+	m_vRotations[node] = rotation;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::SetLocalScale(uint32_t node, const glm::vec3& scale)
+{
+	m_vScales[node] = scale;
+	MarkDirty(node);
+}
+
+uint32_t TransformHierarchy::Update()
+{
+	if (m_FirstDirty == invalidNode)
+		return 0;
+
+	uint32_t updatedCount{ 0 };
+	const uint32_t nodeCount = GetNodeCount();
+	for (uint32_t node = m_FirstDirty; node < nodeCount; ++node)
+	{
+		const uint32_t parent = m_vParents[node];
+		if (parent != invalidNode && m_vDirty[parent])
+			m_vDirty[node] = 1;
+
+		if (!m_vDirty[node])
+			continue;
+
+		const glm::mat3 rotation = glm::mat3_cast(m_vRotations[node]);
+		glm::mat4 local{ 1.f };
+		local[0] = glm::vec4(rotation[0] * m_vScales[node].x, 0.f);
+		local[1] = glm::vec4(rotation[1] * m_vScales[node].y, 0.f);
+		local[2] = glm::vec4(rotation[2] * m_vScales[node].z, 0.f);
+		local[3] = glm::vec4(m_vPositions[node], 1.f);
+
+		m_vWorldMatrices[node] = parent == invalidNode ? local : m_vWorldMatrices[parent] * local;
+
+		m_FirstChanged = std::min(m_FirstChanged, node);
+		m_LastChanged = std::max(m_LastChanged, node);
+		++updatedCount;
+	}
+
+	std::fill(m_vDirty.begin() + m_FirstDirty, m_vDirty.end(), uint8_t{ 0 });
+	m_FirstDirty = invalidNode;
+	return updatedCount;
+}
+
+void TransformHierarchy::Initialize(const VulkanContext& context)
+{
+	m_Context = context;
+
+	VkDescriptorSetLayoutBinding matrixBinding{};
+	matrixBinding.binding = 0;
+	matrixBinding.descriptorCount = 1;
+	matrixBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	matrixBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &matrixBinding;
+	if (vkCreateDescriptorSetLayout(m_Context.device, &layoutInfo, nullptr, &m_DescriptorSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create world matrix descriptor set layout!");
+
+	m_DescriptorAllocator.Initialize(m_Context.device, { { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f } }, 1);
+	m_DescriptorSet = m_DescriptorAllocator.Allocate(m_DescriptorSetLayout);
+	CreateWorldMatrixBuffer(std::max(GetNodeCount(), 64u));
+}
+
+void TransformHierarchy::Cleanup()
+{
+	m_WorldMatrixBuffer.reset();
+	m_BufferCapacity = 0;
+	m_DescriptorAllocator.Cleanup();
+	vkDestroyDescriptorSetLayout(m_Context.device, m_DescriptorSetLayout, nullptr);
+	m_DescriptorSetLayout = VK_NULL_HANDLE;
+}
+
+void TransformHierarchy::Upload()
+{
+	if (!m_WorldMatrixBuffer)
+		return;
+
+	if (GetNodeCount() > m_BufferCapacity)
+		CreateWorldMatrixBuffer(std::max(GetNodeCount(), m_BufferCapacity * 2));
+
+	if (m_FirstChanged == invalidNode)
+		return;
+
+	const VkDeviceSize offset = sizeof(glm::mat4) * m_FirstChanged;
+	const VkDeviceSize size = sizeof(glm::mat4) * (m_LastChanged - m_FirstChanged + 1);
+	m_WorldMatrixBuffer->Upload(&m_vWorldMatrices[m_FirstChanged], offset, size);
+
+	m_FirstChanged = invalidNode;
+	m_LastChanged = 0;
+}
+
+void TransformHierarchy::Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex) const
+{
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, setIndex, 1, &m_DescriptorSet, 0, nullptr);
+}
+
+void TransformHierarchy::MarkDirty(uint32_t node)
+{
+	m_vDirty[node] = 1;
+	m_FirstDirty = std::min(m_FirstDirty, node);
+}
+
+void TransformHierarchy::CreateWorldMatrixBuffer(uint32_t capacity)
+{
+	// Replaced right away, the buffer is only written after the frame that read it has finished
+	m_BufferCapacity = capacity;
+	m_WorldMatrixBuffer = std::make_unique<Buffer>(
+		m_Context,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		sizeof(glm::mat4) * capacity
+	);
+	m_WorldMatrixBuffer->Map();
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = m_WorldMatrixBuffer->GetVkBuffer();
+	bufferInfo.offset = 0;
+	bufferInfo.range = VK_WHOLE_SIZE;
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = m_DescriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(m_Context.device, 1, &descriptorWrite, 0, nullptr);
+
+	// A fresh buffer has none of the existing matrices yet
+	if (GetNodeCount() > 0)
+	{
+		m_FirstChanged = 0;
+		m_LastChanged = GetNodeCount() - 1;
+	}
+}
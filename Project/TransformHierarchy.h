@@ -0,0 +1,87 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "vulkanbase/VulkanUtil.h"
+#include "Buffer.h"
+#include "DescriptorAllocator.h"
+
+//-----------------------------------------------------
+// TransformHierarchy Class
+//-----------------------------------------------------
+// Scene graph transforms stored as flat arrays. A node is always created after its parent,
+// so walking the arrays front to back visits every parent before its children and one pass
+// is enough to propagate dirty flags and rebuild the world matrices that actually changed.
+// The world matrices are mirrored in one storage buffer indexed by node, which the mesh pipelines bind as set 2.
+// Only the range of nodes rebuilt since the last upload is copied, objects just carry their node index.
+class TransformHierarchy final
+{
+public:
+	static constexpr uint32_t invalidNode{ UINT32_MAX };
+
+	TransformHierarchy() = default;
+	~TransformHierarchy() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	TransformHierarchy(const TransformHierarchy& other)					= delete;
+	TransformHierarchy(TransformHierarchy&& other) noexcept				= delete;
+	TransformHierarchy& operator=(const TransformHierarchy& other)		= delete;
+	TransformHierarchy& operator=(TransformHierarchy&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	uint32_t CreateNode(uint32_t parent = invalidNode, const glm::vec3& position = glm::vec3(0), const glm::quat& rotation = glm::quat(1, 0, 0, 0), const glm::vec3& scale = glm::vec3(1));
+
+	void SetLocalPosition(uint32_t node, const glm::vec3& position);
+	void SetLocalRotation(uint32_t node, const glm::quat& rotation);
+	void SetLocalScale(uint32_t node, const glm::vec3& scale);
+
+	const glm::vec3& GetLocalPosition(uint32_t node) const { return m_vPositions[node]; }
+	const glm::quat& GetLocalRotation(uint32_t node) const { return m_vRotations[node]; }
+	const glm::vec3& GetLocalScale(uint32_t node) const { return m_vScales[node]; }
+	uint32_t GetParent(uint32_t node) const { return m_vParents[node]; }
+	const glm::mat4& GetWorldMatrix(uint32_t node) const { return m_vWorldMatrices[node]; }
+	uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_vParents.size()); }
+
+	// Recomputes the world matrix of every dirty node and its descendants, returns how many were rebuilt
+	uint32_t Update();
+
+	// Nodes can be created before, the buffer is sized to what exists by then
+	void Initialize(const VulkanContext& context);
+	void Cleanup();
+	// Copies the matrices rebuilt since the last upload, the frame that read the buffer before has to be finished
+	void Upload();
+
+	void Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex) const;
+	VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_DescriptorSetLayout; }
+
+private:
+	void MarkDirty(uint32_t node);
+	void CreateWorldMatrixBuffer(uint32_t capacity);
+
+	std::vector<uint32_t> m_vParents{};
+	std::vector<glm::vec3> m_vPositions{};
+	std::vector<glm::quat> m_vRotations{};
+	std::vector<glm::vec3> m_vScales{};
+	std::vector<glm::mat4> m_vWorldMatrices{};
+	std::vector<uint8_t> m_vDirty{};
+
+	uint32_t m_FirstDirty{ invalidNode };
+	uint32_t m_FirstChanged{ invalidNode };
+	uint32_t m_LastChanged{ 0 };
+
+	VulkanContext m_Context{};
+	VkDescriptorSetLayout m_DescriptorSetLayout{};
+	DescriptorAllocator m_DescriptorAllocator{};
+	VkDescriptorSet m_DescriptorSet{};
+	std::unique_ptr<Buffer> m_WorldMatrixBuffer{};
+	uint32_t m_BufferCapacity{ 0 };
+};
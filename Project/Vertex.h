@@ -22,6 +22,7 @@ struct Vertex2D
 
 	static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions() 
 	{
+		// Locations match Vertex3D so both formats feed the same shader, 1 is the normal a 2D vertex does not have
 		std::vector<VkVertexInputAttributeDescription> attributeDescriptions(3);
 
 		attributeDescriptions[0].binding = 0;
@@ -30,12 +31,12 @@ struct Vertex2D
 		attributeDescriptions[0].offset = offsetof(Vertex2D, pos);
 
 		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
+		attributeDescriptions[1].location = 2;
 		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
 		attributeDescriptions[1].offset = offsetof(Vertex2D, color);
 
 		attributeDescriptions[2].binding = 0;
-		attributeDescriptions[2].location = 2;
+		attributeDescriptions[2].location = 3;
 		attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
 		attributeDescriptions[2].offset = offsetof(Vertex2D, texCoord);
 
@@ -107,9 +108,17 @@ struct ViewProjection
 {
 	glm::mat4 proj{ glm::mat4(1) };
 	glm::mat4 view{ glm::mat4(1) };
+	float time{ 0.f };	// seconds, drives the vertex shader animation
 };
 
-struct MeshData 
+// One element of a pipeline's object data buffer, aligned so the C++ array matches the std430 one
+struct alignas(16) MeshData 
 {
 	glm::mat4 model{ glm::mat4(1) };
+	glm::vec4 animation{ 0, 1, 0, 0 };	// xyz: rotation axis, w: angular speed in radians per second
+	glm::vec4 impostorSphere{ 0 };		// xyz: center, w: radius of the sphere the impostor frames were baked around, mesh space
+	glm::vec2 lodFade{ 0 };				// instance distances over which the impostor takes over, no fade when both are equal
+	uint32_t textureIndex{ 0 };			// slot in the bindless texture array, read by the fragment shader
+	uint32_t impostorFrames{ 0 };		// frames along each side of the octahedral impostor atlas
+	uint32_t transformNode{ UINT32_MAX };	// world matrix the model is relative to, none while UINT32_MAX
 };
\ No newline at end of file
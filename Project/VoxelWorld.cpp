@@ -0,0 +1,481 @@
+//---------------------------
+// Includes
+//---------------------------
+#include "VoxelWorld.h"
+#include <algorithm>
+#include <chrono>
+#include <numbers>
+#include <glm/ext/matrix_transform.hpp>
+#include "ThreadPool.h"
+#include "Random.h"
+#include "Hash.h"
+
+namespace
+{
+	constexpr BlockType grass{ 1 };
+	constexpr BlockType dirt{ 2 };
+	constexpr BlockType stone{ 3 };
+
+	constexpr uint32_t blockTextureSize{ 16 };
+
+	// Counter clockwise seen from the side the normal points to, which is what the pipeline treats as front facing
+	void AppendQuad(std::vector<Vertex3D>& vVertices, std::vector<uint32_t>& vIndices, const glm::vec3& corner, const glm::vec3& du, const glm::vec3& dv,
+		const glm::vec3& normal, const glm::vec3& color, const glm::vec2& size, bool flipWinding)
+	{
+		const uint32_t first = static_cast<uint32_t>(vVertices.size());
+		// The uvs count blocks, the repeating sampler puts one copy of the texture on each of them
+		vVertices.push_back(Vertex3D{ corner, normal, color, glm::vec2{ 0.f, 0.f } });
+		vVertices.push_back(Vertex3D{ corner + du, normal, color, glm::vec2{ size.x, 0.f } });
+		vVertices.push_back(Vertex3D{ corner + du + dv, normal, color, size });
+		vVertices.push_back(Vertex3D{ corner + dv, normal, color, glm::vec2{ 0.f, size.y } });
+
+		if (flipWinding)
+			vIndices.insert(vIndices.end(), { first, first + 2, first + 1, first, first + 3, first + 2 });
+		else
+			vIndices.insert(vIndices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+	}
+}
+
+//---------------------------
+// Member functions
+//---------------------------
+
+void VoxelWorld::Initialize(const VulkanContext& context, GraphicsPipeline<Mesh3D>& pipeline, const glm::vec3& origin, float blockSize)
+{
+	m_Context = context;
+	m_pPipeline = &pipeline;
+	m_Origin = origin;
+	m_BlockSize = blockSize;
+	m_pTexture = CreateBlockTexture();
+
+	// Leaves a thread for the other users of the pool, texture decoding and pipeline compiles mostly
+	m_MaxWorkerJobs = std::max(ThreadPool::Get().GetThreadCount(), 2u) - 1;
+
+	m_Palette.fill(glm::vec3{ 1.f });
+	m_Palette[grass] = glm::vec3{ 0.36f, 0.7f, 0.25f };
+	m_Palette[dirt] = glm::vec3{ 0.5f, 0.35f, 0.2f };
+	m_Palette[stone] = glm::vec3{ 0.5f, 0.5f, 0.52f };
+}
+
+void VoxelWorld::Cleanup()
+{
+	// Workers only touch their own copy of the blocks, a mesh or column still being built is simply dropped
+	m_vDirtyChunks.clear();
+	m_vMeshingChunks.clear();
+	m_vQueuedColumns.clear();
+	m_vGeneratingColumns.clear();
+	m_Chunks.clear();
+	m_pTexture.reset();
+	m_pPipeline = nullptr;
+	m_Stats = VoxelStats{};
+}
+
+void VoxelWorld::SetBlock(const glm::ivec3& position, BlockType block)
+{
+	// The shift rounds towards negative infinity, so negative positions land in the right chunk too
+	const glm::ivec3 coordinate = position >> chunkShift;
+	Chunk* pChunk = FindChunk(coordinate);
+	if (!pChunk)
+	{
+		if (block == air)
+			return;
+		pChunk = &GetOrCreateChunk(coordinate);
+	}
+
+	const glm::ivec3 local = position & (chunkSize - 1);
+	BlockType& current = pChunk->blocks[GetBlockIndex(local.x, local.y, local.z)];
+	if (current == block)
+		return;
+
+	if (current == air)
+	{
+		++pChunk->solidBlocks;
+		++m_Stats.solidBlocks;
+	}
+	else if (block == air)
+	{
+		--pChunk->solidBlocks;
+		--m_Stats.solidBlocks;
+	}
+	current = block;
+	MarkDirty(*pChunk);
+
+	// Whether the neighbour's border faces are hidden depends on this block as well
+	for (int axis{}; axis < 3; ++axis)
+	{
+		if (local[axis] != 0 && local[axis] != chunkSize - 1)
+			continue;
+
+		glm::ivec3 neighbour = coordinate;
+		neighbour[axis] += local[axis] == 0 ? -1 : 1;
+		if (Chunk* pNeighbour = FindChunk(neighbour))
+			MarkDirty(*pNeighbour);
+	}
+}
+
+BlockType VoxelWorld::GetBlock(const glm::ivec3& position) const
+{
+	const Chunk* pChunk = FindChunk(position >> chunkShift);
+	if (!pChunk)
+		return air;
+
+	const glm::ivec3 local = position & (chunkSize - 1);
+	return pChunk->blocks[GetBlockIndex(local.x, local.y, local.z)];
+}
+
+void VoxelWorld::GenerateTerrain(const glm::ivec3& size, uint64_t seed)
+{
+	Pcg32 rng{ seed };
+	TerrainShape shape{};
+	shape.size = size;
+	shape.baseHeight = size.y * 0.4f;
+	float amplitude = size.y * 0.25f;
+	float frequency = 0.02f;
+	for (TerrainShape::Wave& wave : shape.waves)
+	{
+		const float angle = rng.NextFloat(0.f, 2.f * std::numbers::pi_v<float>);
+		wave = TerrainShape::Wave{ glm::vec2{ glm::cos(angle), glm::sin(angle) }, frequency, rng.NextFloat(0.f, 2.f * std::numbers::pi_v<float>), amplitude };
+		amplitude *= 0.5f;
+		frequency *= 2.1f;
+	}
+
+	// A column of chunks is one job, Update() hands them to the workers as slots free up
+	const glm::ivec3 chunkCount = (size + (chunkSize - 1)) >> chunkShift;
+	for (int chunkZ{}; chunkZ < chunkCount.z; ++chunkZ)
+	{
+		for (int chunkX{}; chunkX < chunkCount.x; ++chunkX)
+			m_vQueuedColumns.push_back(TerrainColumn{ glm::ivec2{ chunkX, chunkZ }, shape });
+	}
+	m_Stats.generatingColumns = static_cast<uint32_t>(m_vQueuedColumns.size() + m_vGeneratingColumns.size());
+}
+
+void VoxelWorld::Update()
+{
+	if (!m_pPipeline)
+		return;
+
+	std::erase_if(m_vGeneratingColumns, [this](std::future<std::vector<GeneratedChunk>>& column)
+		{
+			if (column.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				return false;
+			ApplyColumn(column.get());
+			return true;
+		});
+
+	std::erase_if(m_vMeshingChunks, [this](Chunk* pChunk)
+		{
+			if (pChunk->pendingMesh.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				return false;
+			ApplyMesh(*pChunk, pChunk->pendingMesh.get());
+			return true;
+		});
+
+	// Terrain goes first, every column that lands dirties its neighbours and they would be meshed again anyway
+	const auto hasFreeWorker = [this]() { return m_vGeneratingColumns.size() + m_vMeshingChunks.size() < m_MaxWorkerJobs; };
+	size_t startedColumns{ 0 };
+	for (; startedColumns < m_vQueuedColumns.size() && hasFreeWorker(); ++startedColumns)
+	{
+		m_vGeneratingColumns.push_back(ThreadPool::Get().Enqueue([column = m_vQueuedColumns[startedColumns]]()
+			{
+				return GenerateColumn(column);
+			}));
+	}
+	m_vQueuedColumns.erase(m_vQueuedColumns.begin(), m_vQueuedColumns.begin() + startedColumns);
+
+	// A chunk that changed while a worker had it stays listed, its new version goes out once the old one is back
+	std::erase_if(m_vDirtyChunks, [this, &hasFreeWorker](Chunk* pChunk)
+		{
+			if (pChunk->pendingMesh.valid() || !hasFreeWorker())
+				return false;
+			pChunk->dirtyListed = false;
+			StartMeshing(*pChunk);
+			return true;
+		});
+
+	m_Stats.meshingChunks = static_cast<uint32_t>(m_vDirtyChunks.size() + m_vMeshingChunks.size());
+	m_Stats.generatingColumns = static_cast<uint32_t>(m_vQueuedColumns.size() + m_vGeneratingColumns.size());
+	m_Stats.cubeTriangles = m_Stats.solidBlocks * 12;
+}
+
+size_t VoxelWorld::ChunkCoordinateHash::operator()(const glm::ivec3& coordinate) const
+{
+	size_t seed{ 0 };
+	HashCombine(seed, coordinate.x);
+	HashCombine(seed, coordinate.y);
+	HashCombine(seed, coordinate.z);
+	return seed;
+}
+
+std::vector<VoxelWorld::GeneratedChunk> VoxelWorld::GenerateColumn(const TerrainColumn& column)
+{
+	const TerrainShape& shape = column.shape;
+	std::vector<int> vHeights(chunkSize * chunkSize);
+	int maxHeight{ 0 };
+	for (int z{}; z < chunkSize; ++z)
+	{
+		for (int x{}; x < chunkSize; ++x)
+		{
+			const glm::ivec2 position = column.coordinate * chunkSize + glm::ivec2{ x, z };
+			int height{ 0 };
+			if (position.x < shape.size.x && position.y < shape.size.z)
+			{
+				float surface = shape.baseHeight;
+				for (const TerrainShape::Wave& wave : shape.waves)
+					surface += wave.amplitude * glm::sin(glm::dot(wave.direction, glm::vec2(position)) * wave.frequency + wave.phase);
+				height = std::clamp(static_cast<int>(surface), 1, shape.size.y);
+			}
+			vHeights[x + z * chunkSize] = height;
+			maxHeight = std::max(maxHeight, height);
+		}
+	}
+
+	// Only the chunks the surface reaches into are created, the air above stays empty
+	std::vector<GeneratedChunk> vChunks{};
+	for (int chunkY{}; chunkY * chunkSize < maxHeight; ++chunkY)
+	{
+		GeneratedChunk& chunk = vChunks.emplace_back(GeneratedChunk{ glm::ivec3{ column.coordinate.x, chunkY, column.coordinate.y }, std::make_unique<std::array<BlockType, chunkVolume>>() });
+		chunk.pBlocks->fill(air);
+		for (int z{}; z < chunkSize; ++z)
+		{
+			for (int x{}; x < chunkSize; ++x)
+			{
+				const int height = vHeights[x + z * chunkSize];
+				const int top = std::min(height - chunkY * chunkSize, chunkSize);
+				for (int y{}; y < top; ++y)
+				{
+					const int worldY = chunkY * chunkSize + y;
+					(*chunk.pBlocks)[GetBlockIndex(x, y, z)] = worldY == height - 1 ? grass : (worldY >= height - 4 ? dirt : stone);
+				}
+			}
+		}
+	}
+	return vChunks;
+}
+
+VoxelWorld::ChunkMesh VoxelWorld::BuildMesh(const std::vector<BlockType>& vPadded, const std::array<glm::vec3, 256>& palette, uint32_t version)
+{
+	ChunkMesh mesh{};
+	mesh.version = version;
+
+	// One slice of faces at a time, the block type of the face or air where there is none
+	std::array<BlockType, chunkSize * chunkSize> mask{};
+	for (int axis{}; axis < 3; ++axis)
+	{
+		// u x v points along the axis, so u then v goes counter clockwise seen from the positive side
+		const int u = (axis + 1) % 3;
+		const int v = (axis + 2) % 3;
+		for (int direction : { 1, -1 })
+		{
+			glm::ivec3 normal{ 0 };
+			normal[axis] = direction;
+
+			for (int slice{}; slice < chunkSize; ++slice)
+			{
+				// A face exists where a solid block looks at air, whichever chunk that air is in
+				glm::ivec3 position{};
+				position[axis] = slice;
+				for (int j{}; j < chunkSize; ++j)
+				{
+					for (int i{}; i < chunkSize; ++i)
+					{
+						position[u] = i;
+						position[v] = j;
+						const glm::ivec3 padded = position + 1;
+						const glm::ivec3 facing = padded + normal;
+						const BlockType block = vPadded[GetPaddedIndex(padded.x, padded.y, padded.z)];
+						const bool visible = block != air && vPadded[GetPaddedIndex(facing.x, facing.y, facing.z)] == air;
+						mask[i + j * chunkSize] = visible ? block : air;
+						mesh.exposedFaces += visible ? 1 : 0;
+					}
+				}
+
+				// Grow each face along u as far as the block type matches, then grow that row along v
+				for (int j{}; j < chunkSize; ++j)
+				{
+					for (int i{}; i < chunkSize; )
+					{
+						const BlockType block = mask[i + j * chunkSize];
+						if (block == air)
+						{
+							++i;
+							continue;
+						}
+
+						int width{ 1 };
+						while (i + width < chunkSize && mask[i + width + j * chunkSize] == block)
+							++width;
+
+						int height{ 1 };
+						for (; j + height < chunkSize; ++height)
+						{
+							const auto row = mask.begin() + i + (j + height) * chunkSize;
+							if (!std::all_of(row, row + width, [block](BlockType other) { return other == block; }))
+								break;
+						}
+
+						glm::vec3 corner{};
+						corner[axis] = static_cast<float>(direction > 0 ? slice + 1 : slice);
+						corner[u] = static_cast<float>(i);
+						corner[v] = static_cast<float>(j);
+						glm::vec3 du{ 0.f };
+						du[u] = static_cast<float>(width);
+						glm::vec3 dv{ 0.f };
+						dv[v] = static_cast<float>(height);
+						AppendQuad(mesh.vVertices, mesh.vIndices, corner, du, dv, glm::vec3(normal), palette[block], glm::vec2(width, height), direction < 0);
+
+						for (int row{}; row < height; ++row)
+							std::fill_n(mask.begin() + i + (j + row) * chunkSize, width, air);
+						i += width;
+					}
+				}
+			}
+		}
+	}
+	return mesh;
+}
+
+VoxelWorld::Chunk* VoxelWorld::FindChunk(const glm::ivec3& coordinate) const
+{
+	auto it = m_Chunks.find(coordinate);
+	return it != m_Chunks.end() ? it->second.get() : nullptr;
+}
+
+VoxelWorld::Chunk& VoxelWorld::GetOrCreateChunk(const glm::ivec3& coordinate)
+{
+	std::unique_ptr<Chunk>& pChunk = m_Chunks[coordinate];
+	if (!pChunk)
+	{
+		pChunk = std::make_unique<Chunk>();
+		pChunk->coordinate = coordinate;
+		++m_Stats.chunks;
+	}
+	return *pChunk;
+}
+
+void VoxelWorld::MarkDirty(Chunk& chunk)
+{
+	++chunk.version;
+	if (chunk.dirtyListed)
+		return;
+	chunk.dirtyListed = true;
+	m_vDirtyChunks.push_back(&chunk);
+}
+
+void VoxelWorld::ApplyColumn(std::vector<GeneratedChunk>&& vChunks)
+{
+	// Chunks are filled directly instead of going through SetBlock for every block. The terrain only adds
+	// solid blocks, so whatever was set in the chunk before stays where the terrain has air.
+	for (const GeneratedChunk& generated : vChunks)
+	{
+		Chunk& chunk = GetOrCreateChunk(generated.coordinate);
+		for (int i{}; i < chunkVolume; ++i)
+		{
+			const BlockType block = (*generated.pBlocks)[i];
+			if (block == air)
+				continue;
+
+			BlockType& current = chunk.blocks[i];
+			if (current == air)
+			{
+				++chunk.solidBlocks;
+				++m_Stats.solidBlocks;
+			}
+			current = block;
+		}
+
+		// Neighbours that existed before see new blocks across their border
+		MarkDirty(chunk);
+		for (int axis{}; axis < 3; ++axis)
+		{
+			for (int direction : { -1, 1 })
+			{
+				glm::ivec3 neighbour = chunk.coordinate;
+				neighbour[axis] += direction;
+				if (Chunk* pNeighbour = FindChunk(neighbour))
+					MarkDirty(*pNeighbour);
+			}
+		}
+	}
+}
+
+void VoxelWorld::StartMeshing(Chunk& chunk)
+{
+	// The worker gets a copy, blocks can keep changing on the main thread while it runs
+	std::vector<BlockType> vPadded(paddedSize * paddedSize * paddedSize, air);
+	const glm::ivec3 firstBlock = chunk.coordinate * chunkSize;
+	for (int z{}; z < paddedSize; ++z)
+	{
+		for (int y{}; y < paddedSize; ++y)
+		{
+			for (int x{}; x < paddedSize; ++x)
+			{
+				const bool border = x == 0 || y == 0 || z == 0 || x == paddedSize - 1 || y == paddedSize - 1 || z == paddedSize - 1;
+				vPadded[GetPaddedIndex(x, y, z)] = border
+					? GetBlock(firstBlock + glm::ivec3{ x - 1, y - 1, z - 1 })
+					: chunk.blocks[GetBlockIndex(x - 1, y - 1, z - 1)];
+			}
+		}
+	}
+
+	chunk.pendingMesh = ThreadPool::Get().Enqueue([vPadded = std::move(vPadded), palette = m_Palette, version = chunk.version]()
+		{
+			return BuildMesh(vPadded, palette, version);
+		});
+	m_vMeshingChunks.push_back(&chunk);
+}
+
+void VoxelWorld::ApplyMesh(Chunk& chunk, ChunkMesh&& mesh)
+{
+	// The old mesh is removed in the same pipeline update that initializes the new one, no frame is without either
+	if (!chunk.mesh.IsNull())
+		m_pPipeline->RemoveMesh(chunk.mesh);
+	chunk.mesh = MeshHandle{};
+	chunk.meshedVersion = mesh.version;
+
+	m_Stats.triangles -= chunk.triangles;
+	m_Stats.exposedFaceTriangles -= chunk.exposedFaces * 2;
+	chunk.triangles = static_cast<uint32_t>(mesh.vIndices.size() / 3);
+	chunk.exposedFaces = mesh.exposedFaces;
+	m_Stats.triangles += chunk.triangles;
+	m_Stats.exposedFaceTriangles += chunk.exposedFaces * 2;
+
+	if (mesh.vIndices.empty())
+		return;
+
+	auto pMesh = std::make_unique<Mesh3D>();
+	pMesh->SetVertices(std::move(mesh.vVertices));
+	pMesh->SetIndices(std::move(mesh.vIndices));
+	pMesh->SetTexture(m_pTexture);
+	// Vertices count blocks from the chunk's corner, which keeps them small and exact
+	const glm::vec3 chunkOrigin = m_Origin + glm::vec3(chunk.coordinate * chunkSize) * m_BlockSize;
+	pMesh->SetVertexConstant(MeshData{ glm::scale(glm::translate(glm::mat4(1.f), chunkOrigin), glm::vec3(m_BlockSize)) });
+	// A changed chunk is meshed again from its blocks, the uploaded geometry is never read back
+	pMesh->SetCpuDataPolicy(CpuDataPolicy::ReleaseAfterUpload);
+	chunk.mesh = m_pPipeline->AddMesh(std::move(pMesh));
+}
+
+std::shared_ptr<Texture> VoxelWorld::CreateBlockTexture() const
+{
+	// Grey speckles with a darker rim, tinted per block type by the vertex color, so single blocks stay readable on merged faces
+	Pcg32 rng{ 0x5eed };
+	std::vector<TextureMipLevel> vMipLevels{ TextureMipLevel{ blockTextureSize, blockTextureSize, std::vector<uint8_t>(blockTextureSize * blockTextureSize * 4) } };
+	for (uint32_t y{}; y < blockTextureSize; ++y)
+	{
+		for (uint32_t x{}; x < blockTextureSize; ++x)
+		{
+			const bool rim = x == 0 || y == 0 || x == blockTextureSize - 1 || y == blockTextureSize - 1;
+			const uint8_t value = static_cast<uint8_t>(rim ? rng.NextFloat(150.f, 170.f) : rng.NextFloat(215.f, 255.f));
+			uint8_t* pTexel = &vMipLevels[0].pixels[(x + y * blockTextureSize) * 4];
+			pTexel[0] = value;
+			pTexel[1] = value;
+			pTexel[2] = value;
+			pTexel[3] = 255;
+		}
+	}
+
+	uint32_t mipLevelCount{ 1 };
+	for (uint32_t size = blockTextureSize; size > 1; size /= 2)
+		++mipLevelCount;
+	Texture::GenerateMipLevels(vMipLevels, mipLevelCount);
+	return std::make_shared<Texture>(vMipLevels, m_Context);
+}
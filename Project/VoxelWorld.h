@@ -0,0 +1,170 @@
+#pragma once
+
+//-----------------------------------------------------
+// Include Files
+//-----------------------------------------------------
+#include <array>
+#include <vector>
+#include <memory>
+#include <future>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "vulkanbase/VulkanUtil.h"
+#include "Mesh.h"
+#include "GraphicsPipeline.h"
+
+// 0 is air, every other value is a solid block drawn in its palette color
+using BlockType = uint8_t;
+
+struct VoxelStats
+{
+	uint32_t chunks{ 0 };
+	uint32_t meshingChunks{ 0 };	// dirty or on a worker, their triangles are still the old mesh's
+	uint32_t generatingColumns{ 0 };	// terrain columns queued or on a worker, their chunks do not exist yet
+	uint64_t solidBlocks{ 0 };
+	uint64_t triangles{ 0 };
+	uint64_t exposedFaceTriangles{ 0 };	// what hidden face removal alone would leave, without merging
+	uint64_t cubeTriangles{ 0 };		// a 12 triangle cube per solid block
+};
+
+//-----------------------------------------------------
+// VoxelWorld Class
+//-----------------------------------------------------
+// Blocks stored in cubic chunks, each chunk drawn as one Mesh3D of the pipeline it was given. Only faces between
+// a solid block and air get geometry, and coplanar faces of the same block type are merged into the largest
+// rectangles that fit (greedy meshing). Changing blocks only re-meshes the chunks involved, on worker threads,
+// and the new mesh replaces the old one once it is done. Every chunk is culled on its own like any other mesh.
+// Generating and meshing together never take more than all but one of the pool's threads.
+class VoxelWorld final
+{
+public:
+	static constexpr int chunkShift{ 5 };
+	static constexpr int chunkSize{ 1 << chunkShift };
+	static constexpr int chunkVolume{ chunkSize * chunkSize * chunkSize };
+	static constexpr BlockType air{ 0 };
+
+	VoxelWorld() = default;
+	~VoxelWorld() = default;
+
+	// -------------------------
+	// Copy/move constructors and assignment operators
+	// -------------------------
+	VoxelWorld(const VoxelWorld& other)					= delete;
+	VoxelWorld(VoxelWorld&& other) noexcept				= delete;
+	VoxelWorld& operator=(const VoxelWorld& other)		= delete;
+	VoxelWorld& operator=(VoxelWorld&& other) noexcept	= delete;
+
+	//-------------------------------------------------
+	// Member functions
+	//-------------------------------------------------
+	// Block (0, 0, 0) has its minimum corner at origin, every block is blockSize along each axis
+	void Initialize(const VulkanContext& context, GraphicsPipeline<Mesh3D>& pipeline, const glm::vec3& origin, float blockSize = 1.f);
+	// The chunk meshes belong to the pipeline and go with its cleanup
+	void Cleanup();
+
+	void SetBlock(const glm::ivec3& position, BlockType block);
+	BlockType GetBlock(const glm::ivec3& position) const;
+	void SetBlockColor(BlockType block, const glm::vec3& color) { m_Palette[block] = color; }
+
+	// Rolling grass hills over dirt and stone, size blocks from block (0, 0, 0) on. Only queues the work,
+	// the columns of chunks are filled on worker threads and show up in the Update() after they are done.
+	void GenerateTerrain(const glm::ivec3& size, uint64_t seed);
+
+	// Adds the terrain and swaps in the meshes the workers finished, then starts on what is still queued.
+	// Has to run before the pipeline's Update(), which initializes the new meshes and drops the replaced ones.
+	void Update();
+
+	const VoxelStats& GetStats() const { return m_Stats; }
+
+private:
+	// Blocks of a chunk with a one block border taken from its neighbours, the worker needs nothing else
+	static constexpr int paddedSize{ chunkSize + 2 };
+
+	struct ChunkMesh
+	{
+		uint32_t version{ 0 };
+		std::vector<Vertex3D> vVertices{};
+		std::vector<uint32_t> vIndices{};
+		uint32_t exposedFaces{ 0 };
+	};
+
+	struct Chunk
+	{
+		glm::ivec3 coordinate{};
+		std::array<BlockType, chunkVolume> blocks{};
+		uint32_t solidBlocks{ 0 };
+
+		// Bumped on every change, the mesh is current while both match
+		uint32_t version{ 1 };
+		uint32_t meshedVersion{ 0 };
+		bool dirtyListed{ false };
+		std::future<ChunkMesh> pendingMesh{};
+
+		MeshHandle mesh{};
+		uint32_t triangles{ 0 };
+		uint32_t exposedFaces{ 0 };
+	};
+
+	// A few octaves of sine waves with random directions and phases, cheap and smooth enough for hills
+	struct TerrainShape
+	{
+		struct Wave
+		{
+			glm::vec2 direction{};
+			float frequency{};
+			float phase{};
+			float amplitude{};
+		};
+
+		std::array<Wave, 4> waves{};
+		glm::ivec3 size{};
+		float baseHeight{};
+	};
+
+	struct GeneratedChunk
+	{
+		glm::ivec3 coordinate{};
+		std::unique_ptr<std::array<BlockType, chunkVolume>> pBlocks{};
+	};
+
+	struct TerrainColumn
+	{
+		glm::ivec2 coordinate{};
+		TerrainShape shape{};
+	};
+
+	struct ChunkCoordinateHash
+	{
+		size_t operator()(const glm::ivec3& coordinate) const;
+	};
+
+	static int GetBlockIndex(int x, int y, int z) { return x + chunkSize * (y + chunkSize * z); }
+	static int GetPaddedIndex(int x, int y, int z) { return x + paddedSize * (y + paddedSize * z); }
+	// Both run on a worker thread
+	static std::vector<GeneratedChunk> GenerateColumn(const TerrainColumn& column);
+	static ChunkMesh BuildMesh(const std::vector<BlockType>& vPadded, const std::array<glm::vec3, 256>& palette, uint32_t version);
+
+	Chunk* FindChunk(const glm::ivec3& coordinate) const;
+	Chunk& GetOrCreateChunk(const glm::ivec3& coordinate);
+	void MarkDirty(Chunk& chunk);
+	void ApplyColumn(std::vector<GeneratedChunk>&& vChunks);
+	void StartMeshing(Chunk& chunk);
+	void ApplyMesh(Chunk& chunk, ChunkMesh&& mesh);
+	std::shared_ptr<Texture> CreateBlockTexture() const;
+
+	VulkanContext m_Context{};
+	GraphicsPipeline<Mesh3D>* m_pPipeline{ nullptr };
+	glm::vec3 m_Origin{};
+	float m_BlockSize{ 1.f };
+	std::shared_ptr<Texture> m_pTexture{};
+	std::array<glm::vec3, 256> m_Palette{};
+
+	std::unordered_map<glm::ivec3, std::unique_ptr<Chunk>, ChunkCoordinateHash> m_Chunks{};
+	std::vector<Chunk*> m_vDirtyChunks{};
+	std::vector<Chunk*> m_vMeshingChunks{};
+	std::vector<TerrainColumn> m_vQueuedColumns{};
+	std::vector<std::future<std::vector<GeneratedChunk>>> m_vGeneratingColumns{};
+	uint32_t m_MaxWorkerJobs{ 1 };
+
+	VoxelStats m_Stats{};
+};
@@ -10,6 +10,15 @@ QueueFamilyIndices VulkanBase::findQueueFamilies(VkPhysicalDevice device) {
 	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
+	for (uint32_t family = 0; family < queueFamilyCount; ++family)
+	{
+		const VkQueueFlags flags = queueFamilies[family].queueFlags;
+		if (!indices.transferFamily.has_value() && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+			indices.transferFamily = family;
+		if (!indices.computeFamily.has_value() && (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+			indices.computeFamily = family;
+	}
+
 	int i = 0;
 	for (const auto& queueFamily : queueFamilies) 
 	{
@@ -34,11 +34,63 @@ bool VulkanBase::isDeviceSuitable(VkPhysicalDevice device) {
 
 }
 
+bool VulkanBase::queryTimelineSemaphores()
+{
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	if (properties.apiVersion < VK_API_VERSION_1_2)
+		return false;
+
+	VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+	timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &timelineFeatures;
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+	return timelineFeatures.timelineSemaphore == VK_TRUE;
+}
+
+bool VulkanBase::queryDescriptorIndexing(const VkPhysicalDeviceFeatures& supportedFeatures)
+{
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	if (properties.apiVersion < VK_API_VERSION_1_2 || !supportedFeatures.shaderSampledImageArrayDynamicIndexing)
+		return false;
+
+	VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &indexingFeatures;
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+	if (!indexingFeatures.descriptorBindingPartiallyBound || !indexingFeatures.descriptorBindingSampledImageUpdateAfterBind)
+		return false;
+
+	// A combined image sampler counts against both the sampler and the sampled image limits
+	VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+	VkPhysicalDeviceProperties2 properties2{};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &indexingProperties;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+	m_MaxBindlessTextures = std::min({ m_MaxBindlessTextures,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages });
+	return m_MaxBindlessTextures > 0;
+}
+
 void VulkanBase::createLogicalDevice() {
 	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+	if (indices.transferFamily.has_value())
+		uniqueQueueFamilies.insert(indices.transferFamily.value());
+	if (indices.computeFamily.has_value())
+		uniqueQueueFamilies.insert(indices.computeFamily.value());
 
 	float queuePriority = 1.0f;
 	for (uint32_t queueFamily : uniqueQueueFamilies) 
@@ -56,19 +108,62 @@ void VulkanBase::createLogicalDevice() {
 	queueCreateInfo.queueFamilyIndex = indices.graphicsFamily.value();
 	queueCreateInfo.queueCount = 1;
 
+	VkPhysicalDeviceFeatures supportedFeatures{};
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+	m_MultiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
+	m_DrawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+	deviceFeatures.shaderSampledImageArrayDynamicIndexing = supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+
+	VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+	m_DescriptorIndexing = queryDescriptorIndexing(supportedFeatures);
+	if (m_DescriptorIndexing)
+	{
+		indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+		indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	}
+
+	// Lets the frame wait on uploads on the GPU, without it every upload is waited on by the CPU
+	VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+	timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+	m_TimelineSemaphores = queryTimelineSemaphores();
+	timelineFeatures.timelineSemaphore = m_TimelineSemaphores ? VK_TRUE : VK_FALSE;
+	if (m_DescriptorIndexing)
+		timelineFeatures.pNext = &indexingFeatures;
+
+	// Optional, without it the residency manager budgets against the heap sizes
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+	m_MemoryBudget = std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const VkExtensionProperties& extension)
+		{
+			return strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+		});
+
+	std::vector<const char*> enabledExtensions = deviceExtensions;
+	if (m_MemoryBudget)
+		enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	if (m_TimelineSemaphores)
+		createInfo.pNext = &timelineFeatures;
+	else
+		createInfo.pNext = m_DescriptorIndexing ? &indexingFeatures : nullptr;
 
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
 	createInfo.pEnabledFeatures = &deviceFeatures;
 
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+	createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 	if (enableValidationLayers) 
 	{
@@ -83,4 +178,12 @@ void VulkanBase::createLogicalDevice() {
 
 	vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
 	vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+	// Without a transfer only family uploads share the graphics queue
+	m_TransferFamily = indices.transferFamily.value_or(indices.graphicsFamily.value());
+	vkGetDeviceQueue(device, m_TransferFamily, 0, &transferQueue);
+
+	// Same for compute work, which then simply runs before the frame's graphics work
+	m_ComputeFamily = indices.computeFamily.value_or(indices.graphicsFamily.value());
+	vkGetDeviceQueue(device, m_ComputeFamily, 0, &computeQueue);
 }
\ No newline at end of file
@@ -47,39 +47,95 @@ void VulkanBase::drawFrame()
 	vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
 	vkResetFences(device, 1, &inFlightFence);
 
+	// The frame that fence belonged to is done, so is everything queued for deletion while it was current
+	DeletionQueue::Get().Flush(ResidencyManager::Get().GetFrameIndex());
+
 	uint32_t imageIndex;
 	VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
 	
+	// Evicts before anything new gets allocated this frame
+	ResidencyManager::Get().Update();
+	m_TransferQueue.CollectFinished();
+
 	m_CommandBuffer.Reset();
 	m_CommandBuffer.BeginRecording();
+	const VkCommandBuffer commandBuffer = m_CommandBuffer.GetVkCommandBuffer();
+
+	// Texture mips are copied at the start of the frame, the views they publish are picked up by the updates below
+	m_TextureStreamer.Update(m_TransferQueue, m_TextureUploadBudget);
+
+	// Chunk meshes finished by the workers replace the old ones in the 3D pipeline's update
+	m_VoxelWorld.Update();
+
+	// The previous frame is done, so pipelines can safely rebuild their descriptors for newly streamed meshes.
+	// Streaming shares one budget: meshes already handed to the pipelines initialize first, new scene entries get the rest.
+	float streamingBudget = m_SceneStreamingBudget;
+	streamingBudget -= m_GraphicsPipeline2D.Update(streamingBudget);
+	// Voxel chunks swap their mesh in the frame the old one is removed, so the 3D pipeline is never held back, only charged
+	streamingBudget -= m_GraphicsPipeline3D.Update();
+	streamingBudget -= m_GraphicsPipelineInstancing.Update(streamingBudget);
+	streamingBudget -= m_GraphicsPipelineFaded.Update(streamingBudget);
+	streamingBudget -= m_GraphicsPipelineImpostors.Update(streamingBudget);
+	m_SceneLoader->Update(streamingBudget);
 
-	beginRenderPass(m_CommandBuffer, swapChainFramebuffers[imageIndex], swapChainExtent);
+	m_Transforms.Update();
+	m_Transforms.Upload();
 
 	// 2D Camera matrix
-	ViewProjection vp{};
+	ViewProjection vp2D{};
 	glm::vec3 scaleFactors(1.0f / swapChainExtent.width, 1.0f / swapChainExtent.height, 1.0f);
-	vp.view = glm::scale(vp.view, scaleFactors);
-	vp.view = glm::translate(vp.view, glm::vec3(-static_cast<float>(swapChainExtent.width), -static_cast<float>(swapChainExtent.height), 0.0f));
-	vp.view = glm::scale(vp.view, glm::vec3(2.f, 2.f, 1.0f));
-	// draw pipeline 1.
-	m_GraphicsPipeline2D.Record(m_CommandBuffer, swapChainExtent, vp);
+	vp2D.view = glm::scale(vp2D.view, scaleFactors);
+	vp2D.view = glm::translate(vp2D.view, glm::vec3(-static_cast<float>(swapChainExtent.width), -static_cast<float>(swapChainExtent.height), 0.0f));
+	vp2D.view = glm::scale(vp2D.view, glm::vec3(2.f, 2.f, 1.0f));
 
 	// 3D camera matrix.
 	m_Camera.Update();
+	ViewProjection vp{};
 	vp.view = m_Camera.viewMatrix;
 	vp.proj = m_Camera.projectionMatrix;
-	// draw pipeline 2.
-
-	static auto startTime{ std::chrono::steady_clock::now() };
-	auto endTime = std::chrono::steady_clock::now();
-	auto deltaTime = std::chrono::duration<float>(endTime - startTime).count();
-	startTime = endTime;
-	float rotationAngle = 90.f * deltaTime;
-	m_GraphicsPipeline3D.SetVertexConstant({ glm::rotate(glm::mat4(1), glm::radians(rotationAngle), glm::vec3{ 0.f,1.f,0.f }) });
-	m_GraphicsPipeline3D.Record(m_CommandBuffer, swapChainExtent, vp);
-	m_GraphicsPipelineInstancing.SetVertexConstant({ glm::rotate(glm::mat4(1), glm::radians(rotationAngle), glm::vec3{ 0.f,1.f,0.f }) });
-	m_GraphicsPipelineInstancing.Record(m_CommandBuffer, swapChainExtent, vp);
-	// end the render pass
+	// absolute time, the shaders evaluate every rotation from it so nothing accumulates on the CPU
+	vp.time = static_cast<float>(glfwGetTime());
+
+	// Draw lists and occlusion candidates are built before recording, the candidate buffers may grow
+	m_OcclusionCulling.BeginFrame();
+	m_GraphicsPipeline2D.Prepare(vp2D);
+	m_GraphicsPipeline3D.Prepare(vp);
+	m_GraphicsPipelineInstancing.Prepare(vp);
+	m_GraphicsPipelineFaded.Prepare(vp);
+	m_GraphicsPipelineImpostors.Prepare(vp);
+	m_OcclusionCulling.UploadCandidates(vp.proj * vp.view);
+
+	// Early phase: whatever passes against last frame's depth pyramid. It needs nothing from this frame's
+	// graphics work, so it goes to the compute queue ahead of it.
+	const VkCommandBuffer computeCommandBuffer = m_ComputeQueue.BeginFrame();
+	m_OcclusionCulling.RecordCulling(computeCommandBuffer, CullPhase::Early);
+	m_ComputeQueue.Submit();
+
+	m_SpriteBatch.Begin();
+	m_SceneLoader->SubmitSprites(m_SpriteBatch);
+	m_SpriteBatch.End();
+
+	// Everything uploaded so far this frame changes hands before the first draw that could read it
+	const uint64_t uploadValue = m_TransferQueue.RecordAcquires(commandBuffer);
+
+	beginRenderPass(m_CommandBuffer, renderPass, swapChainFramebuffers[imageIndex], swapChainExtent);
+	m_GraphicsPipeline2D.Record(m_CommandBuffer, swapChainExtent, CullPhase::Early);
+	m_GraphicsPipeline3D.Record(m_CommandBuffer, swapChainExtent, CullPhase::Early);
+	m_GraphicsPipelineInstancing.Record(m_CommandBuffer, swapChainExtent, CullPhase::Early);
+	m_GraphicsPipelineFaded.Record(m_CommandBuffer, swapChainExtent, CullPhase::Early);
+	m_GraphicsPipelineImpostors.Record(m_CommandBuffer, swapChainExtent, CullPhase::Early);
+	endRenderPass(m_CommandBuffer);
+
+	// Late phase: rebuild the pyramid from that depth and draw what turned out to be disoccluded
+	m_OcclusionCulling.RecordPyramid(commandBuffer);
+	m_OcclusionCulling.RecordCulling(commandBuffer, CullPhase::Late);
+	beginRenderPass(m_CommandBuffer, lateRenderPass, swapChainFramebuffers[imageIndex], swapChainExtent);
+	m_GraphicsPipeline3D.Record(m_CommandBuffer, swapChainExtent, CullPhase::Late);
+	m_GraphicsPipelineInstancing.Record(m_CommandBuffer, swapChainExtent, CullPhase::Late);
+	m_GraphicsPipelineFaded.Record(m_CommandBuffer, swapChainExtent, CullPhase::Late);
+	m_GraphicsPipelineImpostors.Record(m_CommandBuffer, swapChainExtent, CullPhase::Late);
+	// Sprites go last so they end up over everything the late phase added
+	m_SpriteBatch.Record(m_CommandBuffer, swapChainExtent, vp2D.proj * vp2D.view);
 	endRenderPass(m_CommandBuffer);
 
 	m_CommandBuffer.EndRecording();
@@ -87,16 +143,46 @@ void VulkanBase::drawFrame()
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-	VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
+	std::vector<VkSemaphore> vWaitSemaphores{ imageAvailableSemaphore };
+	std::vector<VkPipelineStageFlags> vWaitStages{ VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	std::vector<uint64_t> vWaitValues{ 0 };
+
+	// The acquire barriers start at the transfer stage, so that is as early as the uploads have to be done.
+	// Binary semaphores ignore their value.
+	if (uploadValue > 0)
+	{
+		vWaitSemaphores.push_back(m_TransferQueue.GetTimelineSemaphore());
+		vWaitStages.push_back(VK_PIPELINE_STAGE_TRANSFER_BIT);
+		vWaitValues.push_back(uploadValue);
+	}
+
+	// On an async compute family the early draws wait for the early cull, on the graphics queue submission order does
+	const VkSemaphore computeFinishedSemaphore = m_ComputeQueue.GetComputeFinishedSemaphore();
+	if (computeFinishedSemaphore != VK_NULL_HANDLE)
+	{
+		vWaitSemaphores.push_back(computeFinishedSemaphore);
+		vWaitStages.push_back(VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		vWaitValues.push_back(0);
+	}
+
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(vWaitSemaphores.size());
+	submitInfo.pWaitSemaphores = vWaitSemaphores.data();
+	submitInfo.pWaitDstStageMask = vWaitStages.data();
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	if (uploadValue > 0)
+	{
+		timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(vWaitValues.size());
+		timelineInfo.pWaitSemaphoreValues = vWaitValues.data();
+		submitInfo.pNext = &timelineInfo;
+	}
 
 	m_CommandBuffer.Submit(submitInfo);
 
-	VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
-	submitInfo.signalSemaphoreCount = 1;
+	// Present waits on the first, the next compute submit on the second
+	VkSemaphore signalSemaphores[] = { renderFinishedSemaphore, m_ComputeQueue.GetGraphicsFinishedSemaphore() };
+	submitInfo.signalSemaphoreCount = signalSemaphores[1] != VK_NULL_HANDLE ? 2 : 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
 	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence) != VK_SUCCESS)
@@ -185,7 +271,8 @@ void VulkanBase::createInstance()
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.pEngineName = "No Engine";
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+	// 1.2 for core descriptor indexing, devices that report less fall back to a set per texture
+	appInfo.apiVersion = VK_API_VERSION_1_2;
 
 	VkInstanceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -214,11 +301,11 @@ void VulkanBase::createInstance()
 		throw std::runtime_error("failed to create instance!");
 }
 
-void VulkanBase::beginRenderPass(const CommandBuffer& buffer, VkFramebuffer currentBuffer, VkExtent2D extent) const
+void VulkanBase::beginRenderPass(const CommandBuffer& buffer, VkRenderPass pass, VkFramebuffer currentBuffer, VkExtent2D extent) const
 {
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = renderPass;
+	renderPassInfo.renderPass = pass;
 	renderPassInfo.framebuffer = currentBuffer;
 	renderPassInfo.renderArea.offset = { 0, 0 };
 	renderPassInfo.renderArea.extent = extent;
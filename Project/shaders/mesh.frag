@@ -0,0 +1,87 @@
+#version 450
+
+// Sized at pipeline creation: 1 on the fallback path, the bindless array size otherwise
+layout(constant_id = 0) const uint textureCount = 1;
+// Permutation, see ShaderPermutation.h. 0: unlit, 1: lambert, 2: half lambert
+layout(constant_id = 1) const bool instanced = false;
+layout(constant_id = 2) const uint lightingModel = 1;
+layout(constant_id = 5) const bool impostor = false;
+layout(constant_id = 6) const bool lodFade = false;
+
+layout(binding = 1) uniform sampler2D texSamplers[textureCount];
+
+struct ObjectData {
+    mat4 model;
+    vec4 animation; // xyz: axis, w: radians per second
+    vec4 impostorSphere; // xyz: center, w: radius, mesh space
+    vec2 lodFade; // instance distances over which the impostor takes over
+    uint textureIndex;
+    uint impostorFrames;
+    uint transformNode; // index into the world matrices, none while ~0
+};
+
+// One entry per mesh of the pipeline, written once per frame
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+layout(push_constant) uniform PushConstants {
+    uint objectIndex;
+} draw;
+
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec3 fragColor;
+layout(location = 2) in vec2 fragTexCoord;
+layout(location = 3) flat in float fragFade;
+layout(location = 4) flat in vec3 fragFrameRight;
+layout(location = 5) flat in vec3 fragFrameUp;
+layout(location = 6) flat in vec3 fragFrameForward;
+
+layout(location = 0) out vec4 outColor;
+
+// 4x4 ordered dither thresholds in (0, 1)
+float ditherThreshold(vec2 fragCoord)
+{
+    const float bayer[16] = float[16](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0, 3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+    ivec2 pixel = ivec2(fragCoord) & 3;
+    return (bayer[pixel.y * 4 + pixel.x] + 0.5) / 16.0;
+}
+
+void main() 
+{
+    // A mesh and its impostor dither from opposite ends, every pixel of the fade band is drawn by exactly one of them.
+    // Only the pipelines of meshes with a fade band and their impostors set lodFade, all others compile the discard
+    // out and keep early depth testing.
+    if (lodFade)
+    {
+        float threshold = ditherThreshold(gl_FragCoord.xy);
+        if (impostor ? fragFade <= threshold : fragFade > threshold)
+            discard;
+    }
+
+    uint textureIndex = objects[draw.objectIndex].textureIndex;
+    vec4 albedo = texture(texSamplers[textureIndex], fragTexCoord);
+    vec3 normal = fragNormal;
+    if (impostor)
+    {
+        // Alpha is the coverage of the baked silhouette
+        if (albedo.a < 0.5)
+            discard;
+        vec3 frameNormal = texture(texSamplers[textureIndex], fragTexCoord + vec2(0.5, 0.0)).xyz * 2.0 - 1.0;
+        normal = fragFrameRight * frameNormal.x + fragFrameUp * frameNormal.y + fragFrameForward * frameNormal.z;
+        albedo.a = 1.0;
+    }
+
+    if (lightingModel == 0)
+    {
+        outColor = albedo;
+        return;
+    }
+
+    const vec3 lightDirection = normalize(vec3(0.0, 1.0, -1.0));
+    float nDotL = dot(normalize(normal), lightDirection);
+    float diff = lightingModel == 2 ? nDotL * 0.5 + 0.5 : max(nDotL, 0.2);
+
+    // Simple diffuse lighting, assuming white light
+    outColor = albedo * vec4(diff * fragColor, 1.0);
+}
@@ -0,0 +1,166 @@
+#version 450
+
+// Permutation, see ShaderPermutation.h
+layout(constant_id = 1) const bool instanced = false;
+layout(constant_id = 3) const bool textureAtlas = false;
+layout(constant_id = 4) const uint vertexFormat = 0; // 0: Vertex3D, 1: Vertex2D
+layout(constant_id = 5) const bool impostor = false;
+layout(constant_id = 6) const bool lodFade = false;
+
+layout(set=0,binding = 0) uniform UniformBufferObject {
+    mat4 proj;
+    mat4 view; 
+    float time;
+} vp;
+
+struct ObjectData {
+    mat4 model;
+    vec4 animation; // xyz: axis, w: radians per second
+    vec4 impostorSphere; // xyz: center, w: radius, mesh space
+    vec2 lodFade; // instance distances over which the impostor takes over
+    uint textureIndex;
+    uint impostorFrames;
+    uint transformNode; // index into the world matrices, none while ~0
+};
+
+// One entry per mesh of the pipeline, written once per frame
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+// The transform hierarchy's world matrices, indexed by node
+layout(std430, set = 2, binding = 0) readonly buffer WorldMatrixBuffer {
+    mat4 worldMatrices[];
+};
+
+layout(push_constant) uniform PushConstants {
+    uint objectIndex;
+} draw;
+
+// per vertex, a 2D position arrives with z = 0
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec3 inColor;
+layout(location = 3) in vec2 inTexCoord;
+
+// per instance
+layout(location = 4) in vec4 modelC0;
+layout(location = 5) in vec4 modelC1;
+layout(location = 6) in vec4 modelC2;
+layout(location = 7) in vec4 modelC3;
+layout(location = 8) in vec4 atlasRect; // xy: uv offset, zw: uv scale of the atlas cell
+layout(location = 9) in vec4 instanceAnimation; // xyz: axis, w: radians per second
+layout(location = 10) in float instanceAnimationPhase;
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec3 fragColor;
+layout(location = 2) out vec2 fragTexCoord;
+layout(location = 3) flat out float fragFade; // share of the impostor in the cross fade
+// Basis of the impostor frame in world space, the baked normals are expressed in it
+layout(location = 4) flat out vec3 fragFrameRight;
+layout(location = 5) flat out vec3 fragFrameUp;
+layout(location = 6) flat out vec3 fragFrameForward;
+
+// Rodrigues rotation around a unit axis
+mat4 axisAngleRotation(vec3 axis, float angle)
+{
+    float c = cos(angle);
+    float s = sin(angle);
+    vec3 t = (1.0 - c) * axis;
+    return mat4(
+        vec4(t.x * axis.x + c,          t.x * axis.y + s * axis.z, t.x * axis.z - s * axis.y, 0.0),
+        vec4(t.y * axis.x - s * axis.z, t.y * axis.y + c,          t.y * axis.z + s * axis.x, 0.0),
+        vec4(t.z * axis.x + s * axis.y, t.z * axis.y - s * axis.x, t.z * axis.z + c,          0.0),
+        vec4(0.0, 0.0, 0.0, 1.0));
+}
+
+vec2 signNotZero(vec2 value)
+{
+    return vec2(value.x >= 0.0 ? 1.0 : -1.0, value.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Octahedral mapping of unit directions onto [0, 1]^2 with y as the pole, the same as ImpostorAtlas
+vec2 octahedralEncode(vec3 direction)
+{
+    direction /= abs(direction.x) + abs(direction.y) + abs(direction.z);
+    vec2 p = direction.y >= 0.0 ? direction.xz : (1.0 - abs(direction.zx)) * signNotZero(direction.xz);
+    return p * 0.5 + 0.5;
+}
+
+vec3 octahedralDecode(vec2 uv)
+{
+    vec2 p = uv * 2.0 - 1.0;
+    vec3 direction = vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y);
+    if (direction.y < 0.0)
+        direction.xz = (1.0 - abs(direction.zx)) * signNotZero(direction.xz);
+    return normalize(direction);
+}
+
+void impostorFrameBasis(vec3 forward, out vec3 right, out vec3 up)
+{
+    vec3 reference = abs(forward.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    right = normalize(cross(reference, forward));
+    up = cross(forward, right);
+}
+
+void main() {
+    ObjectData object = objects[draw.objectIndex];
+    mat4 objectModel = object.model;
+    if (object.transformNode != 0xFFFFFFFFu)
+        objectModel = worldMatrices[object.transformNode] * objectModel;
+
+    // Instances carry their own spin, a single mesh spins through its object data
+    mat4 model;
+    if (instanced)
+    {
+        mat4 instanceModel = mat4(modelC0, modelC1, modelC2, modelC3);
+        model = instanceModel * objectModel * axisAngleRotation(instanceAnimation.xyz, instanceAnimationPhase + instanceAnimation.w * vp.time);
+    }
+    else
+        model = objectModel * axisAngleRotation(object.animation.xyz, object.animation.w * vp.time);
+
+    vec3 cameraPosition = -transpose(mat3(vp.view)) * vp.view[3].xyz;
+    fragFade = 0.0;
+    if (lodFade && object.lodFade.x != object.lodFade.y)
+        fragFade = clamp((distance(cameraPosition, model[3].xyz) - object.lodFade.x) / (object.lodFade.y - object.lodFade.x), 0.0, 1.0);
+
+    vec3 localPosition = inPosition;
+    fragFrameRight = vec3(0.0);
+    fragFrameUp = vec3(0.0);
+    fragFrameForward = vec3(0.0);
+    if (impostor)
+    {
+        // The view direction in mesh space picks the frame, so the instance's rotation and spin show in it.
+        // Transposing undoes the rotation of a uniformly scaled model, the scale goes with the normalize.
+        vec3 center = (model * vec4(object.impostorSphere.xyz, 1.0)).xyz;
+        vec3 localView = normalize(transpose(mat3(model)) * (cameraPosition - center));
+        float frames = float(object.impostorFrames);
+        vec2 frame = min(floor(octahedralEncode(localView) * frames), vec2(frames - 1.0));
+
+        // The quad lies in the plane its frame was baked in, inPosition.xy is the corner in [-1, 1]
+        vec3 forward = octahedralDecode((frame + 0.5) / frames);
+        vec3 right;
+        vec3 up;
+        impostorFrameBasis(forward, right, up);
+        localPosition = object.impostorSphere.xyz + (right * inPosition.x + up * inPosition.y) * object.impostorSphere.w;
+
+        fragFrameRight = normalize(mat3(model) * right);
+        fragFrameUp = normalize(mat3(model) * up);
+        fragFrameForward = normalize(mat3(model) * forward);
+        // Albedo frames fill the left half of the atlas, the normals the right half
+        fragTexCoord = vec2((frame.x + inTexCoord.x) / frames * 0.5, (frame.y + inTexCoord.y) / frames);
+    }
+    else
+    {
+        // Mesh uvs are expected in [0, 1], the atlas gutters keep filtering inside the cell
+        fragTexCoord = (instanced && textureAtlas) ? atlasRect.xy + inTexCoord * atlasRect.zw : inTexCoord;
+    }
+
+    gl_Position = vp.proj * vp.view * model * vec4(localPosition, 1.0);
+    // An instance the cross fade hides completely collapses outside the view volume, none of its triangles get rasterized
+    if ((impostor && fragFade <= 0.0) || (!impostor && fragFade >= 1.0))
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+
+    fragNormal = vertexFormat == 1 ? vec3(0.0, 0.0, -1.0) : normalize((model * vec4(inNormal, 0.0)).xyz);
+    fragColor = inColor;
+}
@@ -0,0 +1,14 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform sampler2D texSampler;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() 
+{
+    // The vertex color tints the texture, white leaves it untouched
+    outColor = texture(texSampler, fragTexCoord) * vec4(fragColor, 1.0);
+}
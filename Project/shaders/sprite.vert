@@ -1,13 +1,8 @@
 #version 450
 
-layout(set=0,binding = 0) uniform UniformBufferObject {
-    mat4 proj;
-    mat4 view; 
-} vp;
-
 layout(push_constant) uniform PushConstants {
-    mat4 model; 
-} mesh;
+    mat4 viewProjection;
+} batch;
 
 layout(location = 0) in vec2 inPosition;
 layout(location = 1) in vec3 inColor;
@@ -18,7 +13,8 @@ layout(location = 1) out vec2 fragTexCoord;
 
 void main() 
 {
-    gl_Position = vp.proj * vp.view * mesh.model * vec4(inPosition, 0.0,1.0);
-	fragColor = inColor;
+    // Positions are already in pixels, there is no per sprite transform
+    gl_Position = batch.viewProjection * vec4(inPosition, 0.0, 1.0);
+    fragColor = inColor;
     fragTexCoord = inTexCoord;
-}
\ No newline at end of file
+}
@@ -26,6 +26,17 @@
 #include "GraphicsPipeline.h"
 #include "Utils.h"
 #include "Camera.h"
+#include "TransformHierarchy.h"
+#include "Scene.h"
+#include "HiZCulling.h"
+#include "SpriteBatch.h"
+#include "ResidencyManager.h"
+#include "TransferQueue.h"
+#include "ComputeQueue.h"
+#include "PipelineCompiler.h"
+#include "DeletionQueue.h"
+#include "AssetCache.h"
+#include "VoxelWorld.h"
 
 const std::vector<const char*> validationLayers = {
 	"VK_LAYER_KHRONOS_validation"
@@ -38,6 +49,10 @@ const std::vector<const char*> deviceExtensions = {
 struct QueueFamilyIndices {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	// Transfer only family, the DMA engines on most discrete GPUs. Left empty when the device has none.
+	std::optional<uint32_t> transferFamily;
+	// Compute without graphics, runs next to the graphics queue on hardware with async compute
+	std::optional<uint32_t> computeFamily;
 
 	bool isComplete() const
 	{
@@ -71,6 +86,8 @@ private:
 		// week 05
 		pickPhysicalDevice();
 		createLogicalDevice();
+		ResidencyManager::Get().Initialize(physicalDevice, m_MemoryBudget);
+		DeletionQueue::Get().Initialize(device);
 
 		// week 04 
 		createSwapChain();
@@ -80,77 +97,47 @@ private:
 		createRenderPass();
 
 		// week 02
-		m_CommandPool.Initialize(device, findQueueFamilies(physicalDevice));
+		const QueueFamilyIndices queueFamilies = findQueueFamilies(physicalDevice);
+		m_CommandPool.Initialize(device, queueFamilies);
+		m_TransferQueue.Initialize(physicalDevice, device, transferQueue, m_TransferFamily, queueFamilies.graphicsFamily.value(), m_TimelineSemaphores);
+		m_ComputeQueue.Initialize(device, computeQueue, m_ComputeFamily, queueFamilies.graphicsFamily.value());
+		m_PipelineCompiler.Initialize(device);
 		createDepthResources();
 		createFrameBuffers();
 		
 		m_Camera.Initialize(60.f, glm::vec3(0, 50, -100), static_cast<float>(swapChainExtent.width) / swapChainExtent.height);
 
-		VulkanContext context{ device, physicalDevice, renderPass, swapChainExtent, graphicsQueue };
-
-		auto pStatueTexture = std::make_shared<Texture>("statue.jpg", context, m_CommandPool);
-		auto pPenguinTexture = std::make_shared<Texture>("Skipper.png", context, m_CommandPool);
-		m_GraphicsPipeline2D.AddMesh(std::move(Mesh2D::CreateRectangle(context, m_CommandPool, pStatueTexture, 10, 10, 150, 150)));
-		m_GraphicsPipeline2D.AddMesh(std::move(Mesh2D::CreateOval(context, m_CommandPool, pPenguinTexture, {80, 220}, {50, 60}, 64)));
-
-		auto pVehicleTexture = std::make_shared<Texture>("vehicle_diffuse.png", context, m_CommandPool);
-		auto pBirbTexture = std::make_shared<Texture>("birb.png", context, m_CommandPool);
-		auto pGrassTexture = std::make_shared<Texture>("GrassBlock.png", context, m_CommandPool);
-		auto pBoatTexture = std::make_shared<Texture>("BoatTexture.jpg", context, m_CommandPool);
-
-		auto pVehicle = m_GraphicsPipeline3D.AddMesh(std::move(
-			Mesh3D::CreateMesh(
-				"resources/vehicle.obj",
-				pVehicleTexture,
-				context, 
-				m_CommandPool
-			)));
-
-		pVehicle->SetVertexConstant(MeshData{ glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3{40, 20 ,-40}), glm::vec3(2)) });
-		pVehicle->ToggleRotation(true);
-
-		auto pBoat = m_GraphicsPipeline3D.AddMesh(std::move(
-			Mesh3D::CreateMesh(
-				"resources/boat.obj",
-				pBoatTexture,
-				context, 
-				m_CommandPool
-			)));
-
-		pBoat->SetVertexConstant(MeshData{ glm::scale(glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3{-160, 0 ,-50}), glm::radians(-70.f), {0,1,0}), glm::vec3(0.5f))});
-		
-		auto pBirb = m_GraphicsPipelineInstancing.AddMesh(std::move(
-			Mesh3D::CreateMesh(
-				"resources/birb.obj",
-				pBirbTexture,
-				context, 
-				m_CommandPool
-			)));
-
-		InstancedMeshData instancedData{};
-		instancedData.maxOffset = { 50, 50, 50 };
-		pBirb->SetInstancedMeshData(instancedData);
-		pBirb->SetVertexConstant(MeshData{ glm::scale(glm::mat4(1), glm::vec3(0.5f)) });
-		pBirb->SetInstanceCount(100000);
-		pBirb->ToggleRotation(true);
-		
-		auto pBlock = m_GraphicsPipelineInstancing.AddMesh(std::move(
-			Mesh3D::CreateMesh(
-				"resources/cube.obj",
-				pGrassTexture,
-				context,
-				m_CommandPool
-			)));
-
-		instancedData = {};
-		instancedData.maxOffset = { 10, 10, 10 };
-		pBlock->SetInstancedMeshData(instancedData);
-		pBlock->SetVertexConstant(MeshData{ glm::rotate(glm::mat4(1), glm::radians(-90.f), { 0,1,0 }) });
-		pBlock->SetInstanceCount(100000);
+		VulkanContext context{ device, physicalDevice, renderPass, swapChainExtent, graphicsQueue, m_DescriptorIndexing, m_MaxBindlessTextures, &m_TransferQueue, &m_ComputeQueue, &m_PipelineCompiler, &m_AssetCache, &m_Transforms };
+		m_AssetCache.Initialize(context, m_TextureStreamer);
+
+		// Only parses the file, the textures and meshes stream in during the first frames
+		m_SceneLoader = std::make_unique<SceneLoader>(context, m_CommandPool, m_GraphicsPipeline3D, m_GraphicsPipelineInstancing, m_GraphicsPipelineFaded, m_GraphicsPipelineImpostors, m_Transforms);
+		// Nothing reads the geometry on the CPU after upload, only bounds and instance cells are kept
+		m_SceneLoader->SetCpuDataPolicy(CpuDataPolicy::ReleaseAfterUpload);
+		m_SceneLoader->Load("resources/scene.txt");
 
+		// The block terrain is generated and meshed on workers over the first frames, one mesh per chunk in the 3D pipeline
+		m_VoxelWorld.Initialize(context, m_GraphicsPipeline3D, glm::vec3(-128.f, -80.f, -128.f));
+		m_VoxelWorld.GenerateTerrain(glm::ivec3(256, 64, 256), 1);
+
+		// The pipeline layouts take the world matrix set, the nodes the scene created so far size the buffer
+		m_Transforms.Initialize(context);
 		m_GraphicsPipeline2D.Initialize(context, m_CommandPool);
 		m_GraphicsPipeline3D.Initialize(context, m_CommandPool);
 		m_GraphicsPipelineInstancing.Initialize(context, m_CommandPool);
+		m_GraphicsPipelineFaded.Initialize(context, m_CommandPool);
+		m_GraphicsPipelineImpostors.Initialize(context, m_CommandPool);
+		m_SpriteBatch.Initialize(context);
+
+		// Instanced cells are drawn indirectly with their own first instance
+		if (m_DrawIndirectFirstInstance)
+		{
+			m_OcclusionCulling.Initialize(context, depthImageView);
+			m_GraphicsPipeline3D.SetOcclusionCulling(&m_OcclusionCulling, m_MultiDrawIndirect);
+			m_GraphicsPipelineInstancing.SetOcclusionCulling(&m_OcclusionCulling, m_MultiDrawIndirect);
+			m_GraphicsPipelineFaded.SetOcclusionCulling(&m_OcclusionCulling, m_MultiDrawIndirect);
+			m_GraphicsPipelineImpostors.SetOcclusionCulling(&m_OcclusionCulling, m_MultiDrawIndirect);
+		}
 
 		m_CommandBuffer = m_CommandPool.CreateCommandBuffer();
 		
@@ -171,11 +158,68 @@ private:
 
 			m_Camera.KeyEvent(window, deltaTime);
 			drawFrame();
+
+			// F1 toggles the stats dump, it stays off unless asked for
+			const bool statsKeyDown = glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS;
+			if (statsKeyDown && !m_StatsKeyDown)
+				m_PrintStats = !m_PrintStats;
+			m_StatsKeyDown = statsKeyDown;
+
+			if (m_PrintStats && currentFrameTime - m_LastStatsTime >= m_StatsInterval)
+			{
+				m_LastStatsTime = currentFrameTime;
+				printDrawStats();
+			}
 		}
 		vkDeviceWaitIdle(device);
 	}
 
+	void printDrawStats() const
+	{
+		DrawStats stats{};
+		stats += m_GraphicsPipeline2D.GetDrawStats();
+		stats += m_GraphicsPipeline3D.GetDrawStats();
+		stats += m_GraphicsPipelineInstancing.GetDrawStats();
+		stats += m_GraphicsPipelineFaded.GetDrawStats();
+		stats += m_GraphicsPipelineImpostors.GetDrawStats();
+		const SpriteBatchStats& spriteStats = m_SpriteBatch.GetStats();
+		std::cout << "draws: " << stats.queuedDraws << " queued / " << stats.drawCalls << " recorded, binds: " << stats.unsortedBinds << " unsorted / " << stats.binds << " sorted"
+			<< ", vertices: " << stats.vertices << " (" << stats.impostorVerticesSaved << " saved by impostors)"
+			<< ", sprite vertices: " << spriteStats.vertices << " in " << spriteStats.flushes << " flushes"
+			<< ", streaming textures: " << m_TextureStreamer.GetPendingTextureCount()
+			<< (m_TransferQueue.IsDedicated() ? " on the transfer queue" : " on the graphics queue")
+			<< ", early culling " << (m_ComputeQueue.IsAsync() ? "on async compute" : "on the graphics queue")
+			<< ", compiling pipelines: " << m_PipelineCompiler.GetPendingCount()
+			<< ", pending deletions: " << DeletionQueue::Get().GetPendingCount() << std::endl;
+
+		const ResidencyManager& residency = ResidencyManager::Get();
+		constexpr float mebibyte{ 1024.f * 1024.f };
+		for (const MemoryHeapStats& heap : residency.GetHeapStats())
+		{
+			if (!heap.deviceLocal)
+				continue;
+			std::cout << "device heap: " << heap.usage / mebibyte << " / " << heap.budget / mebibyte << " MiB"
+				<< (residency.HasMemoryBudget() ? " (driver budget)" : " (heap size)")
+				<< ", tracked " << heap.trackedUsage / mebibyte << " MiB in " << heap.allocationCount << " allocations" << std::endl;
+		}
+		const VoxelStats& voxelStats = m_VoxelWorld.GetStats();
+		std::cout << "voxel chunks: " << voxelStats.chunks << " (" << voxelStats.meshingChunks << " meshing, " << voxelStats.generatingColumns << " columns generating), triangles: " << voxelStats.triangles
+			<< ", " << voxelStats.exposedFaceTriangles << " without merging, " << voxelStats.cubeTriangles << " as cubes";
+		if (voxelStats.triangles > 0)
+			std::cout << " (" << static_cast<float>(voxelStats.cubeTriangles) / voxelStats.triangles << "x fewer)";
+		std::cout << std::endl;
+
+		std::cout << "evictions: " << residency.GetEvictionCount() << ", " << residency.GetEvictedBytes() / mebibyte << " MiB" << std::endl;
+	}
+
 	void cleanup() {
+		m_SceneLoader.reset();
+		m_VoxelWorld.Cleanup();
+		m_AssetCache.Cleanup();
+		m_TextureStreamer.Cleanup();
+		m_TransferQueue.Cleanup();
+		m_ComputeQueue.Cleanup();
+
 		vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
 		vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
 		vkDestroyFence(device, inFlightFence, nullptr);
@@ -184,11 +228,19 @@ private:
 		for (auto framebuffer : swapChainFramebuffers)
 			vkDestroyFramebuffer(device, framebuffer, nullptr);
 
+		// Compiles still running read the pipelines' shaders and layouts
+		m_PipelineCompiler.Cleanup();
 		m_GraphicsPipeline2D.Cleanup({ device, physicalDevice, renderPass, swapChainExtent });
 		m_GraphicsPipeline3D.Cleanup({ device, physicalDevice, renderPass, swapChainExtent });
 		m_GraphicsPipelineInstancing.Cleanup({ device, physicalDevice, renderPass, swapChainExtent });
+		m_GraphicsPipelineFaded.Cleanup({ device, physicalDevice, renderPass, swapChainExtent });
+		m_GraphicsPipelineImpostors.Cleanup({ device, physicalDevice, renderPass, swapChainExtent });
+		m_SpriteBatch.Cleanup();
+		m_Transforms.Cleanup();
+		m_OcclusionCulling.Cleanup();
 
 		vkDestroyRenderPass(device, renderPass, nullptr);
+		vkDestroyRenderPass(device, lateRenderPass, nullptr);
 
 		for (auto imageView : swapChainImageViews)
 			vkDestroyImageView(device, imageView, nullptr);
@@ -200,8 +252,10 @@ private:
 
 		vkDestroyImageView(device, depthImageView, nullptr);
 		vkDestroyImage(device, depthImage, nullptr);
-		vkFreeMemory(device, depthImageMemory, nullptr);
+		ResidencyManager::Get().Free(device, depthImageMemory);
 
+		// The device is idle, whatever is still queued can go
+		DeletionQueue::Get().Flush();
 		vkDestroyDevice(device, nullptr);
 
 		vkDestroySurfaceKHR(instance, surface, nullptr);
@@ -241,25 +295,37 @@ private:
 	
 	std::vector<VkFramebuffer> swapChainFramebuffers;
 	VkRenderPass renderPass;
+	VkRenderPass lateRenderPass;
 	GraphicsPipeline<Mesh2D> m_GraphicsPipeline2D{
-		"shaders/shader.vert.spv",
-		"shaders/shader.frag.spv",
-		false
+		ShaderPermutation{ .instanced = false, .lighting = LightingModel::Unlit }
 	};
 	GraphicsPipeline<Mesh3D> m_GraphicsPipeline3D{
-		"shaders/objshader.vert.spv",
-		"shaders/objshader.frag.spv",
-		false
+		ShaderPermutation{ .instanced = false, .lighting = LightingModel::Lambert },
+		true
 	};
 	GraphicsPipeline<Mesh3D> m_GraphicsPipelineInstancing{
-		"shaders/instancedobjshader.vert.spv",
-		"shaders/instancedobjshader.frag.spv",
+		ShaderPermutation{ .instanced = true, .lighting = LightingModel::Lambert, .textureAtlas = true },
+		true
+	};
+	// Instanced meshes with an impostor, the dither over their fade band discards fragments
+	GraphicsPipeline<Mesh3D> m_GraphicsPipelineFaded{
+		ShaderPermutation{ .instanced = true, .lighting = LightingModel::Lambert, .textureAtlas = true, .lodFade = true },
+		true
+	};
+	// Updated after the faded pipeline, its impostors share the instance buffers created there
+	GraphicsPipeline<Mesh3D> m_GraphicsPipelineImpostors{
+		ShaderPermutation{ .instanced = true, .lighting = LightingModel::Lambert, .impostor = true, .lodFade = true },
 		true
 	};
+	bool m_PrintStats{ false };
+	bool m_StatsKeyDown{ false };
+	float m_LastStatsTime{ 0.f };
+	const float m_StatsInterval{ 1.f };
 
 
 	void createFrameBuffers();
 	void createRenderPass();
+	VkRenderPass createRenderPass(bool late);
 
 	VkCommandBuffer beginSingleTimeCommands();
 	void endSingleTimeCommands(VkCommandBuffer commandBuffer);
@@ -299,10 +365,22 @@ private:
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
+	VkQueue transferQueue;
+	VkQueue computeQueue;
 	
 	void pickPhysicalDevice();
 	bool isDeviceSuitable(VkPhysicalDevice device);
 	void createLogicalDevice();
+	bool queryDescriptorIndexing(const VkPhysicalDeviceFeatures& supportedFeatures);
+	bool queryTimelineSemaphores();
+	bool m_MultiDrawIndirect{ false };
+	bool m_DrawIndirectFirstInstance{ false };
+	bool m_DescriptorIndexing{ false };
+	uint32_t m_MaxBindlessTextures{ 1024 };
+	bool m_MemoryBudget{ false };
+	bool m_TimelineSemaphores{ false };
+	uint32_t m_TransferFamily{ 0 };
+	uint32_t m_ComputeFamily{ 0 };
 
 	// Week 06
 	// Main initialization
@@ -322,13 +400,25 @@ private:
 	bool checkDeviceExtensionSupport(VkPhysicalDevice device);
 	void createInstance();
 
-	void beginRenderPass(const CommandBuffer& buffer, VkFramebuffer currentBuffer, VkExtent2D extent) const;
+	void beginRenderPass(const CommandBuffer& buffer, VkRenderPass pass, VkFramebuffer currentBuffer, VkExtent2D extent) const;
 	void endRenderPass(const CommandBuffer& buffer);
 
 	void createSyncObjects();
 	void drawFrame();
 
 	Camera m_Camera;
+	TransformHierarchy m_Transforms;
+	HiZCulling m_OcclusionCulling;
+	SpriteBatch m_SpriteBatch;
+	std::unique_ptr<SceneLoader> m_SceneLoader;
+	const float m_SceneStreamingBudget{ 4.f }; // milliseconds per frame
+	TextureStreamer m_TextureStreamer;
+	AssetCache m_AssetCache;
+	VoxelWorld m_VoxelWorld;
+	TransferQueue m_TransferQueue;
+	ComputeQueue m_ComputeQueue;
+	PipelineCompiler m_PipelineCompiler;
+	const VkDeviceSize m_TextureUploadBudget{ 4 * 1024 * 1024 }; // bytes of mip data copied per frame
 
 	static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData) {
 		std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
@@ -20,6 +20,12 @@ const bool enableValidationLayers = true;
 #include <vector>
 #include <fstream>
 
+class TransferQueue;
+class ComputeQueue;
+class PipelineCompiler;
+class AssetCache;
+class TransformHierarchy;
+
 struct VulkanContext 
 {
 	VkDevice device;
@@ -27,6 +33,13 @@ struct VulkanContext
 	VkRenderPass renderPass;
 	VkExtent2D swapChainExtent;
 	VkQueue graphicsQueue;
+	bool descriptorIndexing{ false };	// partially bound, update after bind sampled image arrays
+	uint32_t maxBindlessTextures{ 0 };
+	TransferQueue* pTransferQueue{ nullptr };	// every staging copy goes through here
+	ComputeQueue* pComputeQueue{ nullptr };
+	PipelineCompiler* pPipelineCompiler{ nullptr };	// graphics pipelines compile in the background
+	AssetCache* pAssetCache{ nullptr };	// textures, mesh geometry and samplers are shared through here
+	const TransformHierarchy* pTransforms{ nullptr };	// world matrices the mesh pipelines bind as set 2
 };
 
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger);